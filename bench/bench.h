@@ -0,0 +1,46 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../processes.h"
+
+/**
+ * Read the monotonic clock.
+ * @return Seconds since an arbitrary point in the past
+ */
+static inline double monotonicSeconds()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/**
+ * Generate a synthetic file descriptor: 80% PostgreSQL-like data file paths of about 50
+ * characters, 10% sockets and 10% pipes. Seed rand() first for the same fixture on every run.
+ * @param fd File descriptor number
+ * @return A dynamically-allocated entry, freed with its process by freeProcess
+ */
+static inline FileDescriptorEntry *syntheticEntry(unsigned long fd)
+{
+    FileDescriptorEntry *entry = (FileDescriptorEntry *)calloc(1, sizeof(FileDescriptorEntry));
+    char filename[SYMBOLIC_LINK_BUFFER_SIZE];
+    int kind = rand() % 10;
+    if (kind == 0)
+        snprintf(filename, sizeof(filename), "socket:[%d]", rand());
+    else if (kind == 1)
+        snprintf(filename, sizeof(filename), "pipe:[%d]", rand());
+    else
+        snprintf(filename, sizeof(filename), "/var/lib/postgresql/15/main/base/%d/%d_fsm.%lu", rand() % 100000, rand(), fd);
+    entry->fd = fd;
+    entry->inode = 100000 + rand() % 1000000;
+    entry->filename = strdup(filename);
+    entry->type = kind == 0 ? FD_TYPE_SOCKET : kind == 1 ? FD_TYPE_PIPE : FD_TYPE_FILE;
+    return entry;
+}
+
+#endif
@@ -0,0 +1,135 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/prctl.h>
+#include <sys/resource.h>
+
+#define MAPS_LINE_SIZE 4096
+
+/**
+ * Find the path of the C library mapped into this process, a typical shared file held open.
+ * @param path Buffer to write the path to
+ * @param size Size of the buffer
+ * @return 0 if operation was successful, -1 otherwise
+ */
+static int findLibc(char *path, size_t size)
+{
+    FILE *maps = fopen("/proc/self/maps", "r");
+    if (maps == NULL)
+        return -1;
+    char line[MAPS_LINE_SIZE];
+    int result = -1;
+    while (result != 0 && fgets(line, sizeof(line), maps) != NULL)
+    {
+        char *file = strchr(line, '/');
+        if (file != NULL && strstr(file, "/libc") != NULL)
+        {
+            file[strcspn(file, "\n")] = '\0';
+            snprintf(path, size, "%s", file);
+            result = 0;
+        }
+    }
+    fclose(maps);
+    return result;
+}
+
+/**
+ * Sleep until the parent exits, as a process of the fixture.
+ */
+static void sleepInChild()
+{
+    prctl(PR_SET_PDEATHSIG, SIGKILL);
+    while (1)
+        pause();
+}
+
+/**
+ * Start a fixture of sleeping processes that each hold the same number of file descriptors:
+ * pipes, /etc/passwd, the C library and /dev/null in turn, including stdin, stdout and stderr.
+ * Optionally, large processes holding many more file descriptors of /dev/null are started last,
+ * so that /proc lists them last. The fixture stays up until this process is killed.
+ * Usage: fdFixture <processes> <fds> [large processes] [large fds]
+ * e.g. fdFixture 5000 63 for the pipeline fixture, fdFixture 5000 253 for 1.26 million file
+ * descriptors, then fdFixture 0 3 5 19904 for the presized arrays fixture.
+ */
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        fprintf(stderr, "Usage: fdFixture <processes> <fds> [large processes] [large fds]\n");
+        return 1;
+    }
+    int processes = atoi(argv[1]);
+    int fds = atoi(argv[2]);
+    int largeProcesses = argc > 3 ? atoi(argv[3]) : 0;
+    int largeFds = argc > 4 ? atoi(argv[4]) : 0;
+    signal(SIGCHLD, SIG_IGN);
+
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0)
+    {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+    char libc[MAPS_LINE_SIZE] = "/etc/passwd";
+    findLibc(libc, sizeof(libc));
+    const char *files[] = {"/etc/passwd", libc, "/dev/null"};
+    int held = 3;
+    for (int i = 0; held < fds; i++)
+    {
+        int pipeEnds[2];
+        if (i % 4 == 0 && held + 2 <= fds && pipe(pipeEnds) == 0)
+            held += 2;
+        else if (open(files[i % 4 == 0 ? 2 : i % 4 - 1], O_RDONLY) >= 0)
+            held++;
+        else
+        {
+            perror("Error: Could not open a file descriptor");
+            return 1;
+        }
+    }
+
+    int started = 0;
+    for (; started < processes; started++)
+    {
+        pid_t pid = fork();
+        if (pid == 0)
+            sleepInChild();
+        if (pid < 0)
+        {
+            perror("Error: Could not fork");
+            break;
+        }
+    }
+    for (int i = 0; i < largeProcesses; i++)
+    {
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            int null = open("/dev/null", O_RDONLY);
+            for (int fd = held + 1; fd < largeFds; fd++)
+            {
+                if (dup2(null, fd) < 0)
+                {
+                    perror("Error: Could not open a file descriptor");
+                    break;
+                }
+            }
+            sleepInChild();
+        }
+        if (pid < 0)
+        {
+            perror("Error: Could not fork");
+            break;
+        }
+        started++;
+    }
+    printf("ready: %d processes\n", started);
+    fflush(stdout);
+    while (1)
+        pause();
+}
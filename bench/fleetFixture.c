@@ -0,0 +1,89 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../processes.h"
+#include "../columns.h"
+#include "../printTables.h"
+#include "../readProcesses.h"
+#include "../stringUtils.h"
+
+#define NODE_FILE_PATH_SIZE 4096
+
+/**
+ * Generate the processes of one node, sorted by PID, each with 0 to maxFds file descriptors
+ * mixing files, sockets, pipes and anonymous inodes.
+ * @param numProcesses Number of processes
+ * @param maxFds Largest number of file descriptors of a process
+ * @param numRows Pointer to the count of rows generated, incremented
+ * @return A dynamically-allocated array of processes
+ */
+static ProcessData **generateNode(int numProcesses, int maxFds, unsigned long *numRows)
+{
+    ProcessData **processes = (ProcessData **)malloc(sizeof(ProcessData *) * numProcesses);
+    unsigned long pid = 1;
+    for (int i = 0; i < numProcesses; i++)
+    {
+        unsigned long size = rand() % (maxFds + 1);
+        pid += 1 + rand() % 50;
+        processes[i] = (ProcessData *)calloc(1, sizeof(ProcessData));
+        processes[i]->pid = pid;
+        processes[i]->inode = 100000 + pid;
+        processes[i]->size = size;
+        processes[i]->fileDescriptors = (FileDescriptorEntry **)malloc(sizeof(FileDescriptorEntry *) * (size + 1));
+        for (unsigned long fd = 0; fd < size; fd++)
+        {
+            FileDescriptorEntry *entry = (FileDescriptorEntry *)calloc(1, sizeof(FileDescriptorEntry));
+            char filename[SYMBOLIC_LINK_BUFFER_SIZE];
+            int kind = rand() % 10;
+            if (kind < 2)
+                snprintf(filename, sizeof(filename), "socket:[%d]", rand());
+            else if (kind == 2)
+                snprintf(filename, sizeof(filename), "pipe:[%d]", rand());
+            else if (kind == 3)
+                snprintf(filename, sizeof(filename), "%s", rand() % 2 ? "anon_inode:[eventfd]" : "anon_inode:[eventpoll]");
+            else
+                snprintf(filename, sizeof(filename), "/srv/app/data/%d.log", rand() % 100000);
+            entry->fd = fd;
+            entry->inode = 100000 + rand() % 1000000;
+            entry->filename = strdup(filename);
+            entry->type = classifyFilename(filename);
+            processes[i]->fileDescriptors[fd] = entry;
+        }
+        *numRows += size;
+    }
+    return processes;
+}
+
+/**
+ * Write synthetic binary tables of many nodes, as written by tableViewer --output_binary, to
+ * merge with binRead --merge. The same files are generated on every run.
+ * Usage: fleetFixture <directory> [nodes] [processes per node] [max fds per process]
+ * e.g. fleetFixture /tmp/fleet 500 200 20 writes /tmp/fleet/node000.bin to node499.bin, merged with
+ * binRead --merge node000:/tmp/fleet/node000.bin ... node499:/tmp/fleet/node499.bin
+ */
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: fleetFixture <directory> [nodes] [processes per node] [max fds per process]\n");
+        return 1;
+    }
+    int numNodes = argc > 2 ? atoi(argv[2]) : 500;
+    int numProcesses = argc > 3 ? atoi(argv[3]) : 200;
+    int maxFds = argc > 4 ? atoi(argv[4]) : 20;
+    unsigned long numRows = 0;
+    srand(1);
+    for (int node = 0; node < numNodes; node++)
+    {
+        char path[NODE_FILE_PATH_SIZE];
+        snprintf(path, sizeof(path), "%s/node%03d.bin", argv[1], node);
+        ProcessData **processes = generateNode(numProcesses, maxFds, &numRows);
+        int result = print_columns_binary(path, COMPOSITE_COLUMNS | COLUMN_MASK(type), processes, numProcesses);
+        freeProcesses(processes, numProcesses);
+        if (result != 0)
+            return 1;
+    }
+    printf("%d node files, %lu rows\n", numNodes, numRows);
+    return 0;
+}
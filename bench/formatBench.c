@@ -0,0 +1,78 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../processes.h"
+#include "../columns.h"
+#include "../printTables.h"
+#include "../readProcesses.h"
+#include "bench.h"
+
+#define BENCH_PROCESSES 1000
+#define BENCH_FDS_PER_PROCESS 1000
+#define BENCH_RUNS 3
+
+/**
+ * Print a table of the synthetic fixture, either a fixed table or given columns.
+ * @param format Format to print in
+ * @param columns Mask of the columns to print, 0 for the composite table
+ * @param processes Processes to print
+ * @param stream Stream to output to
+ */
+static void printFixture(OutputFormat format, unsigned int columns, ProcessData **processes, FILE *stream)
+{
+    if (columns == 0)
+        print_table_formatted(TABLE_COMPOSITE, format, processes, BENCH_PROCESSES, stream);
+    else
+        print_columns(format, columns, processes, BENCH_PROCESSES, stream);
+}
+
+/**
+ * Print the composite table of a synthetic snapshot of 1 000 000 rows to /dev/null BENCH_RUNS
+ * times in each format, and print the output size, the time taken and the throughput.
+ * Usage: formatBench [columns], e.g. formatBench pid,fd,filename,inode to time the writer of
+ * --columns rather than that of the composite table.
+ */
+int main(int argc, char **argv)
+{
+    unsigned int columns = 0;
+    if (argc > 1 && parse_columns(argv[1], &columns) != 0)
+    {
+        fprintf(stderr, "Usage: formatBench [columns], e.g. formatBench pid,fd,filename,inode\n");
+        return 1;
+    }
+    ProcessData **processes = (ProcessData **)malloc(sizeof(ProcessData *) * BENCH_PROCESSES);
+    srand(1);
+    for (int i = 0; i < BENCH_PROCESSES; i++)
+    {
+        processes[i] = (ProcessData *)calloc(1, sizeof(ProcessData));
+        processes[i]->pid = 1000 + i;
+        processes[i]->size = BENCH_FDS_PER_PROCESS;
+        processes[i]->fileDescriptors = (FileDescriptorEntry **)malloc(sizeof(FileDescriptorEntry *) * BENCH_FDS_PER_PROCESS);
+        for (unsigned long fd = 0; fd < BENCH_FDS_PER_PROCESS; fd++)
+            processes[i]->fileDescriptors[fd] = syntheticEntry(fd);
+    }
+
+    const char *formatNames[OUTPUT_FORMAT_COUNT] = {"text", "ndjson", "csv"};
+    printf("format   output size (bytes)   time (s)     throughput (GB/s)\n");
+    for (int format = 0; format < OUTPUT_FORMAT_COUNT; format++)
+    {
+        // measure the size once, outside of the timed runs
+        FILE *counter = tmpfile();
+        printFixture((OutputFormat)format, columns, processes, counter);
+        long bytes = ftell(counter);
+        fclose(counter);
+        for (int run = 0; run < BENCH_RUNS; run++)
+        {
+            FILE *stream = fopen("/dev/null", "w");
+            setvbuf(stream, NULL, _IOFBF, OUTPUT_BUFFER_SIZE);
+            double start = monotonicSeconds();
+            printFixture((OutputFormat)format, columns, processes, stream);
+            fflush(stream);
+            double elapsed = monotonicSeconds() - start;
+            fclose(stream);
+            printf("%-8s %-21ld %-12.3f %.2f\n", formatNames[format], bytes, elapsed, bytes / elapsed / 1e9);
+        }
+    }
+    freeProcesses(processes, BENCH_PROCESSES);
+    return 0;
+}
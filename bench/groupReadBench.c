@@ -0,0 +1,70 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "bench.h"
+
+#define BENCH_RUNS 5
+#define GROUP_FILE_BUFFER_SIZE 4096
+#define PROC_PATH_SIZE 64
+
+/**
+ * Time the syscalls --by-cgroup and --by-netns add for each process, made in a loop over every
+ * PID: open, read and close of /proc/<pid>/cgroup, and readlink of /proc/<pid>/ns/net.
+ * Usage: groupReadBench
+ */
+int main()
+{
+    size_t capacity = 1024;
+    size_t numPids = 0;
+    unsigned long *pids = (unsigned long *)malloc(sizeof(unsigned long) * capacity);
+    DIR *proc = opendir("/proc");
+    if (pids == NULL || proc == NULL)
+    {
+        perror("Error: Could not list /proc");
+        return 1;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(proc)) != NULL)
+    {
+        if (!isdigit((unsigned char)entry->d_name[0]))
+            continue;
+        if (numPids == capacity)
+        {
+            capacity *= 2;
+            pids = (unsigned long *)realloc(pids, sizeof(unsigned long) * capacity);
+            if (pids == NULL)
+                return 1;
+        }
+        pids[numPids++] = strtoul(entry->d_name, NULL, 10);
+    }
+    closedir(proc);
+
+    for (int run = 1; run <= BENCH_RUNS; run++)
+    {
+        double start = monotonicSeconds();
+        for (size_t i = 0; i < numPids; i++)
+        {
+            char path[PROC_PATH_SIZE];
+            char buffer[GROUP_FILE_BUFFER_SIZE];
+            snprintf(path, sizeof(path), "/proc/%lu/cgroup", pids[i]);
+            int fd = open(path, O_RDONLY);
+            if (fd >= 0)
+            {
+                if (read(fd, buffer, sizeof(buffer) - 1) < 0)
+                    buffer[0] = '\0';
+                close(fd);
+            }
+            snprintf(path, sizeof(path), "/proc/%lu/ns/net", pids[i]);
+            if (readlink(path, buffer, sizeof(buffer) - 1) < 0)
+                buffer[0] = '\0';
+        }
+        double elapsed = monotonicSeconds() - start;
+        printf("run %d: %zu processes, %.1f ms, %.2f us per process\n", run, numPids, elapsed * 1e3, elapsed / numPids * 1e6);
+    }
+    free(pids);
+    return 0;
+}
@@ -0,0 +1,21 @@
+#!/bin/bash
+# Scan with --latency-probe under several CPU budgets, 2 runs each, and print the time of each
+# run with the budget and latency lines tableViewer prints to stderr. Start a fixture first,
+# e.g. bench/fdFixture 5000 253 &
+# Usage: bench/latencyBudget.sh [path to tableViewer]
+tableViewer=${1:-./tableViewer}
+log=$(mktemp)
+trap 'rm -f "$log"' EXIT
+TIMEFORMAT=%R
+
+# the probe alone, scanning a single process, shows the timer delay of the host itself
+elapsed=$( { time "$tableViewer" 1 --per-process --latency-probe >/dev/null 2>"$log"; } 2>&1 )
+echo "probe only: $elapsed s | $(grep -h 'Latency' "$log")"
+for table in --per-process --composite; do
+    for budget in "" --budget=50 --budget=25 --budget=10; do
+        for run in 1 2; do
+            elapsed=$( { time "$tableViewer" $table $budget --latency-probe >/dev/null 2>"$log"; } 2>&1 )
+            echo "$table $budget: $elapsed s | $(grep -h 'Budget\|Latency' "$log" | tr '\n' ' ')"
+        done
+    done
+done
@@ -0,0 +1,105 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/prctl.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+
+// sockets per child process, under the hard limit of open files of most hosts
+#define SOCKETS_PER_CHILD 19000
+#define FIRST_PORT 20000
+
+/**
+ * Open listening TCP sockets on loopback in a child process, then sleep until the parent exits.
+ * Each child listens on its own address, 127.0.0.<child + 1>, so that ports do not run out.
+ * @param child Index of the child
+ * @param count Number of sockets to open
+ * @param ready Pipe to report the number of sockets opened to
+ */
+static void listenInChild(int child, int count, int ready)
+{
+    prctl(PR_SET_PDEATHSIG, SIGKILL);
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0)
+    {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+    int opened = 0;
+    for (; opened < count; opened++)
+    {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0)
+            break;
+        int reuse = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        struct sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_port = htons(FIRST_PORT + opened);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK + child);
+        if (bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(fd, 1) != 0)
+        {
+            close(fd);
+            break;
+        }
+    }
+    if (write(ready, &opened, sizeof(opened)) != sizeof(opened))
+        _exit(1);
+    while (1)
+        pause();
+}
+
+/**
+ * Open a number of listening TCP sockets across child processes, as a fixture for socketBench,
+ * then wait until killed, which also kills the children.
+ * Usage: openSockets <sockets>, e.g. openSockets 100000 &
+ */
+int main(int argc, char **argv)
+{
+    int total = argc > 1 ? atoi(argv[1]) : 0;
+    if (total <= 0)
+    {
+        fprintf(stderr, "Usage: openSockets <sockets>\n");
+        return 1;
+    }
+    int ready[2];
+    if (pipe(ready) != 0)
+    {
+        perror("Error: Could not create a pipe");
+        return 1;
+    }
+    int children = 0;
+    for (int first = 0; first < total; first += SOCKETS_PER_CHILD)
+    {
+        int count = total - first < SOCKETS_PER_CHILD ? total - first : SOCKETS_PER_CHILD;
+        pid_t pid = fork();
+        if (pid < 0)
+        {
+            perror("Error: Could not fork");
+            break;
+        }
+        if (pid == 0)
+        {
+            close(ready[0]);
+            listenInChild(children, count, ready[1]);
+        }
+        children++;
+    }
+    close(ready[1]);
+    int opened = 0;
+    for (int i = 0; i < children; i++)
+    {
+        int count;
+        if (read(ready[0], &count, sizeof(count)) == sizeof(count))
+            opened += count;
+    }
+    printf("ready: %d listening sockets in %d processes\n", opened, children);
+    fflush(stdout);
+    while (1)
+        pause();
+}
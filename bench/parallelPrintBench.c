@@ -0,0 +1,103 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "../processes.h"
+#include "../printTables.h"
+#include "../parallelPrint.h"
+#include "../readProcesses.h"
+#include "bench.h"
+
+// every 100th process holds LARGE_PROCESS_FDS file descriptors, and every 7th none
+#define BENCH_PROCESSES 10000
+#define BENCH_FDS_PER_PROCESS 200
+#define LARGE_PROCESS_FDS 4000
+#define BENCH_RUNS 3
+
+/**
+ * Generate a synthetic table of processes with a mix of files, sockets and pipes. The same
+ * table is generated on every run.
+ * @param numProcesses Number of processes to generate
+ * @param numRows Pointer to where the total number of file descriptors will be assigned to
+ * @return A dynamically-allocated array of processes
+ */
+static ProcessData **generateProcesses(int numProcesses, unsigned long *numRows)
+{
+    ProcessData **processes = (ProcessData **)malloc(sizeof(ProcessData *) * numProcesses);
+    *numRows = 0;
+    srand(1);
+    for (int i = 0; i < numProcesses; i++)
+    {
+        unsigned long size = i % 100 == 0 ? LARGE_PROCESS_FDS : i % 7 == 0 ? 0 : BENCH_FDS_PER_PROCESS;
+        processes[i] = (ProcessData *)calloc(1, sizeof(ProcessData));
+        processes[i]->pid = 1000 + i;
+        processes[i]->size = size;
+        processes[i]->fileDescriptors = (FileDescriptorEntry **)malloc(sizeof(FileDescriptorEntry *) * (size + 1));
+        for (unsigned long fd = 0; fd < size; fd++)
+            processes[i]->fileDescriptors[fd] = syntheticEntry(fd);
+        *numRows += size;
+    }
+    return processes;
+}
+
+/**
+ * Write the composite table of a synthetic fixture with print_table() once, then with
+ * print_table_parallel() BENCH_RUNS times for each thread count given, and print the time taken
+ * and rows per second. The output of each parallel run is compared to that of print_table().
+ * Usage: parallelPrintBench [output directory] [thread counts...], e.g. parallelPrintBench /tmp 1 2 4 8
+ */
+int main(int argc, char **argv)
+{
+    const char *directory = argc > 1 ? argv[1] : ".";
+    char sequentialPath[4096];
+    char parallelPath[4096];
+    snprintf(sequentialPath, sizeof(sequentialPath), "%s/sequential.txt", directory);
+    snprintf(parallelPath, sizeof(parallelPath), "%s/parallel.txt", directory);
+
+    unsigned long numRows;
+    ProcessData **processes = generateProcesses(BENCH_PROCESSES, &numRows);
+    printf("%d processes, %lu rows\n", BENCH_PROCESSES, numRows);
+    printf("threads      time (s)    rows/s (millions)\n");
+
+    FILE *stream = fopen(sequentialPath, "w");
+    if (stream == NULL)
+    {
+        perror("Error: Could not open output file");
+        return 1;
+    }
+    double start = monotonicSeconds();
+    print_table(print_composite_header, print_composite_content, print_composite_footer, processes, BENCH_PROCESSES, stream);
+    fclose(stream);
+    double elapsed = monotonicSeconds() - start;
+    printf("print_table  %.3f       %.1f\n", elapsed, numRows / elapsed / 1e6);
+
+    int defaultThreads[] = {1, 2, 4, 8};
+    int numThreadCounts = argc > 2 ? argc - 2 : 4;
+    int result = 0;
+    for (int t = 0; t < numThreadCounts; t++)
+    {
+        int threads = argc > 2 ? atoi(argv[t + 2]) : defaultThreads[t];
+        for (int run = 0; run < BENCH_RUNS; run++)
+        {
+            int fd = open(parallelPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (fd < 0)
+            {
+                perror("Error: Could not open output file");
+                return 1;
+            }
+            start = monotonicSeconds();
+            int failed = print_table_parallel(print_composite_header, print_composite_content, print_composite_footer, processes, BENCH_PROCESSES, fd, threads);
+            close(fd);
+            elapsed = monotonicSeconds() - start;
+            char command[8300];
+            snprintf(command, sizeof(command), "cmp -s %s %s", sequentialPath, parallelPath);
+            int identical = system(command) == 0;
+            printf("%-12d %.3f       %.1f%s\n", threads, elapsed, numRows / elapsed / 1e6,
+                   failed ? " (failed)" : identical ? "" : " (output differs)");
+            result |= failed || !identical;
+        }
+    }
+    freeProcesses(processes, BENCH_PROCESSES);
+    return result;
+}
@@ -0,0 +1,130 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "../processes.h"
+#include "../readProcesses.h"
+#include "../sharedSnapshot.h"
+#include "bench.h"
+
+#define BENCH_REGION "/tableViewerBench"
+#define BENCH_PROCESSES 1000
+#define BENCH_FDS_PER_PROCESS 10
+#define BENCH_SECONDS 3.0
+#define PUBLISH_INTERVAL_NS 10000000
+#define MAX_READERS 64
+
+/**
+ * Reads of one reader thread
+ */
+typedef struct ReaderStats
+{
+    double totalSeconds;
+    double maxSeconds;
+    unsigned long reads;
+} ReaderStats;
+
+static volatile int stopReading = 0;
+
+/**
+ * Read the snapshot in a tight loop until stopReading is set.
+ * @param argument The ReaderStats of the thread
+ * @return NULL
+ */
+static void *readLoop(void *argument)
+{
+    ReaderStats *stats = (ReaderStats *)argument;
+    SharedSnapshotReader *reader = openSharedSnapshot(BENCH_REGION);
+    if (reader == NULL)
+        return NULL;
+    SharedSnapshot snapshot;
+    memset(&snapshot, 0, sizeof(SharedSnapshot));
+    while (!stopReading)
+    {
+        double start = monotonicSeconds();
+        readSharedSnapshot(reader, &snapshot);
+        double elapsed = monotonicSeconds() - start;
+        stats->totalSeconds += elapsed;
+        stats->reads++;
+        if (elapsed > stats->maxSeconds)
+            stats->maxSeconds = elapsed;
+    }
+    freeSharedSnapshot(&snapshot);
+    closeSharedSnapshot(reader);
+    return NULL;
+}
+
+/**
+ * Publish a snapshot of 1 000 processes with 10 file descriptors each every 10 ms for 3 seconds,
+ * while reader threads read it in a tight loop, and print the average publish and read times.
+ * Usage: sharedSnapshotBench [readers], e.g. sharedSnapshotBench 16
+ */
+int main(int argc, char **argv)
+{
+    int numReaders = argc > 1 ? atoi(argv[1]) : 1;
+    if (numReaders < 1 || numReaders > MAX_READERS)
+    {
+        fprintf(stderr, "Usage: sharedSnapshotBench [readers], with 1 to %d readers\n", MAX_READERS);
+        return 1;
+    }
+    ProcessData **processes = (ProcessData **)malloc(sizeof(ProcessData *) * BENCH_PROCESSES);
+    for (int i = 0; i < BENCH_PROCESSES; i++)
+    {
+        processes[i] = (ProcessData *)calloc(1, sizeof(ProcessData));
+        processes[i]->pid = i + 1;
+        processes[i]->size = BENCH_FDS_PER_PROCESS;
+        processes[i]->fileDescriptors = (FileDescriptorEntry **)malloc(sizeof(FileDescriptorEntry *) * BENCH_FDS_PER_PROCESS);
+        for (int fd = 0; fd < BENCH_FDS_PER_PROCESS; fd++)
+        {
+            FileDescriptorEntry *entry = (FileDescriptorEntry *)calloc(1, sizeof(FileDescriptorEntry));
+            entry->fd = fd;
+            entry->inode = fd * 7;
+            entry->filename = strdup("/var/log/application/service-name/current.log");
+            entry->type = FD_TYPE_FILE;
+            processes[i]->fileDescriptors[fd] = entry;
+        }
+    }
+
+    SharedSnapshotPublisher *publisher = createSharedSnapshotPublisher(BENCH_REGION);
+    if (publisher == NULL || publishSharedSnapshot(publisher, processes, BENCH_PROCESSES) != 0)
+    {
+        fprintf(stderr, "Error: Could not publish to %s.\n", BENCH_REGION);
+        return 1;
+    }
+    pthread_t threads[MAX_READERS];
+    ReaderStats stats[MAX_READERS];
+    memset(stats, 0, sizeof(stats));
+    for (int i = 0; i < numReaders; i++)
+        pthread_create(&threads[i], NULL, readLoop, &stats[i]);
+
+    double publishSeconds = 0;
+    unsigned long publishes = 0;
+    double end = monotonicSeconds() + BENCH_SECONDS;
+    while (monotonicSeconds() < end)
+    {
+        double start = monotonicSeconds();
+        publishSharedSnapshot(publisher, processes, BENCH_PROCESSES);
+        publishSeconds += monotonicSeconds() - start;
+        publishes++;
+        struct timespec interval = {0, PUBLISH_INTERVAL_NS};
+        nanosleep(&interval, NULL);
+    }
+    stopReading = 1;
+
+    ReaderStats total = {0, 0, 0};
+    for (int i = 0; i < numReaders; i++)
+    {
+        pthread_join(threads[i], NULL);
+        total.totalSeconds += stats[i].totalSeconds;
+        total.reads += stats[i].reads;
+        if (stats[i].maxSeconds > total.maxSeconds)
+            total.maxSeconds = stats[i].maxSeconds;
+    }
+    printf("readers %d: publish avg %.1f us over %lu publishes, read avg %.1f us over %lu reads, max %.0f us\n", numReaders,
+           publishSeconds / publishes * 1e6, publishes, total.reads > 0 ? total.totalSeconds / total.reads * 1e6 : 0.0, total.reads,
+           total.maxSeconds * 1e6);
+    closeSharedSnapshotPublisher(publisher, 1);
+    freeProcesses(processes, BENCH_PROCESSES);
+    return 0;
+}
@@ -0,0 +1,93 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../processes.h"
+#include "../readSockets.h"
+#include "bench.h"
+
+#define BENCH_RUNS 5
+#define PROC_NET_TCP_LINE_SIZE 512
+
+/**
+ * Read /proc/net/tcp into SocketInfo structs with sscanf, as tableViewer could do instead of
+ * asking sock_diag.
+ * @param numSockets Pointer to where the number of sockets read will be assigned to
+ * @return A dynamically-allocated array of sockets, NULL if /proc/net/tcp could not be read
+ */
+static SocketInfo *parseProcNetTcp(size_t *numSockets)
+{
+    *numSockets = 0;
+    FILE *file = fopen("/proc/net/tcp", "r");
+    if (file == NULL)
+        return NULL;
+    size_t capacity = 1024;
+    SocketInfo *sockets = (SocketInfo *)malloc(sizeof(SocketInfo) * capacity);
+    char line[PROC_NET_TCP_LINE_SIZE];
+    // skip the heading
+    if (fgets(line, sizeof(line), file) == NULL)
+        line[0] = '\0';
+    while (sockets != NULL && fgets(line, sizeof(line), file) != NULL)
+    {
+        unsigned int localAddress, localPort, remoteAddress, remotePort, state, sendQueue, receiveQueue;
+        unsigned long inode;
+        if (sscanf(line, "%*d: %x:%x %x:%x %x %x:%x %*x:%*x %*x %*u %*u %lu", &localAddress, &localPort, &remoteAddress,
+                   &remotePort, &state, &sendQueue, &receiveQueue, &inode) != 8)
+            continue;
+        if (*numSockets == capacity)
+        {
+            capacity *= 2;
+            SocketInfo *grown = (SocketInfo *)realloc(sockets, sizeof(SocketInfo) * capacity);
+            if (grown == NULL)
+            {
+                free(sockets);
+                sockets = NULL;
+                break;
+            }
+            sockets = grown;
+        }
+        SocketInfo *socket = &sockets[(*numSockets)++];
+        memset(socket, 0, sizeof(SocketInfo));
+        socket->inode = inode;
+        socket->state = state;
+        socket->sendQueue = sendQueue;
+        socket->receiveQueue = receiveQueue;
+        socket->localPort = localPort;
+        socket->remotePort = remotePort;
+        memcpy(socket->localAddress, &localAddress, 4);
+        memcpy(socket->remoteAddress, &remoteAddress, 4);
+    }
+    fclose(file);
+    return sockets;
+}
+
+/**
+ * Time fetchSockets() against parsing /proc/net/tcp, BENCH_RUNS times each. Open many sockets
+ * first with openSockets, e.g. openSockets 100000.
+ * Usage: socketBench
+ */
+int main()
+{
+    printf("run   sock_diag (ms)   sockets   /proc/net/tcp (ms)   sockets\n");
+    for (int run = 1; run <= BENCH_RUNS; run++)
+    {
+        double start = monotonicSeconds();
+        SocketTable *table = fetchSockets();
+        double diagTime = monotonicSeconds() - start;
+        if (table == NULL)
+        {
+            perror("Error: Could not read sockets from sock_diag");
+            return 1;
+        }
+        size_t diagSockets = table->size;
+        freeSockets(table);
+
+        size_t textSockets;
+        start = monotonicSeconds();
+        SocketInfo *sockets = parseProcNetTcp(&textSockets);
+        double textTime = monotonicSeconds() - start;
+        free(sockets);
+        printf("%-5d %-16.1f %-9zu %-20.1f %zu\n", run, diagTime * 1e3, diagSockets, textTime * 1e3, textSockets);
+    }
+    return 0;
+}
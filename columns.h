@@ -0,0 +1,59 @@
+#ifndef COLUMNS_H
+#define COLUMNS_H
+
+#include "processes.h"
+
+/**
+ * Schema of every column that can be printed, in the order columns are printed.
+ * X(name, header, kind, value) where:
+ *  - name is the column name, as used by --columns and by the NDJSON and CSV writers
+ *  - header is the heading of the column in plain-text tables
+ *  - kind tells writers how to encode the value: ROW_NUMBER and PROCESS_NUMBER are numbers that
+ *    the binary format stores once per process, NUMBER, STRING, TYPE (a FileDescriptorType) and
+ *    SOCKET (a SocketInfo pointer) are stored in every row
+ *  - value is an expression of the value, in terms of the ProcessData *process being printed,
+ *    the index row of the file descriptor within it and its FileDescriptorEntry *entry
+ */
+#define TABLE_COLUMNS(X)                                 \
+    X(index, "", ROW_NUMBER, (unsigned long)(row + 1))  \
+    X(pid, "PID", PROCESS_NUMBER, process->pid)          \
+    X(fd, "FD", NUMBER, entry->fd)                       \
+    X(filename, "filename", STRING, entry->filename)     \
+    X(inode, "inode", NUMBER, entry->inode)              \
+    X(dev, "dev", NUMBER, entry->dev)                    \
+    X(type, "type", TYPE, entry->type)                   \
+    X(socket, "socket", SOCKET, entry->socket)
+
+#define COLUMN_BIT(name, header, kind, value) COLUMN_BIT_##name,
+
+/**
+ * Position of each column in the schema, which is also its bit in a column mask
+ */
+typedef enum ColumnBit
+{
+    TABLE_COLUMNS(COLUMN_BIT)
+    COLUMN_COUNT
+} ColumnBit;
+
+#undef COLUMN_BIT
+
+#define COLUMN_MASK(name) (1u << COLUMN_BIT_##name)
+#define COLUMN_MASK_COUNT (1u << COLUMN_COUNT)
+
+// columns of each of the fixed tables
+#define PER_PROCESS_COLUMNS (COLUMN_MASK(pid) | COLUMN_MASK(fd))
+#define SYSTEM_WIDE_COLUMNS (COLUMN_MASK(pid) | COLUMN_MASK(fd) | COLUMN_MASK(filename) | COLUMN_MASK(socket))
+#define VNODES_COLUMNS (COLUMN_MASK(pid) | COLUMN_MASK(inode))
+#define COMPOSITE_COLUMNS (COLUMN_MASK(index) | COLUMN_MASK(pid) | COLUMN_MASK(fd) | COLUMN_MASK(filename) | COLUMN_MASK(inode))
+
+// columns of every table, e.g. to resolve every field of a file descriptor
+#define ALL_COLUMNS (COLUMN_MASK_COUNT - 1)
+
+// columns read by the shared memory snapshot and the sampling history
+#define SHARED_SNAPSHOT_COLUMNS (COLUMN_MASK(pid) | COLUMN_MASK(fd) | COLUMN_MASK(filename) | COLUMN_MASK(inode) | COLUMN_MASK(type))
+#define HISTORY_COLUMNS (COLUMN_MASK(pid) | COLUMN_MASK(type))
+
+// columns the binary format stores in the header of each process rather than in each row
+#define PROCESS_COLUMNS (COLUMN_MASK(index) | COLUMN_MASK(pid))
+
+#endif
@@ -0,0 +1,110 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "processes.h"
+#include "fdCountCache.h"
+
+/**
+ * Load the counts of a previous scan. A missing or invalid file gives an empty cache, as on the
+ * first run.
+ * @param fileName Path of the cache file
+ * @return The counts, NULL if they could not be allocated
+ */
+FdCountCache *loadFdCountCache(const char *fileName)
+{
+    FdCountCache *cache = (FdCountCache *)calloc(1, sizeof(FdCountCache));
+    if (cache == NULL)
+        return NULL;
+    FILE *file = fopen(fileName, "rb");
+    if (file == NULL)
+        return cache;
+    FdCountCacheHeader header;
+    if (fread(&header, sizeof(header), 1, file) == 1 && header.magic == FD_COUNT_CACHE_MAGIC &&
+        header.version == FD_COUNT_CACHE_VERSION && header.numCounts > 0)
+    {
+        cache->counts = (FdCount *)malloc(sizeof(FdCount) * header.numCounts);
+        if (cache->counts != NULL && fread(cache->counts, sizeof(FdCount), header.numCounts, file) == header.numCounts)
+            cache->size = header.numCounts;
+    }
+    fclose(file);
+    return cache;
+}
+
+/**
+ * Free the counts of a previous scan.
+ * @param cache Counts to free, may be NULL
+ */
+void freeFdCountCache(FdCountCache *cache)
+{
+    if (cache == NULL)
+        return;
+    free(cache->counts);
+    free(cache);
+}
+
+/**
+ * Find the number of file descriptors a process had in the previous scan.
+ * @param cache Counts of the previous scan
+ * @param pid PID of the process
+ * @return The number of file descriptors, 0 if the process was not scanned
+ */
+unsigned long lookupFdCount(const FdCountCache *cache, unsigned long pid)
+{
+    unsigned long low = 0;
+    unsigned long high = cache->size;
+    while (low < high)
+    {
+        unsigned long middle = low + (high - low) / 2;
+        if (cache->counts[middle].pid < pid)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low < cache->size && cache->counts[low].pid == pid ? cache->counts[low].count : 0;
+}
+
+/**
+ * Order counts by PID
+ */
+static int compareCounts(const void *a, const void *b)
+{
+    const FdCount *first = (const FdCount *)a;
+    const FdCount *second = (const FdCount *)b;
+    return first->pid < second->pid ? -1 : first->pid > second->pid ? 1 : 0;
+}
+
+/**
+ * Save the numbers of file descriptors found by a scan, for the next run to size its arrays with.
+ * @param fileName Path of the cache file, replaced if it exists
+ * @param processes An array of scanned processes
+ * @param numProcesses The size of the processes array.
+ * @return 0 if operation was successful, nonzero otherwise
+ */
+int saveFdCountCache(const char *fileName, ProcessData **processes, int numProcesses)
+{
+    FdCount *counts = (FdCount *)malloc(sizeof(FdCount) * (numProcesses + 1));
+    if (counts == NULL)
+        return 1;
+    unsigned long numCounts = 0;
+    for (int i = 0; i < numProcesses; i++)
+    {
+        if (processes[i]->sizeHint == 0)
+            continue;
+        counts[numCounts].pid = processes[i]->pid;
+        counts[numCounts].count = processes[i]->sizeHint;
+        numCounts++;
+    }
+    qsort(counts, numCounts, sizeof(FdCount), compareCounts);
+
+    FILE *file = fopen(fileName, "wb");
+    if (file == NULL)
+    {
+        free(counts);
+        return 1;
+    }
+    FdCountCacheHeader header = {FD_COUNT_CACHE_MAGIC, FD_COUNT_CACHE_VERSION, numCounts};
+    int result = fwrite(&header, sizeof(header), 1, file) != 1 || fwrite(counts, sizeof(FdCount), numCounts, file) != numCounts;
+    result |= fclose(file) != 0;
+    free(counts);
+    return result;
+}
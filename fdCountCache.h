@@ -0,0 +1,47 @@
+#ifndef FD_COUNT_CACHE_H
+#define FD_COUNT_CACHE_H
+
+#include "processes.h"
+
+// "TVC1", the first 4 bytes of count caches
+#define FD_COUNT_CACHE_MAGIC 0x31435654u
+#define FD_COUNT_CACHE_VERSION 1u
+
+/**
+ * Number of file descriptors a process had in a previous scan
+ */
+typedef struct FdCount
+{
+    unsigned long pid;
+    unsigned long count;
+} FdCount;
+
+/**
+ * Start of a count cache file. It is followed by numCounts FdCount sorted by PID.
+ */
+typedef struct FdCountCacheHeader
+{
+    unsigned int magic;
+    unsigned int version;
+    unsigned long numCounts;
+} FdCountCacheHeader;
+
+/**
+ * Numbers of file descriptors of the processes of a previous scan, sorted by PID. They stand in
+ * for the size of /proc/<pid>/fd on kernels where it is always 0.
+ */
+typedef struct FdCountCache
+{
+    FdCount *counts;
+    unsigned long size;
+} FdCountCache;
+
+extern FdCountCache *loadFdCountCache(const char *fileName);
+
+extern void freeFdCountCache(FdCountCache *cache);
+
+extern unsigned long lookupFdCount(const FdCountCache *cache, unsigned long pid);
+
+extern int saveFdCountCache(const char *fileName, ProcessData **processes, int numProcesses);
+
+#endif
@@ -0,0 +1,293 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#include "processes.h"
+#include "readProcesses.h"
+#include "stringUtils.h"
+#include "fdHistory.h"
+
+// smoothing factors of Holt's linear trend method, for the level and the trend
+#define FD_LEVEL_SMOOTHING 0.5
+#define FD_TREND_SMOOTHING 0.3
+
+/**
+ * Read the monotonic clock.
+ * @return Seconds since an arbitrary point in the past
+ */
+static double monotonicSeconds()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/**
+ * Compute the slot at which probing starts for a PID.
+ * @param pid Process identifier
+ * @return Index of the first slot to probe
+ */
+static size_t historySlot(unsigned long pid)
+{
+    return (size_t)((pid * 0x9E3779B97F4A7C15ul) >> 32) & (FD_HISTORY_MAX_PROCESSES - 1);
+}
+
+/**
+ * Allocate an empty history. All memory is allocated here, so the history never grows afterwards.
+ * @return If successful, a dynamically-allocated history. NULL otherwise.
+ */
+FdHistory *createFdHistory()
+{
+    FdHistory *history = (FdHistory *)malloc(sizeof(FdHistory));
+    if (history == NULL)
+        return NULL;
+    history->slots = (ProcessHistory *)calloc(FD_HISTORY_MAX_PROCESSES, sizeof(ProcessHistory));
+    if (history->slots == NULL)
+    {
+        free(history);
+        return NULL;
+    }
+    history->size = 0;
+    history->sampleNumber = 0;
+    history->dropped = 0;
+    history->startTime = monotonicSeconds();
+    return history;
+}
+
+/**
+ * Free memory used to store a history
+ * @param history History to free
+ */
+void freeFdHistory(FdHistory *history)
+{
+    if (history == NULL)
+        return;
+    free(history->slots);
+    free(history);
+}
+
+/**
+ * Look up the history of a process.
+ * @param history History to search
+ * @param pid Process identifier
+ * @return Pointer to the history of the process if it is tracked, NULL otherwise
+ */
+ProcessHistory *findProcessHistory(FdHistory *history, unsigned long pid)
+{
+    size_t slot = historySlot(pid);
+    while (history->slots[slot].pid != 0)
+    {
+        if (history->slots[slot].pid == pid)
+            return &history->slots[slot];
+        slot = (slot + 1) & (FD_HISTORY_MAX_PROCESSES - 1);
+    }
+    return NULL;
+}
+
+/**
+ * Find the history of a process, claiming an empty slot for it if it is not tracked yet.
+ * The history of an earlier process with the same PID is cleared.
+ * @param history History to search
+ * @param pid Process identifier
+ * @param startTime Start time of the process, which tells apart processes reusing a PID. 0 if it
+ * could not be read, in which case the process is assumed to be the one already tracked.
+ * @return Pointer to the history of the process, or NULL if the table is full
+ */
+static ProcessHistory *claimProcessHistory(FdHistory *history, unsigned long pid, unsigned long startTime)
+{
+    ProcessHistory *found = findProcessHistory(history, pid);
+    if (found != NULL && startTime != 0 && found->startTime != startTime)
+    {
+        // a start time that could not be read before is only filled in
+        if (found->startTime != 0)
+        {
+            memset(found, 0, sizeof(ProcessHistory));
+            found->pid = pid;
+        }
+        found->startTime = startTime;
+    }
+    if (found != NULL)
+        return found;
+    // keep one slot in four free so that probe sequences stay short
+    if ((history->size + 1) * 4 > FD_HISTORY_MAX_PROCESSES * 3)
+        return NULL;
+    size_t slot = historySlot(pid);
+    while (history->slots[slot].pid != 0)
+        slot = (slot + 1) & (FD_HISTORY_MAX_PROCESSES - 1);
+    memset(&history->slots[slot], 0, sizeof(ProcessHistory));
+    history->slots[slot].pid = pid;
+    history->slots[slot].startTime = startTime;
+    history->size++;
+    return &history->slots[slot];
+}
+
+/**
+ * Remove processes that were not seen in the latest sample. Entries following a removed
+ * slot are shifted back so that lookups never need tombstones.
+ * @param history History to sweep
+ */
+static void evictExitedProcesses(FdHistory *history)
+{
+    for (size_t slot = 0; slot < FD_HISTORY_MAX_PROCESSES; slot++)
+    {
+        if (history->slots[slot].pid == 0 || history->slots[slot].lastSeen == history->sampleNumber)
+            continue;
+        history->slots[slot].pid = 0;
+        history->size--;
+        // backward-shift deletion: move later entries of the probe run into the hole
+        size_t hole = slot;
+        size_t next = (slot + 1) & (FD_HISTORY_MAX_PROCESSES - 1);
+        while (history->slots[next].pid != 0)
+        {
+            size_t home = historySlot(history->slots[next].pid);
+            // move the entry if its home slot is not within (hole, next]
+            if (((next - home) & (FD_HISTORY_MAX_PROCESSES - 1)) >= ((next - hole) & (FD_HISTORY_MAX_PROCESSES - 1)))
+            {
+                history->slots[hole] = history->slots[next];
+                history->slots[next].pid = 0;
+                hole = next;
+            }
+            next = (next + 1) & (FD_HISTORY_MAX_PROCESSES - 1);
+        }
+        // the entry shifted into this slot has not been checked yet
+        if (hole != slot)
+            slot--;
+    }
+}
+
+/**
+ * Append a sample to the ring buffer of a process and update its growth estimate.
+ * @param process History of the process
+ * @param sample Counts of the process at this sample
+ */
+static void appendSample(ProcessHistory *process, FdSample *sample)
+{
+    if (process->count == 0)
+    {
+        process->level = sample->total;
+        process->trend = 0;
+        memset(process->trendByType, 0, sizeof(process->trendByType));
+    }
+    else
+    {
+        FdSample *previous = &process->samples[(process->head + process->count - 1) % FD_HISTORY_LENGTH];
+        double elapsed = sample->time - previous->time;
+        if (elapsed <= 0)
+            elapsed = 1e-3;
+        // Holt's linear trend: smooth the level, then smooth the per-second change of the level
+        double previousLevel = process->level;
+        process->level = FD_LEVEL_SMOOTHING * sample->total + (1 - FD_LEVEL_SMOOTHING) * (previousLevel + process->trend * elapsed);
+        process->trend = FD_TREND_SMOOTHING * (process->level - previousLevel) / elapsed + (1 - FD_TREND_SMOOTHING) * process->trend;
+        for (int type = 0; type < FD_TYPE_COUNT; type++)
+        {
+            double change = ((double)sample->byType[type] - (double)previous->byType[type]) / elapsed;
+            process->trendByType[type] = FD_TREND_SMOOTHING * change + (1 - FD_TREND_SMOOTHING) * process->trendByType[type];
+        }
+    }
+
+    if (process->count < FD_HISTORY_LENGTH)
+    {
+        process->samples[(process->head + process->count) % FD_HISTORY_LENGTH] = *sample;
+        process->count++;
+    }
+    else
+    {
+        // overwrite the oldest sample
+        process->samples[process->head] = *sample;
+        process->head = (process->head + 1) % FD_HISTORY_LENGTH;
+    }
+    process->recorded++;
+}
+
+/**
+ * Record the file descriptor counts of all given processes as one sample, and forget
+ * processes that are no longer running.
+ * @param history History to record into
+ * @param processes An array of all processes, with file descriptors read
+ * @param numProcesses The size of the processes array.
+ */
+void recordFdSample(FdHistory *history, ProcessData **processes, int numProcesses)
+{
+    history->sampleNumber++;
+    double time = monotonicSeconds() - history->startTime;
+    for (int i = 0; i < numProcesses; i++)
+    {
+        ProcessHistory *process = claimProcessHistory(history, processes[i]->pid, readProcessStartTime(processes[i]->pid));
+        if (process == NULL)
+        {
+            history->dropped++;
+            continue;
+        }
+        FdSample sample;
+        memset(&sample, 0, sizeof(sample));
+        sample.time = time;
+        sample.total = processes[i]->size;
+        for (unsigned long fd = 0; fd < processes[i]->size; fd++)
+        {
+            sample.byType[processes[i]->fileDescriptors[fd]->type]++;
+        }
+        appendSample(process, &sample);
+        process->lastSeen = history->sampleNumber;
+    }
+    evictExitedProcesses(history);
+}
+
+/**
+ * Decide whether the file descriptor count of a process is trending upward. The smoothed
+ * trend must be positive, and the count must have grown across the samples kept.
+ * @param process History of the process
+ * @return 1 if the process is growing, 0 otherwise
+ */
+int isFdCountGrowing(ProcessHistory *process)
+{
+    if (process->count < FD_TREND_MIN_SAMPLES || process->trend <= 0)
+        return 0;
+    FdSample *oldest = &process->samples[process->head];
+    FdSample *newest = &process->samples[(process->head + process->count - 1) % FD_HISTORY_LENGTH];
+    return newest->total > oldest->total;
+}
+
+/**
+ * Print all processes whose file descriptor count is trending upward, with their growth
+ * rate and the projected time until they reach their open file limit (RLIMIT_NOFILE).
+ * @param history History to report on
+ * @param stream Stream to output plain-text to
+ */
+void printGrowingProcesses(FdHistory *history, FILE *stream)
+{
+    int found = 0;
+    fprintf(stream, "## Growing processes (sample %lu, %zu tracked):\n", history->sampleNumber, history->size);
+    for (size_t slot = 0; slot < FD_HISTORY_MAX_PROCESSES; slot++)
+    {
+        ProcessHistory *process = &history->slots[slot];
+        if (process->pid == 0 || !isFdCountGrowing(process))
+            continue;
+        found = 1;
+        FdSample *newest = &process->samples[(process->head + process->count - 1) % FD_HISTORY_LENGTH];
+        fprintf(stream, "%lu (%u, %+.2f/s", process->pid, newest->total, process->trend);
+        for (int type = 0; type < FD_TYPE_COUNT; type++)
+        {
+            if (process->trendByType[type] > 0)
+                fprintf(stream, ", %s %+.2f/s", fileDescriptorTypeName((FileDescriptorType)type), process->trendByType[type]);
+        }
+
+        struct rlimit limit;
+        if (prlimit(process->pid, RLIMIT_NOFILE, NULL, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY)
+        {
+            double remaining = limit.rlim_cur > newest->total ? (double)(limit.rlim_cur - newest->total) / process->trend : 0;
+            fprintf(stream, ", limit %lu in %.0fs", (unsigned long)limit.rlim_cur, remaining);
+        }
+        fprintf(stream, ")\n");
+    }
+    if (!found)
+    {
+        fprintf(stream, "None!\n");
+    }
+    if (history->dropped > 0)
+    {
+        fprintf(stream, "Warning: %lu process samples dropped, more than %d processes running.\n", history->dropped, FD_HISTORY_MAX_PROCESSES * 3 / 4);
+    }
+}
@@ -0,0 +1,118 @@
+#ifndef FD_HISTORY_H
+#define FD_HISTORY_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include "processes.h"
+
+#define FD_HISTORY_LENGTH 32
+#define FD_HISTORY_MAX_PROCESSES 16384
+#define FD_TREND_MIN_SAMPLES 4
+
+/**
+ * File descriptor counts of a process at one point in time
+ */
+typedef struct FdSample
+{
+    /**
+     * Seconds since the history was created. A double keeps sub-millisecond resolution over runs
+     * lasting weeks.
+    */
+    double time;
+    /**
+     * Total number of file descriptors
+    */
+    unsigned int total;
+    /**
+     * Number of file descriptors of each FileDescriptorType
+    */
+    unsigned int byType[FD_TYPE_COUNT];
+} FdSample;
+
+/**
+ * Ring buffer of the most recent samples of a process, with a streaming estimate of its growth
+ */
+typedef struct ProcessHistory
+{
+    /**
+     * Process identifier (PID), 0 if the slot is empty
+    */
+    unsigned long pid;
+    /**
+     * Start time of the process in clock ticks since boot, 0 if it could not be read. A different
+     * start time under the same PID means the PID was reused by another process, and its history
+     * is started over.
+    */
+    unsigned long startTime;
+    /**
+     * Number of the last sample in which the process was seen
+    */
+    unsigned long lastSeen;
+    /**
+     * Index in samples of the oldest sample
+    */
+    unsigned int head;
+    /**
+     * Number of valid samples, at most FD_HISTORY_LENGTH
+    */
+    unsigned int count;
+    /**
+     * Total number of samples recorded for the process, including those overwritten
+    */
+    unsigned long recorded;
+    /**
+     * Smoothed file descriptor count (Holt's linear trend level)
+    */
+    double level;
+    /**
+     * Smoothed growth in file descriptors per second (Holt's linear trend)
+    */
+    double trend;
+    /**
+     * Smoothed growth per second of each FileDescriptorType
+    */
+    double trendByType[FD_TYPE_COUNT];
+    FdSample samples[FD_HISTORY_LENGTH];
+} ProcessHistory;
+
+/**
+ * Fixed-size table of process histories keyed by PID
+ */
+typedef struct FdHistory
+{
+    /**
+     * Slots of the table, of length FD_HISTORY_MAX_PROCESSES
+    */
+    ProcessHistory *slots;
+    /**
+     * Number of occupied slots
+    */
+    size_t size;
+    /**
+     * Number of samples recorded so far
+    */
+    unsigned long sampleNumber;
+    /**
+     * Number of processes that could not be tracked because the table was full
+    */
+    unsigned long dropped;
+    /**
+     * Monotonic time at which the history was created, in seconds
+    */
+    double startTime;
+} FdHistory;
+
+extern FdHistory *createFdHistory();
+
+extern void freeFdHistory(FdHistory *history);
+
+extern void recordFdSample(FdHistory *history, ProcessData **processes, int numProcesses);
+
+extern ProcessHistory *findProcessHistory(FdHistory *history, unsigned long pid);
+
+extern int isFdCountGrowing(ProcessHistory *process);
+
+extern void printGrowingProcesses(FdHistory *history, FILE *stream);
+
+#endif
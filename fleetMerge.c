@@ -0,0 +1,613 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <limits.h>
+#include <sys/stat.h>
+
+#include "processes.h"
+#include "columns.h"
+#include "stringUtils.h"
+#include "snapshotStream.h"
+#include "fleetMerge.h"
+
+#define MERGE_OUTPUT_BUFFER_SIZE (1 << 20)
+
+/**
+ * Position of a merge in one input: the process and row read last
+ */
+typedef struct MergeCursor
+{
+    SnapshotStream stream;
+    const MergeInput *input;
+    unsigned long pid;
+    FileDescriptorEntry entry;
+    /**
+     * Whether a row was read yet, so that the next one must come after it
+    */
+    int started;
+} MergeCursor;
+
+/**
+ * Contiguous range of nodes merged by one thread into its own segment of the fleet index. Nodes
+ * are never split between threads, so segments can be concatenated in order.
+ */
+typedef struct MergeSegment
+{
+    const MergeInput *inputs;
+    /**
+     * Indexes of the first input of each node, with one more entry past the last node
+    */
+    const int *nodeStarts;
+    int firstNode;
+    int endNode;
+    /**
+     * File the rows are written to, and its length once merged
+    */
+    char fileName[1024];
+    unsigned long length;
+    unsigned long rows;
+    /**
+     * Aggregates of all nodes, only those of firstNode..endNode-1 are assigned by this segment
+    */
+    NodeAggregate *aggregates;
+    int failed;
+} MergeSegment;
+
+/**
+ * Parse an input given as <node>:<path>.
+ * @param argument Argument to parse
+ * @param order Position of the argument on the command line
+ * @param input Input to assign the node ID and path to
+ * @return 0 if operation was successful, -1 if the node ID is missing or too long
+ */
+int parseMergeInput(const char *argument, int order, MergeInput *input)
+{
+    const char *separator = strchr(argument, ':');
+    if (separator == NULL || separator == argument || separator - argument >= NODE_ID_SIZE || separator[1] == '\0')
+    {
+        fprintf(stderr, "Error: %s is not <node>:<path>, with a node ID of at most %d characters.\n", argument, NODE_ID_SIZE - 1);
+        return -1;
+    }
+    memset(input->node, 0, NODE_ID_SIZE);
+    memcpy(input->node, argument, separator - argument);
+    input->path = separator + 1;
+    input->order = order;
+    return 0;
+}
+
+/**
+ * Order inputs by node ID, then by position on the command line
+ */
+static int compareInputs(const void *a, const void *b)
+{
+    const MergeInput *first = (const MergeInput *)a;
+    const MergeInput *second = (const MergeInput *)b;
+    int byNode = strcmp(first->node, second->node);
+    return byNode != 0 ? byNode : first->order - second->order;
+}
+
+/**
+ * Whether the row of cursor a comes before that of cursor b. Of rows with the same (pid, fd),
+ * the one of the later input comes first, so that it is the one kept.
+ */
+static int cursorBefore(const MergeCursor *a, const MergeCursor *b)
+{
+    if (a->pid != b->pid)
+        return a->pid < b->pid;
+    if (a->entry.fd != b->entry.fd)
+        return a->entry.fd < b->entry.fd;
+    return a->input->order > b->input->order;
+}
+
+/**
+ * Move a cursor to the next row of its input, skipping processes without rows.
+ * @param cursor Cursor to advance
+ * @return 1 if a row was read, 0 at the end of the input, -1 if the input is truncated or not
+ * sorted by (pid, fd)
+ */
+static int advanceCursor(MergeCursor *cursor)
+{
+    unsigned long previousPid = cursor->pid;
+    unsigned long previousFd = cursor->entry.fd;
+    int result = readSnapshotRow(&cursor->stream, &cursor->entry);
+    while (result == 0)
+    {
+        ProcessData process;
+        result = readSnapshotProcess(&cursor->stream, &process);
+        if (result <= 0)
+            break;
+        cursor->pid = process.pid;
+        result = readSnapshotRow(&cursor->stream, &cursor->entry);
+    }
+    if (result < 0)
+        fprintf(stderr, "Error: %s is truncated.\n", cursor->input->path);
+    if (result > 0 && cursor->started && (cursor->pid < previousPid || (cursor->pid == previousPid && cursor->entry.fd <= previousFd)))
+    {
+        fprintf(stderr, "Error: %s is not sorted by PID and file descriptor.\n", cursor->input->path);
+        return -1;
+    }
+    cursor->started = 1;
+    return result;
+}
+
+/**
+ * Move the cursor at index down a binary min-heap until it is before both of its children.
+ */
+static void siftDown(MergeCursor **heap, int size, int index)
+{
+    while (1)
+    {
+        int smallest = index;
+        int left = 2 * index + 1;
+        int right = left + 1;
+        if (left < size && cursorBefore(heap[left], heap[smallest]))
+            smallest = left;
+        if (right < size && cursorBefore(heap[right], heap[smallest]))
+            smallest = right;
+        if (smallest == index)
+            return;
+        MergeCursor *swap = heap[index];
+        heap[index] = heap[smallest];
+        heap[smallest] = swap;
+        index = smallest;
+    }
+}
+
+/**
+ * Merge the inputs of one node into the rows of a segment. Only one row per input is held in
+ * memory at a time.
+ * @param segment Segment being written
+ * @param node Index of the node
+ * @param output Segment file to append the rows to
+ * @return 0 if operation was successful, -1 otherwise
+ */
+static int mergeNode(MergeSegment *segment, int node, FILE *output)
+{
+    int first = segment->nodeStarts[node];
+    int count = segment->nodeStarts[node + 1] - first;
+    NodeAggregate *aggregate = &segment->aggregates[node];
+    memset(aggregate, 0, sizeof(NodeAggregate));
+    aggregate->rowsOffset = segment->length;
+    aggregate->inputs = count;
+
+    MergeCursor *cursors = (MergeCursor *)calloc(count, sizeof(MergeCursor));
+    MergeCursor **heap = (MergeCursor **)malloc(sizeof(MergeCursor *) * count);
+    if (cursors == NULL || heap == NULL)
+    {
+        free(cursors);
+        free(heap);
+        return -1;
+    }
+    int result = 0;
+    int opened = 0;
+    int size = 0;
+    for (; opened < count && result == 0; opened++)
+    {
+        MergeCursor *cursor = &cursors[opened];
+        cursor->input = &segment->inputs[first + opened];
+        if (openSnapshotStream(&cursor->stream, cursor->input->path) != 0)
+        {
+            fprintf(stderr, "Error: %s could not be opened, or is not a table written by this version of tableViewer.\n", cursor->input->path);
+            result = -1;
+            break;
+        }
+        if (!(cursor->stream.columns & COLUMN_MASK(fd)))
+        {
+            fprintf(stderr, "Error: %s has no fd column to merge by.\n", cursor->input->path);
+            result = -1;
+            continue;
+        }
+        int advanced = advanceCursor(cursor);
+        if (advanced < 0)
+            result = -1;
+        else if (advanced > 0)
+            heap[size++] = cursor;
+    }
+    for (int i = size / 2 - 1; i >= 0; i--)
+        siftDown(heap, size, i);
+
+    int havePrevious = 0;
+    unsigned long previousPid = 0;
+    unsigned long previousFd = 0;
+    unsigned long processRows = 0;
+    while (size > 0 && result == 0)
+    {
+        MergeCursor *cursor = heap[0];
+        FileDescriptorEntry *entry = &cursor->entry;
+        if (havePrevious && cursor->pid == previousPid && entry->fd == previousFd)
+            aggregate->duplicates++;
+        else
+        {
+            if (!havePrevious || cursor->pid != previousPid)
+            {
+                aggregate->processes++;
+                processRows = 0;
+            }
+            processRows++;
+            if (processRows > aggregate->largestRows)
+            {
+                aggregate->largestRows = processRows;
+                aggregate->largestPid = cursor->pid;
+                aggregate->largestNode = node;
+            }
+            FleetRow row;
+            memset(&row, 0, sizeof(FleetRow));
+            size_t length = entry->filename != NULL ? strlen(entry->filename) : 0;
+            row.node = node;
+            row.type = entry->type;
+            row.filenameLength = length;
+            row.pid = cursor->pid;
+            row.fd = entry->fd;
+            row.inode = entry->inode;
+            row.dev = entry->dev;
+            if (fwrite_unlocked(&row, sizeof(FleetRow), 1, output) != 1 ||
+                fwrite_unlocked(entry->filename, sizeof(char), length, output) != length)
+                result = -1;
+            segment->length += sizeof(FleetRow) + length;
+            aggregate->rows++;
+            aggregate->byType[entry->type]++;
+            havePrevious = 1;
+            previousPid = cursor->pid;
+            previousFd = entry->fd;
+        }
+        int advanced = advanceCursor(cursor);
+        if (advanced < 0)
+            result = -1;
+        else if (advanced == 0)
+            heap[0] = heap[--size];
+        siftDown(heap, size, 0);
+    }
+    segment->rows += aggregate->rows;
+    for (int i = 0; i < opened && i < count; i++)
+        closeSnapshotStream(&cursors[i].stream);
+    free(cursors);
+    free(heap);
+    return result;
+}
+
+/**
+ * Merge the nodes of a segment into its file.
+ * @param argument The MergeSegment to merge
+ * @return NULL
+ */
+static void *mergeSegment(void *argument)
+{
+    MergeSegment *segment = (MergeSegment *)argument;
+    FILE *output = fopen(segment->fileName, "wb");
+    if (output == NULL)
+    {
+        perror("Error opening a segment of the fleet index");
+        segment->failed = 1;
+        return NULL;
+    }
+    setvbuf(output, NULL, _IOFBF, MERGE_OUTPUT_BUFFER_SIZE);
+    for (int node = segment->firstNode; node < segment->endNode && !segment->failed; node++)
+    {
+        segment->failed = mergeNode(segment, node, output) != 0;
+    }
+    segment->failed |= fclose(output) != 0;
+    return NULL;
+}
+
+/**
+ * Append a whole file to the end of another.
+ * @param fd File to append to
+ * @param fileName Name of the file to append
+ * @param length Number of bytes of the file
+ * @return 0 if operation was successful, -1 otherwise
+ */
+static int appendFile(int fd, const char *fileName, unsigned long length)
+{
+    int source = open(fileName, O_RDONLY);
+    if (source < 0)
+        return -1;
+    while (length > 0)
+    {
+        ssize_t copied = copy_file_range(source, NULL, fd, NULL, length, 0);
+        if (copied < 0 && errno == EINTR)
+            continue;
+        if (copied <= 0)
+            break;
+        length -= copied;
+    }
+    // copy_file_range is not supported by every filesystem, copy what is left by hand
+    char buffer[1 << 16];
+    while (length > 0)
+    {
+        ssize_t bytes = read(source, buffer, length < sizeof(buffer) ? length : sizeof(buffer));
+        if (bytes <= 0 || write(fd, buffer, bytes) != bytes)
+            break;
+        length -= bytes;
+    }
+    close(source);
+    return length == 0 ? 0 : -1;
+}
+
+/**
+ * Print the aggregates of a node or of the fleet.
+ * @param name Node ID of the aggregate, or "fleet"
+ * @param aggregate Aggregate to print
+ * @param largestNode Node ID of the largest process
+ * @param stream Stream to output to
+ */
+static void printAggregate(const char *name, const NodeAggregate *aggregate, const char *largestNode, FILE *stream)
+{
+    fprintf(stream, "%-16s\t%lu\t%lu\t%lu", name, aggregate->inputs, aggregate->processes, aggregate->rows);
+    for (int type = 0; type < FD_TYPE_COUNT; type++)
+        fprintf(stream, "\t%lu", aggregate->byType[type]);
+    fprintf(stream, "\t%lu\t%s:%lu (%lu)\n", aggregate->duplicates, largestNode, aggregate->largestPid, aggregate->largestRows);
+}
+
+/**
+ * Merge binary tables of many nodes into one fleet index sorted by (node, pid, fd), and print
+ * the aggregates of each node and of the fleet. Inputs are read as streams, so memory does not
+ * grow with their size. Each input must be sorted by PID and then by file descriptor, as written
+ * by tableViewer. Nodes are split into contiguous ranges of about the same number of bytes, each
+ * merged by its own thread into a segment file next to the output, and the segments are then
+ * appended to the output in order.
+ * @param inputs Inputs to merge, reordered by node ID
+ * @param numInputs Number of inputs
+ * @param outputName Name of the fleet index to write
+ * @param numThreads Number of threads merging nodes, at most MAX_MERGE_THREADS
+ * @param stream Stream to print the aggregates to
+ * @return 0 if operation was successful, -1 otherwise
+ */
+int mergeSnapshots(MergeInput *inputs, int numInputs, const char *outputName, int numThreads, FILE *stream)
+{
+    if (numThreads < 1)
+        numThreads = 1;
+    if (numThreads > MAX_MERGE_THREADS)
+        numThreads = MAX_MERGE_THREADS;
+    qsort(inputs, numInputs, sizeof(MergeInput), compareInputs);
+
+    int *nodeStarts = (int *)malloc(sizeof(int) * (numInputs + 1));
+    unsigned long *nodeBytes = (unsigned long *)calloc(numInputs + 1, sizeof(unsigned long));
+    NodeAggregate *aggregates = (NodeAggregate *)calloc(numInputs + 1, sizeof(NodeAggregate));
+    MergeSegment *segments = (MergeSegment *)calloc(numThreads, sizeof(MergeSegment));
+    if (nodeStarts == NULL || nodeBytes == NULL || aggregates == NULL || segments == NULL)
+    {
+        free(nodeStarts);
+        free(nodeBytes);
+        free(aggregates);
+        free(segments);
+        return -1;
+    }
+    int numNodes = 0;
+    unsigned long totalBytes = 0;
+    for (int i = 0; i < numInputs; i++)
+    {
+        if (i == 0 || strcmp(inputs[i].node, inputs[i - 1].node) != 0)
+            nodeStarts[numNodes++] = i;
+        struct stat stats;
+        if (stat(inputs[i].path, &stats) == 0)
+        {
+            nodeBytes[numNodes - 1] += stats.st_size;
+            totalBytes += stats.st_size;
+        }
+    }
+    nodeStarts[numNodes] = numInputs;
+    if (numThreads > numNodes)
+        numThreads = numNodes > 0 ? numNodes : 1;
+
+    // split nodes into ranges of about the same number of input bytes
+    int node = 0;
+    unsigned long assigned = 0;
+    for (int k = 0; k < numThreads; k++)
+    {
+        MergeSegment *segment = &segments[k];
+        segment->inputs = inputs;
+        segment->nodeStarts = nodeStarts;
+        segment->aggregates = aggregates;
+        segment->firstNode = node;
+        unsigned long target = totalBytes / numThreads * (k + 1);
+        // leave at least one node for each later segment
+        while (node < numNodes - (numThreads - k - 1) && (node == segment->firstNode || assigned + nodeBytes[node] / 2 <= target || k == numThreads - 1))
+            assigned += nodeBytes[node++];
+        segment->endNode = node;
+        snprintf(segment->fileName, sizeof(segment->fileName), "%s.%d", outputName, k);
+    }
+
+    pthread_t threads[MAX_MERGE_THREADS];
+    int started = 0;
+    for (; started < numThreads - 1; started++)
+    {
+        if (pthread_create(&threads[started], NULL, mergeSegment, &segments[started + 1]) != 0)
+        {
+            segments[started + 1].failed = 1;
+            break;
+        }
+    }
+    mergeSegment(&segments[0]);
+    for (int k = 0; k < started; k++)
+        pthread_join(threads[k], NULL);
+
+    int failed = 0;
+    for (int k = 0; k < numThreads; k++)
+        failed |= segments[k].failed;
+
+    int fd = failed ? -1 : open(outputName, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        failed = 1;
+    else
+    {
+        FleetIndexHeader header;
+        memset(&header, 0, sizeof(FleetIndexHeader));
+        header.magic = FLEET_INDEX_MAGIC;
+        header.version = FLEET_INDEX_VERSION;
+        header.numNodes = numNodes;
+        unsigned long offset = sizeof(FleetIndexHeader) + (unsigned long)numNodes * NODE_ID_SIZE;
+        failed |= write(fd, &header, sizeof(FleetIndexHeader)) != sizeof(FleetIndexHeader);
+        for (int i = 0; i < numNodes; i++)
+            failed |= write(fd, inputs[nodeStarts[i]].node, NODE_ID_SIZE) != NODE_ID_SIZE;
+
+        // offsets of rows are relative to their segment until the segment is placed
+        NodeAggregate *fleet = &aggregates[numNodes];
+        memset(fleet, 0, sizeof(NodeAggregate));
+        fleet->rowsOffset = offset;
+        for (int k = 0; k < numThreads && !failed; k++)
+        {
+            for (int i = segments[k].firstNode; i < segments[k].endNode; i++)
+            {
+                aggregates[i].rowsOffset += offset;
+                fleet->inputs += aggregates[i].inputs;
+                fleet->processes += aggregates[i].processes;
+                fleet->rows += aggregates[i].rows;
+                for (int type = 0; type < FD_TYPE_COUNT; type++)
+                    fleet->byType[type] += aggregates[i].byType[type];
+                fleet->duplicates += aggregates[i].duplicates;
+                if (aggregates[i].largestRows > fleet->largestRows)
+                {
+                    fleet->largestRows = aggregates[i].largestRows;
+                    fleet->largestPid = aggregates[i].largestPid;
+                    fleet->largestNode = aggregates[i].largestNode;
+                }
+            }
+            failed |= appendFile(fd, segments[k].fileName, segments[k].length) != 0;
+            offset += segments[k].length;
+        }
+        header.numRows = fleet->rows;
+        header.aggregatesOffset = offset;
+        size_t aggregatesLength = sizeof(NodeAggregate) * (numNodes + 1);
+        failed |= write(fd, aggregates, aggregatesLength) != (ssize_t)aggregatesLength;
+        failed |= pwrite(fd, &header, sizeof(FleetIndexHeader), 0) != sizeof(FleetIndexHeader);
+        failed |= close(fd) != 0;
+    }
+    for (int k = 0; k < numThreads; k++)
+        unlink(segments[k].fileName);
+
+    if (!failed)
+    {
+        fprintf(stream, "%-16s\tinputs\tprocesses\tfds", "node");
+        for (int type = 0; type < FD_TYPE_COUNT; type++)
+            fprintf(stream, "\t%s", fileDescriptorTypeName((FileDescriptorType)type));
+        fprintf(stream, "\tduplicates\tlargest process (fds)\n");
+        for (int i = 0; i < numNodes; i++)
+            printAggregate(inputs[nodeStarts[i]].node, &aggregates[i], inputs[nodeStarts[i]].node, stream);
+        printAggregate("fleet", &aggregates[numNodes], numNodes > 0 ? inputs[nodeStarts[aggregates[numNodes].largestNode]].node : "", stream);
+    }
+    else
+        fprintf(stderr, "Error: The fleet index %s could not be written.\n", outputName);
+    free(nodeStarts);
+    free(nodeBytes);
+    free(aggregates);
+    free(segments);
+    return failed ? -1 : 0;
+}
+
+/**
+ * Open a fleet index written by mergeSnapshots, and read its node IDs and aggregates.
+ * @param index Reader to initialize
+ * @param fileName Name of the fleet index
+ * @return 0 if operation was successful, -1 if the file could not be read or is not a fleet index of this version
+ */
+int openFleetIndex(FleetIndex *index, const char *fileName)
+{
+    memset(index, 0, sizeof(FleetIndex));
+    index->file = fopen(fileName, "rb");
+    if (index->file == NULL)
+        return -1;
+    setvbuf(index->file, NULL, _IOFBF, SNAPSHOT_STREAM_BUFFER_SIZE);
+    FleetIndexHeader *header = &index->header;
+    if (fread(header, sizeof(FleetIndexHeader), 1, index->file) != 1 || header->magic != FLEET_INDEX_MAGIC ||
+        header->version != FLEET_INDEX_VERSION || header->numNodes > header->aggregatesOffset / NODE_ID_SIZE)
+    {
+        closeFleetIndex(index);
+        return -1;
+    }
+    index->nodes = (char *)malloc(header->numNodes * NODE_ID_SIZE + 1);
+    index->aggregates = (NodeAggregate *)malloc(sizeof(NodeAggregate) * (header->numNodes + 1));
+    if (index->nodes == NULL || index->aggregates == NULL ||
+        fread(index->nodes, NODE_ID_SIZE, header->numNodes, index->file) != header->numNodes ||
+        fseek(index->file, header->aggregatesOffset, SEEK_SET) != 0 ||
+        fread(index->aggregates, sizeof(NodeAggregate), header->numNodes + 1, index->file) != header->numNodes + 1)
+    {
+        closeFleetIndex(index);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Find a node of a fleet index by binary search over its sorted node IDs.
+ * @param index Fleet index to search
+ * @param node Node ID to look for
+ * @return Index of the node, or -1 if the fleet index has no such node
+ */
+long findFleetNode(const FleetIndex *index, const char *node)
+{
+    long low = 0;
+    long high = (long)index->header.numNodes - 1;
+    while (low <= high)
+    {
+        long middle = low + (high - low) / 2;
+        int order = strncmp(node, index->nodes + middle * NODE_ID_SIZE, NODE_ID_SIZE);
+        if (order == 0)
+            return middle;
+        if (order < 0)
+            high = middle - 1;
+        else
+            low = middle + 1;
+    }
+    return -1;
+}
+
+/**
+ * Print the rows of a fleet index held by a process of a node, or a single file descriptor of
+ * it. The node is found by binary search, then its rows are read from the offset stored in its
+ * aggregate. Rows of a node are sorted by (pid, fd), so reading stops at the first row past the
+ * one looked up.
+ * @param index Fleet index to read
+ * @param node Node ID of the process
+ * @param pid Process identifier
+ * @param fd File descriptor to look up, or -1 for every file descriptor of the process
+ * @param stream Stream to print the rows to, as node, PID, fd, type, inode, dev and filename
+ * @return Number of rows found, or -1 if the fleet index is truncated
+ */
+long lookupFleetRows(FleetIndex *index, const char *node, unsigned long pid, long fd, FILE *stream)
+{
+    long nodeIndex = findFleetNode(index, node);
+    if (nodeIndex < 0)
+        return 0;
+    const NodeAggregate *aggregate = &index->aggregates[nodeIndex];
+    if (fseek(index->file, aggregate->rowsOffset, SEEK_SET) != 0)
+        return -1;
+    long found = 0;
+    char filename[USHRT_MAX + 1];
+    for (unsigned long i = 0; i < aggregate->rows; i++)
+    {
+        FleetRow row;
+        if (fread(&row, sizeof(FleetRow), 1, index->file) != 1 || row.node != (unsigned int)nodeIndex)
+            return -1;
+        if (row.pid > pid || (row.pid == pid && fd >= 0 && row.fd > (unsigned long)fd))
+            break;
+        if (fread(filename, sizeof(char), row.filenameLength, index->file) != row.filenameLength)
+            return -1;
+        if (row.pid < pid || (fd >= 0 && row.fd != (unsigned long)fd))
+            continue;
+        filename[row.filenameLength] = '\0';
+        fprintf(stream, "%s\t%lu\t%lu\t%s\t%lu\t%lu\t%s\n", node, row.pid, row.fd,
+                fileDescriptorTypeName((FileDescriptorType)row.type), row.inode, row.dev, filename);
+        found++;
+    }
+    return found;
+}
+
+/**
+ * Close a fleet index and free its node IDs and aggregates.
+ * @param index Fleet index to close
+ */
+void closeFleetIndex(FleetIndex *index)
+{
+    if (index->file != NULL)
+        fclose(index->file);
+    free(index->nodes);
+    free(index->aggregates);
+    index->file = NULL;
+    index->nodes = NULL;
+    index->aggregates = NULL;
+}
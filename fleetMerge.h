@@ -0,0 +1,118 @@
+#ifndef FLEET_MERGE_H
+#define FLEET_MERGE_H
+
+#include <stdio.h>
+#include "processes.h"
+
+#define FLEET_INDEX_NAME "fleetIndex.bin"
+// "TVF1", the first 4 bytes of fleet indexes
+#define FLEET_INDEX_MAGIC 0x31465654u
+#define FLEET_INDEX_VERSION 3u
+#define NODE_ID_SIZE 64
+#define MAX_MERGE_THREADS 64
+
+/**
+ * A binary table of one node to merge, given on the command line as <node>:<path>
+ */
+typedef struct MergeInput
+{
+    char node[NODE_ID_SIZE];
+    const char *path;
+    /**
+     * Position on the command line. Where inputs of the same node hold the same (pid, fd), the
+     * row of the later input is kept.
+    */
+    int order;
+} MergeInput;
+
+/**
+ * Start of a fleet index. It is followed by numNodes node IDs of NODE_ID_SIZE bytes each, in
+ * sorted order, then the rows sorted by (node, pid, fd), then a NodeAggregate for each node and
+ * one for the whole fleet at aggregatesOffset.
+ */
+typedef struct FleetIndexHeader
+{
+    unsigned int magic;
+    unsigned int version;
+    unsigned long numNodes;
+    unsigned long numRows;
+    unsigned long aggregatesOffset;
+} FleetIndexHeader;
+
+/**
+ * Fixed part of a row of a fleet index, followed by filenameLength bytes of filename
+ */
+typedef struct FleetRow
+{
+    /**
+     * Index of the node in the sorted node IDs
+    */
+    unsigned int node;
+    unsigned char type;
+    unsigned char reserved;
+    unsigned short filenameLength;
+    unsigned long pid;
+    unsigned long fd;
+    unsigned long inode;
+    unsigned long dev;
+} FleetRow;
+
+/**
+ * Totals of the rows of one node, or of the whole fleet
+ */
+typedef struct NodeAggregate
+{
+    /**
+     * Offset of the first row of the node in the fleet index
+    */
+    unsigned long rowsOffset;
+    unsigned long inputs;
+    /**
+     * Processes with at least one file descriptor
+    */
+    unsigned long processes;
+    unsigned long rows;
+    unsigned long byType[FD_TYPE_COUNT];
+    /**
+     * Rows dropped because a later input of the same node held the same (pid, fd)
+    */
+    unsigned long duplicates;
+    /**
+     * The process with the most file descriptors, and the index of its node in the sorted node IDs
+    */
+    unsigned long largestPid;
+    unsigned long largestNode;
+    unsigned long largestRows;
+} NodeAggregate;
+
+/**
+ * Reader of a fleet index, holding its node IDs and aggregates. Rows are read from the file
+ * when looked up.
+ */
+typedef struct FleetIndex
+{
+    FILE *file;
+    FleetIndexHeader header;
+    /**
+     * Node IDs of NODE_ID_SIZE bytes each, in sorted order
+    */
+    char *nodes;
+    /**
+     * An aggregate for each node, then one for the whole fleet
+    */
+    NodeAggregate *aggregates;
+} FleetIndex;
+
+extern int parseMergeInput(const char *argument, int order, MergeInput *input);
+
+extern int mergeSnapshots(MergeInput *inputs, int numInputs, const char *outputName, int numThreads, FILE *stream);
+
+extern int openFleetIndex(FleetIndex *index, const char *fileName);
+
+extern long findFleetNode(const FleetIndex *index, const char *node);
+
+extern long lookupFleetRows(FleetIndex *index, const char *node, unsigned long pid, long fd, FILE *stream);
+
+extern void closeFleetIndex(FleetIndex *index);
+
+#endif
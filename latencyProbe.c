@@ -0,0 +1,107 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "latencyProbe.h"
+
+/**
+ * Wake up at every period until stopped, recording how late each wakeup was.
+ * @param argument The LatencyProbe to record to
+ * @return NULL
+ */
+static void *runLatencyProbe(void *argument)
+{
+    LatencyProbe *probe = (LatencyProbe *)argument;
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    while (atomic_load_explicit(&probe->running, memory_order_acquire))
+    {
+        next.tv_nsec += probe->periodMicroseconds * 1000;
+        while (next.tv_nsec >= 1000000000L)
+        {
+            next.tv_nsec -= 1000000000L;
+            next.tv_sec++;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        double lateMicroseconds = (now.tv_sec - next.tv_sec) * 1e6 + (now.tv_nsec - next.tv_nsec) / 1e3;
+        if (lateMicroseconds < 0)
+            lateMicroseconds = 0;
+        long bucket = (long)(lateMicroseconds / LATENCY_PROBE_BUCKET_MICROSECONDS);
+        probe->histogram[bucket < LATENCY_PROBE_BUCKETS ? bucket : LATENCY_PROBE_BUCKETS - 1]++;
+        probe->wakeups++;
+        if (lateMicroseconds / 1e3 > probe->maxLatencyMs)
+            probe->maxLatencyMs = lateMicroseconds / 1e3;
+        // wakeups missed while late are skipped rather than run back to back
+        if (lateMicroseconds > probe->periodMicroseconds)
+            next = now;
+    }
+    return NULL;
+}
+
+/**
+ * Start a latency probe on its own thread.
+ * @param periodMicroseconds Period between wakeups, in microseconds
+ * @return The running probe, NULL if it could not be started
+ */
+LatencyProbe *startLatencyProbe(long periodMicroseconds)
+{
+    LatencyProbe *probe = (LatencyProbe *)calloc(1, sizeof(LatencyProbe));
+    if (probe == NULL)
+        return NULL;
+    probe->periodMicroseconds = periodMicroseconds;
+    atomic_store(&probe->running, 1);
+    if (pthread_create(&probe->thread, NULL, runLatencyProbe, probe) != 0)
+    {
+        free(probe);
+        return NULL;
+    }
+    return probe;
+}
+
+/**
+ * Stop a latency probe and wait for its thread to exit. Its records can be read afterwards.
+ * @param probe Probe to stop, nothing is done if NULL
+ */
+void stopLatencyProbe(LatencyProbe *probe)
+{
+    if (probe == NULL)
+        return;
+    atomic_store_explicit(&probe->running, 0, memory_order_release);
+    pthread_join(probe->thread, NULL);
+}
+
+/**
+ * Get a percentile of the lateness of wakeups of a stopped probe.
+ * @param probe Stopped probe
+ * @param percentile Percentile to get, between 0 and 100
+ * @return Upper bound of the lateness of that percentile of wakeups, in milliseconds
+ */
+double latencyPercentile(const LatencyProbe *probe, double percentile)
+{
+    unsigned long rank = (unsigned long)(probe->wakeups * percentile / 100);
+    unsigned long seen = 0;
+    for (long bucket = 0; bucket < LATENCY_PROBE_BUCKETS; bucket++)
+    {
+        seen += probe->histogram[bucket];
+        if (seen > rank)
+            return (bucket + 1) * LATENCY_PROBE_BUCKET_MICROSECONDS / 1e3;
+    }
+    return probe->maxLatencyMs;
+}
+
+/**
+ * Print how late the wakeups of a stopped probe were.
+ * @param probe Stopped probe
+ * @param stream Stream to output plain-text to
+ */
+void printLatencyProbe(const LatencyProbe *probe, FILE *stream)
+{
+    fprintf(stream, "## Latency probe: %lu wakeups every %.2f ms, late by p50 %.2f ms, p99 %.2f ms, p99.9 %.2f ms, max %.2f ms\n",
+            probe->wakeups, probe->periodMicroseconds / 1e3, latencyPercentile(probe, 50), latencyPercentile(probe, 99),
+            latencyPercentile(probe, 99.9), probe->maxLatencyMs);
+}
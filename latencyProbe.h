@@ -0,0 +1,42 @@
+#ifndef LATENCY_PROBE_H
+#define LATENCY_PROBE_H
+
+#include <stdio.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+// wakeups of the probe are late by at most this many microseconds in the histogram, later ones are counted in its last bucket
+#define LATENCY_PROBE_MAX_MICROSECONDS 100000
+#define LATENCY_PROBE_BUCKET_MICROSECONDS 10
+#define LATENCY_PROBE_BUCKETS (LATENCY_PROBE_MAX_MICROSECONDS / LATENCY_PROBE_BUCKET_MICROSECONDS + 1)
+
+/**
+ * Thread standing in for a latency-sensitive service on the same host. It wakes up at a fixed
+ * period and records how late each wakeup was, so that the delay a scan causes to other
+ * threads can be measured.
+ */
+typedef struct LatencyProbe
+{
+    pthread_t thread;
+    atomic_int running;
+    /**
+     * Period between wakeups, in microseconds
+    */
+    long periodMicroseconds;
+    unsigned long wakeups;
+    double maxLatencyMs;
+    /**
+     * Number of wakeups late by each multiple of LATENCY_PROBE_BUCKET_MICROSECONDS
+    */
+    unsigned long histogram[LATENCY_PROBE_BUCKETS];
+} LatencyProbe;
+
+extern LatencyProbe *startLatencyProbe(long periodMicroseconds);
+
+extern void stopLatencyProbe(LatencyProbe *probe);
+
+extern double latencyPercentile(const LatencyProbe *probe, double percentile);
+
+extern void printLatencyProbe(const LatencyProbe *probe, FILE *stream);
+
+#endif
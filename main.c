@@ -8,12 +8,25 @@
 #include <string.h>
 #include <fcntl.h>
 #include <dirent.h>
+#include <time.h>
 
 #include "stringUtils.h"
 #include "processes.h"
 #include "printTables.h"
 #include "readFileDescriptors.h"
 #include "readProcesses.h"
+#include "readSockets.h"
+#include "fdHistory.h"
+#include "sharedSnapshot.h"
+#include "columns.h"
+#include "parallelPrint.h"
+#include "pipeline.h"
+#include "rowFilter.h"
+#include "scanBudget.h"
+#include "latencyProbe.h"
+#include "processGroups.h"
+#include "fdCountCache.h"
+#include "scanScheduler.h"
 
 #define FILE_LIST_SIZE 1024
 #define MAX_COMMAND_LINE_ARGUMENT_LENGTH 64
@@ -25,9 +38,26 @@
 #define ARG_THRESHOLD "--threshold"
 #define ARG_OUTPUT_BINARY "--output_binary"
 #define ARG_OUTPUT_TXT "--output_TXT"
+#define ARG_INTERVAL "--interval"
+#define ARG_SAMPLES "--samples"
+#define ARG_PUBLISH "--publish"
+#define ARG_FORMAT "--format="
+#define ARG_COLUMNS "--columns="
+#define ARG_THREADS "--threads"
+#define ARG_PIPELINE "--pipeline"
+#define ARG_WHERE "--where="
+#define ARG_STATS "--stats"
+#define ARG_BUDGET "--budget="
+#define ARG_LATENCY_PROBE "--latency-probe"
+#define ARG_BY_CGROUP "--by-cgroup"
+#define ARG_BY_NETNS "--by-netns"
+#define ARG_FD_COUNT_CACHE "--fd-count-cache="
+#define ARG_SCAN_ORDER "--scan-order="
+#define ARG_TYPE "--type="
 
 #define BINARY_OUT_NAME "compositeTable.bin"
 #define TXT_OUT_NAME "compositeTable.txt"
+#define LATENCY_PROBE_PERIOD_MICROSECONDS 1000
 
 /**
  * Print information of processes that have more file descriptors than the given threshold. These are "offending processes".
@@ -61,6 +91,186 @@ void printOffendingProcesses(long threshold, ProcessData **processes, int numPro
     printf("\n");
 }
 
+/**
+ * Read the monotonic clock.
+ * @return Milliseconds since an arbitrary point in the past
+*/
+double monotonicMilliseconds()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1e3 + now.tv_nsec / 1e6;
+}
+
+/**
+ * Print the counters and the CPU budget of a scan, as requested.
+ * @param options Options of the finished scan
+ * @param showStats If true, the counters of the scan are printed
+ * @param stream Stream to output plain-text to
+*/
+void printScanReport(const ScanOptions *options, bool showStats, FILE *stream)
+{
+    if (showStats)
+    {
+        printScanStats(options->stats, stream);
+    }
+    if (options->budget != NULL)
+    {
+        printScanBudget(options->budget, options->stats->processesScanned, options->stats->rowsSeen, stream);
+    }
+}
+
+/**
+ * Repeatedly scan processes and record their file descriptor counts in a fixed-size history,
+ * printing the processes whose counts are trending upward after every sample.
+ * @param interval Milliseconds between the start of consecutive samples
+ * @param samples Number of samples to take, or a negative number to sample until interrupted
+ * @param pidArgument If non-negative, only sample the process with this PID
+ * @param publisher If not NULL, every sample is also published to shared memory
+ * @param options Filter of the file descriptors counted, and counters and budget of the scan
+ * @param showStats If true, the counters of each sample are printed
+ * @return 0 if operation was successful, nonzero otherwise
+*/
+int runSampling(long interval, long samples, long pidArgument, SharedSnapshotPublisher *publisher, const ScanOptions *options, bool showStats)
+{
+    FdHistory *history = createFdHistory();
+    if (history == NULL)
+    {
+        fprintf(stderr, "Error: Could not allocate file descriptor history.\n");
+        return 1;
+    }
+
+    for (long sample = 0; samples < 0 || sample < samples; sample++)
+    {
+        double sampleStart = monotonicMilliseconds();
+        if (options->stats != NULL)
+        {
+            memset(options->stats, 0, sizeof(ScanStats));
+        }
+
+        // the budget also covers listing the processes
+        if (options->budget != NULL)
+        {
+            initScanBudget(options->budget, options->budget->share);
+        }
+        int numProcessesFound;
+        ProcessData **processes = fetchProcesses(&numProcessesFound, pidArgument, options->budget);
+        if (processes == NULL)
+        {
+            fprintf(stderr, "Error: Could not read processes.\n");
+            freeFdHistory(history);
+            return 1;
+        }
+        int failed = 0;
+        for (int i = 0; i < numProcessesFound; i++)
+        {
+            failed |= readFileDescriptors(processes[i], options) != 0;
+        }
+        if (failed)
+        {
+            fprintf(stderr, "Error: Could not read file descriptors.\n");
+            freeProcesses(processes, numProcessesFound);
+            freeFdHistory(history);
+            return 1;
+        }
+
+        double recordStart = monotonicMilliseconds();
+        recordFdSample(history, processes, numProcessesFound);
+        double recordEnd = monotonicMilliseconds();
+        if (publisher != NULL && publishSharedSnapshot(publisher, processes, numProcessesFound) != 0)
+        {
+            fprintf(stderr, "Error: Could not publish snapshot to shared memory.\n");
+        }
+        double publishEnd = monotonicMilliseconds();
+        freeProcesses(processes, numProcessesFound);
+
+        printGrowingProcesses(history, stdout);
+        printf("## Sample took %.2f ms (scan %.2f ms, history %.3f ms, publish %.3f ms)\n", publishEnd - sampleStart, recordStart - sampleStart, recordEnd - recordStart, publishEnd - recordEnd);
+        printScanReport(options, showStats, stdout);
+        fflush(stdout);
+
+        // sleep for the remainder of the interval
+        double remaining = interval - (monotonicMilliseconds() - sampleStart);
+        if (remaining > 0 && (samples < 0 || sample + 1 < samples))
+        {
+            struct timespec pause = {(time_t)(remaining / 1e3), (long)((remaining - (long)(remaining / 1e3) * 1e3) * 1e6)};
+            nanosleep(&pause, NULL);
+        }
+    }
+
+    freeFdHistory(history);
+    return 0;
+}
+
+/**
+ * Print a single table through a pipeline of scanner, formatter and writer threads. File
+ * descriptors of the processes are read by the pipeline, and all processes are freed.
+ * @param processes An array of processes whose file descriptors are not read yet
+ * @param numProcesses The size of the processes array.
+ * @param format Format of the table
+ * @param columns Mask of the columns of the table, 0 for the composite table
+ * @param numScanners Number of threads reading file descriptors
+ * @param options Filter and counters of the scan
+ * @param outputTxt If true, the table is written to TXT_OUT_NAME rather than stdout
+ * @param showStats If true, the time taken and the waits of each stage are printed
+ * @return 0 if operation was successful, nonzero otherwise
+*/
+int printPipelined(ProcessData **processes, int numProcesses, OutputFormat format, unsigned int columns, int numScanners, const ScanOptions *options, bool outputTxt, bool showStats)
+{
+    FILE *stream = outputTxt ? fopen(TXT_OUT_NAME, "w") : stdout;
+    if (stream == NULL)
+    {
+        perror("Error: Could not open .txt output file");
+        freeProcesses(processes, numProcesses);
+        return 1;
+    }
+    setvbuf(stream, NULL, _IOFBF, OUTPUT_BUFFER_SIZE);
+
+    // the composite table keeps its own header in plain text
+    const TableDefinition *composite = table_definition(TABLE_COMPOSITE);
+    bool compositeText = format == FORMAT_TEXT && columns == 0;
+    if (columns == 0)
+        columns = composite->columns;
+    if (compositeText)
+        composite->print_header(stream);
+    else
+        print_columns_header(format, columns, stream);
+
+    // sockets are read before the scan and joined to each batch as it is scanned
+    SocketTable *sockets = NULL;
+    if (columns & COLUMN_MASK(socket))
+    {
+        sockets = fetchSockets();
+        if (sockets == NULL)
+            fprintf(stderr, "Warning: Could not read socket details through sock_diag.\n");
+    }
+
+    PipelineStats stats;
+    double start = monotonicMilliseconds();
+    int result = runPipeline(processes, numProcesses, numScanners, options, sockets, column_printer(format, columns), columns, stream, &stats);
+    if (compositeText)
+        composite->print_footer(stream);
+    else
+        print_columns_footer(format, stream);
+    if (outputTxt)
+        result |= fclose(stream);
+    else
+        result |= fflush(stream);
+    if (showStats)
+    {
+        fprintf(stderr, "## Pipeline took %.2f ms (waits: scanners %lu full, formatter %lu empty %lu full, writer %lu empty)\n",
+                monotonicMilliseconds() - start, stats.scannerStalls, stats.formatterWaits, stats.formatterStalls, stats.writerWaits);
+    }
+    freeSockets(sockets);
+    freeProcesses(processes, numProcesses);
+    if (result != 0)
+    {
+        fprintf(stderr, "Error: Could not write table.\n");
+        return 1;
+    }
+    return 0;
+}
+
 /**
  * Entry point of program.
 */
@@ -116,6 +326,86 @@ int main(int argc, char **argv)
      */
     bool outputBinary = false;
 
+    /**
+     * Milliseconds between samples of file descriptor counts. Sampling mode is enabled when set. Corresponds with ARG_INTERVAL command line argument.
+     */
+    long interval = -1;
+
+    /**
+     * Number of samples to take in sampling mode, negative to sample until interrupted. Corresponds with ARG_SAMPLES command line argument.
+     */
+    long samples = -1;
+
+    /**
+     * Publish each finished snapshot to shared memory for local readers? Corresponds with ARG_PUBLISH command line argument.
+     */
+    bool publish = false;
+
+    /**
+     * Format of the tables printed to stdout. Corresponds with ARG_FORMAT command line argument.
+     */
+    OutputFormat format = FORMAT_TEXT;
+
+    /**
+     * Mask of the columns of a custom table, 0 if none was requested. Corresponds with ARG_COLUMNS command line argument.
+     */
+    unsigned int columns = 0;
+
+    /**
+     * Number of threads reading file descriptors, and formatting the composite table written by ARG_OUTPUT_TXT. Corresponds with ARG_THREADS command line argument.
+     */
+    long numThreads = 1;
+
+    /**
+     * Overlap scanning, formatting and writing of a single table? Corresponds with ARG_PIPELINE command line argument.
+     */
+    bool pipelined = false;
+
+    /**
+     * Expression selecting the rows to scan. Corresponds with ARG_WHERE command line argument.
+     */
+    RowFilter *filter = NULL;
+
+    /**
+     * Print counters of the scan to stderr? Corresponds with ARG_STATS command line argument.
+     */
+    bool showStats = false;
+
+    /**
+     * Percentage of one CPU the scan may use, 0 to scan at full speed. Corresponds with ARG_BUDGET command line argument.
+     */
+    double budgetPercent = 0;
+
+    /**
+     * Measure how late a periodic thread wakes up during the scan? Corresponds with ARG_LATENCY_PROBE command line argument.
+     */
+    bool latencyProbe = false;
+
+    /**
+     * Display the file descriptors of each cgroup. Corresponds with ARG_BY_CGROUP command line argument.
+     */
+    bool showByCgroup = false;
+
+    /**
+     * Display the file descriptors of each network namespace. Corresponds with ARG_BY_NETNS command line argument.
+     */
+    bool showByNetns = false;
+
+    /**
+     * File keeping the number of file descriptors of each process from one run to the next, NULL for none. Corresponds with ARG_FD_COUNT_CACHE command line argument.
+     */
+    const char *countCachePath = NULL;
+
+    /**
+     * Order in which the threads of the scan take processes. Corresponds with ARG_SCAN_ORDER command line argument.
+     */
+    ScanOrder scanOrder = SCAN_ORDER_LARGEST_FIRST;
+
+    /**
+     * Set of the types of file descriptors to scan, 0 for every type. Corresponds with ARG_TYPE command line argument.
+     */
+    unsigned int types = 0;
+
     for (int i = 1; i < argc; i++)
     {
         if (strncmp(argv[i], ARG_PER_PROCESS, MAX_COMMAND_LINE_ARGUMENT_LENGTH) == 0)
@@ -142,6 +432,43 @@ int main(int argc, char **argv)
         {
             outputBinary = true;
         }
+        else if (strncmp(argv[i], ARG_PIPELINE, MAX_COMMAND_LINE_ARGUMENT_LENGTH) == 0)
+        {
+            pipelined = true;
+        }
+        else if (strncmp(argv[i], ARG_STATS, MAX_COMMAND_LINE_ARGUMENT_LENGTH) == 0)
+        {
+            showStats = true;
+        }
+        else if (startsWith(argv[i], ARG_WHERE))
+        {
+            freeRowFilter(filter);
+            filter = compileRowFilter(argv[i] + strlen(ARG_WHERE));
+            if (filter == NULL)
+            {
+                return 1;
+            }
+        }
+        else if (strncmp(argv[i], ARG_PUBLISH, MAX_COMMAND_LINE_ARGUMENT_LENGTH) == 0)
+        {
+            publish = true;
+        }
+        else if (startsWith(argv[i], ARG_FORMAT))
+        {
+            if (parse_output_format(argv[i] + strlen(ARG_FORMAT), &format) != 0)
+            {
+                fprintf(stderr, "Error: Unknown format %s, expected text, ndjson or csv.\n", argv[i] + strlen(ARG_FORMAT));
+                return 1;
+            }
+        }
+        else if (startsWith(argv[i], ARG_COLUMNS))
+        {
+            if (parse_columns(argv[i] + strlen(ARG_COLUMNS), &columns) != 0)
+            {
+                fprintf(stderr, "Error: Unknown columns %s, expected a comma-separated list of index, pid, fd, filename, inode, dev, type and socket.\n", argv[i] + strlen(ARG_COLUMNS));
+                return 1;
+            }
+        }
         else if (startsWith(argv[i], ARG_THRESHOLD))
         {
             if (parseNumericalArgument(&threshold, argv[i]) != 0)
@@ -150,6 +477,84 @@ int main(int argc, char **argv)
             }
             thresholdSet = true;
         }
+        else if (startsWith(argv[i], ARG_INTERVAL))
+        {
+            if (parseNumericalArgument(&interval, argv[i]) != 0)
+            {
+                return 1;
+            }
+        }
+        else if (startsWith(argv[i], ARG_THREADS))
+        {
+            if (parseNumericalArgument(&numThreads, argv[i]) != 0)
+            {
+                return 1;
+            }
+            if (numThreads < 1 || numThreads > MAX_PRINT_THREADS)
+            {
+                fprintf(stderr, "Error: The number of threads must be between 1 and %d.\n", MAX_PRINT_THREADS);
+
+                return 1;
+            }
+        }
+        else if (startsWith(argv[i], ARG_BUDGET))
+        {
+            char *end;
+            budgetPercent = strtod(argv[i] + strlen(ARG_BUDGET), &end);
+            if (*end != '\0' || !(budgetPercent > 0 && budgetPercent <= 100))
+            {
+                fprintf(stderr, "Error: The CPU budget must be a percentage above 0 and at most 100.\n");
+                return 1;
+            }
+        }
+        else if (strncmp(argv[i], ARG_LATENCY_PROBE, MAX_COMMAND_LINE_ARGUMENT_LENGTH) == 0)
+        {
+            latencyProbe = true;
+        }
+        else if (strncmp(argv[i], ARG_BY_CGROUP, MAX_COMMAND_LINE_ARGUMENT_LENGTH) == 0)
+        {
+            showByCgroup = true;
+        }
+        else if (strncmp(argv[i], ARG_BY_NETNS, MAX_COMMAND_LINE_ARGUMENT_LENGTH) == 0)
+        {
+            showByNetns = true;
+        }
+        else if (startsWith(argv[i], ARG_TYPE))
+        {
+            if (parseFileDescriptorTypes(argv[i] + strlen(ARG_TYPE), &types) != 0)
+            {
+                char names[FD_TYPE_NAMES_SIZE];
+                fprintf(stderr, "Error: Unknown types %s, expected a comma-separated list of %s.\n", argv[i] + strlen(ARG_TYPE), listFileDescriptorTypeNames(names, sizeof(names)));
+                return 1;
+            }
+        }
+        else if (startsWith(argv[i], ARG_FD_COUNT_CACHE))
+        {
+            countCachePath = argv[i] + strlen(ARG_FD_COUNT_CACHE);
+        }
+        else if (startsWith(argv[i], ARG_SCAN_ORDER))
+        {
+            if (strcmp(argv[i] + strlen(ARG_SCAN_ORDER), "listed") == 0)
+            {
+                scanOrder = SCAN_ORDER_LISTED;
+            }
+            else if (strcmp(argv[i] + strlen(ARG_SCAN_ORDER), "largest") == 0)
+            {
+                scanOrder = SCAN_ORDER_LARGEST_FIRST;
+            }
+            else
+            {
+                fprintf(stderr, "Error: Unknown scan order %s, expected listed or largest.\n", argv[i] + strlen(ARG_SCAN_ORDER));
+                return 1;
+            }
+        }
+        else if (startsWith(argv[i], ARG_SAMPLES))
+        {
+            if (parseNumericalArgument(&samples, argv[i]) != 0)
+            {
+                return 1;
+            }
+        }
         else  // parse positional argument
         {
             if (pidSet)
@@ -172,50 +577,261 @@ int main(int argc, char **argv)
 
     // printf("Arguments parsed: %s: %d, %s: %d, %s: %d, %s: %d, %s: %ld, %s: %ld\n", ARG_PER_PROCESS, showPerProcess, ARG_SYSTEM_WIDE, showSystemWide, ARG_VNODES, showVnodes, ARG_COMPOSITE, showComposite, ARG_THRESHOLD, threshold, "PID", pidArgument);
 
-    // retrieve an array of processes
+    // rollups are added to as each process is scanned, and are not kept across samples
+    if ((showByCgroup || showByNetns) && interval > 0)
+    {
+        fprintf(stderr, "Error: %s and %s cannot be combined with %s.\n", ARG_BY_CGROUP, ARG_BY_NETNS, ARG_INTERVAL);
+        return 1;
+    }
+
+    // the pipeline prints a single table and frees each process once written
+    if (pipelined && (outputBinary || showPerProcess || showSystemWide || showVnodes || publish || thresholdSet))
+    {
+        fprintf(stderr, "Error: %s cannot be combined with %s, %s, %s, %s, %s or %s.\n", ARG_PIPELINE,
+                ARG_OUTPUT_BINARY, ARG_PER_PROCESS, ARG_SYSTEM_WIDE, ARG_VNODES, ARG_PUBLISH, ARG_THRESHOLD);
+        return 1;
+    }
+
+    SharedSnapshotPublisher *publisher = NULL;
+    if (publish)
+    {
+        publisher = createSharedSnapshotPublisher(SHARED_SNAPSHOT_NAME);
+        if (publisher == NULL)
+        {
+            fprintf(stderr, "Error: Could not allocate shared snapshot publisher.\n");
+            return 1;
+        }
+    }
+
+    ScanStats scanStats;
+    memset(&scanStats, 0, sizeof(scanStats));
+    // show composite table if explicitly given in arguments, or if no table arguments were given
+    showComposite = showComposite || (!showPerProcess && !showSystemWide && !showVnodes && !showByCgroup && !showByNetns && columns == 0);
+    // when only rollups are requested, the pipeline scans and frees processes without printing rows
+    bool pipelineRows = showComposite || columns != 0 || outputTxt;
+
+    // only resolve the fields of the columns that are printed, written or published
+    unsigned int scanColumns = columns;
+    if (interval > 0)
+        scanColumns = HISTORY_COLUMNS;
+    else if (pipelined && pipelineRows)
+        scanColumns = columns != 0 ? columns : COMPOSITE_COLUMNS;
+    else if (pipelined)
+        scanColumns = 0;
+    else
+    {
+        if (showPerProcess)
+            scanColumns |= table_definition(TABLE_PER_PROCESS)->columns;
+        if (showSystemWide)
+            scanColumns |= table_definition(TABLE_SYSTEM_WIDE)->columns;
+        if (showVnodes)
+            scanColumns |= table_definition(TABLE_VNODES)->columns;
+        if (showComposite || outputTxt || (outputBinary && columns == 0))
+            scanColumns |= table_definition(TABLE_COMPOSITE)->columns;
+        // the binary file counts the file descriptors of each type
+        if (outputBinary && !outputTxt)
+            scanColumns |= COLUMN_MASK(type);
+    }
+    if (publisher != NULL)
+        scanColumns |= SHARED_SNAPSHOT_COLUMNS;
+    // rates of a budgeted scan are reported from its counters
+    ScanBudget scanBudget;
+    initScanBudget(&scanBudget, budgetPercent / 100);
+    ScanOptions scanOptions = {scanColumns, filter, showStats || budgetPercent > 0 ? &scanStats : NULL, budgetPercent > 0 ? &scanBudget : NULL, NULL, types};
+
+    if (showByCgroup || showByNetns)
+    {
+        scanOptions.groups = createProcessGroups();
+        if (scanOptions.groups == NULL)
+        {
+            fprintf(stderr, "Error: Could not allocate cgroup and namespace rollups.\n");
+            return 1;
+        }
+    }
+
+    LatencyProbe *probe = NULL;
+    if (latencyProbe)
+    {
+        probe = startLatencyProbe(LATENCY_PROBE_PERIOD_MICROSECONDS);
+        if (probe == NULL)
+        {
+            fprintf(stderr, "Error: Could not start the latency probe.\n");
+            return 1;
+        }
+    }
+
+    // sampling mode replaces the tables with a report of growing processes
+    if (interval > 0)
+    {
+        int result = runSampling(interval, samples, pidArgument, publisher, &scanOptions, showStats);
+        if (probe != NULL)
+        {
+            stopLatencyProbe(probe);
+            printLatencyProbe(probe, stdout);
+            free(probe);
+        }
+        closeSharedSnapshotPublisher(publisher, 0);
+        freeRowFilter(filter);
+        return result;
+    }
+
+    // retrieve an array of processes, within the budget of the scan
+    if (scanOptions.budget != NULL)
+    {
+        initScanBudget(scanOptions.budget, scanOptions.budget->share);
+    }
     int numProcessesFound;
-    ProcessData **processes = fetchProcesses(&numProcessesFound, pidArgument);
+    ProcessData **processes = fetchProcesses(&numProcessesFound, pidArgument, scanOptions.budget);
     if (processes == NULL) {
         fprintf(stderr, "Error: Could not read processes.\n");
         return 1;
     }
 
-    // retrieve file descriptor information
-    for (int i = 0; i < numProcessesFound; i++)
+    // expected numbers of file descriptors size the array of each process, and order a scan on several threads
+    FdCountCache *countCache = NULL;
+    if (countCachePath != NULL)
+    {
+        countCache = loadFdCountCache(countCachePath);
+        if (countCache == NULL)
+        {
+            fprintf(stderr, "Error: Could not allocate file descriptor count cache.\n");
+            return 1;
+        }
+    }
+    if (countCache != NULL || (numThreads > 1 && !pipelined && scanOrder == SCAN_ORDER_LARGEST_FIRST))
+    {
+        estimateFileDescriptorCounts(processes, numProcessesFound, countCache, &scanOptions);
+    }
+    freeFdCountCache(countCache);
+
+    // scan, format and write the table at the same time, freeing processes once written
+    if (pipelined)
     {
-        if (readFileDescriptors(processes[i]) != 0)
+        int result = 0;
+        if (pipelineRows)
         {
-            fprintf(stderr, "Error: Could not read file descriptors for process %ld.\n", processes[i]->pid);
-            return -1;
+            result = printPipelined(processes, numProcessesFound, format, columns, numThreads, &scanOptions, outputTxt, showStats);
         }
+        else
+        {
+            result = runPipeline(processes, numProcessesFound, numThreads, &scanOptions, NULL, NULL, 0, stdout, NULL) != 0;
+            freeProcesses(processes, numProcessesFound);
+        }
+        printScanReport(&scanOptions, showStats, stderr);
+        if (probe != NULL)
+        {
+            stopLatencyProbe(probe);
+            printLatencyProbe(probe, stderr);
+            free(probe);
+        }
+        if (showByCgroup)
+            print_cgroup_table(scanOptions.groups, stdout);
+        if (showByNetns)
+            print_netns_table(scanOptions.groups, stdout);
+        freeProcessGroups(scanOptions.groups);
+        freeRowFilter(filter);
+        return result;
+    }
+
+    // retrieve file descriptor information
+    ScanScheduleStats scheduleStats;
+    if (scanProcesses(processes, numProcessesFound, numThreads, scanOrder, &scanOptions, &scheduleStats) != 0)
+    {
+        fprintf(stderr, "Error: Could not read file descriptors.\n");
+        return -1;
+    }
+    printScanReport(&scanOptions, showStats, stderr);
+    if (showStats)
+    {
+        fprintf(stderr, "## Scan took %.2f ms on %d threads (%s, first thread idle after %.2f ms, largest process %lu file descriptors)\n",
+                scheduleStats.makespanMs, scheduleStats.numThreads, scanOrder == SCAN_ORDER_LARGEST_FIRST ? "largest first" : "listed order",
+                scheduleStats.firstIdleMs, scheduleStats.largestProcess);
+    }
+    if (countCachePath != NULL && saveFdCountCache(countCachePath, processes, numProcessesFound) != 0)
+    {
+        fprintf(stderr, "Warning: Could not save file descriptor counts to %s.\n", countCachePath);
+    }
+    if (probe != NULL)
+    {
+        stopLatencyProbe(probe);
+        printLatencyProbe(probe, stderr);
+        free(probe);
+    }
+
+    // machine-readable formats are streamed through a large buffer
+    if (format != FORMAT_TEXT)
+    {
+        setvbuf(stdout, NULL, _IOFBF, OUTPUT_BUFFER_SIZE);
     }
 
     // print process FD table
     if (showPerProcess)
     {
-        print_table(print_perProcess_header, print_perProcess_content, print_perProcess_footer, processes, numProcessesFound, stdout);
+        print_table_formatted(TABLE_PER_PROCESS, format, processes, numProcessesFound, stdout);
     }
 
-    // print system-wide FD table
+    // print system-wide FD table, with socket details joined in from sock_diag
+    SocketTable *sockets = NULL;
+    if (showSystemWide || (columns & COLUMN_MASK(socket)))
+    {
+        sockets = fetchSockets();
+        if (sockets == NULL)
+        {
+            fprintf(stderr, "Warning: Could not read socket details through sock_diag.\n");
+        }
+        else
+        {
+            joinSockets(sockets, processes, numProcessesFound);
+        }
+    }
     if (showSystemWide)
     {
-        print_table(print_systemWide_header, print_systemWide_content, print_systemWide_footer, processes, numProcessesFound, stdout);
+        print_table_formatted(TABLE_SYSTEM_WIDE, format, processes, numProcessesFound, stdout);
     }
 
     // print Vnodes table
     if (showVnodes)
     {
-        print_table(print_vnodes_header, print_vnodes_content, print_vnodes_footer, processes, numProcessesFound, stdout);
+        print_table_formatted(TABLE_VNODES, format, processes, numProcessesFound, stdout);
     }
 
-    // show composite table if explicitly given in arguments, or if no table arguments were given
-    if (showComposite || (!showPerProcess && !showSystemWide && !showVnodes && !showComposite))
+    // print the table of custom columns
+    if (columns != 0)
+    {
+        print_columns(format, columns, processes, numProcessesFound, stdout);
+    }
+
+    // print composite table
+    if (showComposite)
     {
-        print_table(print_composite_header, print_composite_content, print_composite_footer, processes, numProcessesFound, stdout);
+        print_table_formatted(TABLE_COMPOSITE, format, processes, numProcessesFound, stdout);
+    }
+
+    // print the rollups of file descriptors by cgroup and network namespace
+    if (showByCgroup)
+    {
+        print_cgroup_table(scanOptions.groups, stdout);
+    }
+    if (showByNetns)
+    {
+        print_netns_table(scanOptions.groups, stdout);
     }
 
     // output composite table to .txt file
-    if (outputTxt) {
+    if (outputTxt && numThreads > 1) {
+        int txtFd = open(TXT_OUT_NAME, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (txtFd == -1) {
+            perror("Error: Could not open .txt output file");
+            return 1;
+        }
+        if (print_table_parallel(print_composite_header, print_composite_content, print_composite_footer, processes, numProcessesFound, txtFd, numThreads) != 0) {
+            perror("Error: Could not write .txt output file");
+            close(txtFd);
+            return 1;
+        }
+        close(txtFd);
+    }
+    else if (outputTxt) {
         FILE* txtStream = fopen(TXT_OUT_NAME, "w");
         if (txtStream == NULL) {
             perror("Error: Could not open .txt output file");
@@ -227,18 +843,36 @@ int main(int argc, char **argv)
 
     // output process and file descriptor data to binary
     else if (outputBinary) {
-        if (print_composite_binary(BINARY_OUT_NAME, processes, numProcessesFound) != 0) {
+        // custom columns replace the composite columns in the binary file
+        if (print_columns_binary(BINARY_OUT_NAME, columns != 0 ? columns : COMPOSITE_COLUMNS, processes, numProcessesFound) != 0) {
             fprintf(stderr, "Error: Could not output to binary.\n");
             return 1;
         }
     }
 
+    // publish the snapshot to shared memory, where it stays for readers after exiting
+    if (publisher != NULL) {
+        int published = publishSharedSnapshot(publisher, processes, numProcessesFound) == 0;
+        closeSharedSnapshotPublisher(publisher, 0);
+        if (!published) {
+            fprintf(stderr, "Error: Could not publish snapshot to shared memory.\n");
+            freeProcesses(processes, numProcessesFound);
+            freeSockets(sockets);
+            freeProcessGroups(scanOptions.groups);
+            freeRowFilter(filter);
+            return 1;
+        }
+    }
+
     // print offending processes
     if (thresholdSet) {
         printOffendingProcesses(threshold, processes, numProcessesFound);
     }
 
     freeProcesses(processes, numProcessesFound);
+    freeSockets(sockets);
+    freeProcessGroups(scanOptions.groups);
+    freeRowFilter(filter);
 
     return 0;
 }
\ No newline at end of file
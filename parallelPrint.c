@@ -0,0 +1,261 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "processes.h"
+#include "parallelPrint.h"
+
+/**
+ * State shared by the threads printing one table. Ranges are written strictly in order: range k
+ * may only write once the lengths of ranges 0..k-1 are known (positional writes) or once they
+ * have been written (sequential writes).
+ */
+typedef struct PrintJob
+{
+    void (*print_content)(ProcessData *, FILE *);
+    int fd;
+    /**
+     * Whether fd is a regular file that ranges can be written to with pwrite at their own offset
+    */
+    int positional;
+    pthread_mutex_t lock;
+    pthread_cond_t turnChanged;
+    /**
+     * Index of the next range allowed to claim its offset
+    */
+    int turn;
+    /**
+     * Offset at which the range whose turn it is will be written
+    */
+    off_t nextOffset;
+    /**
+     * Set when formatting or writing any range failed; later ranges are then not written
+    */
+    int failed;
+} PrintJob;
+
+/**
+ * A contiguous range of processes formatted by one thread into a private buffer
+ */
+typedef struct PrintRange
+{
+    PrintJob *job;
+    int index;
+    ProcessData **processes;
+    size_t start;
+    size_t end;
+} PrintRange;
+
+/**
+ * Write a whole buffer, at the given offset or at the current position of fd.
+ * @param fd File to write to
+ * @param buffer Bytes to write
+ * @param length Number of bytes to write
+ * @param offset Offset to write at, or -1 to write at the current position
+ * @return 0 if all bytes were written, -1 otherwise
+ */
+static int write_fully(int fd, const char *buffer, size_t length, off_t offset)
+{
+    while (length > 0)
+    {
+        ssize_t written = offset < 0 ? write(fd, buffer, length) : pwrite(fd, buffer, length, offset);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        buffer += written;
+        length -= written;
+        if (offset >= 0)
+            offset += written;
+    }
+    return 0;
+}
+
+/**
+ * Format a range of processes into memory, then write it once its turn comes.
+ * @param argument The PrintRange to print
+ * @return NULL
+ */
+static void *print_range(void *argument)
+{
+    PrintRange *range = (PrintRange *)argument;
+    PrintJob *job = range->job;
+
+    char *buffer = NULL;
+    size_t length = 0;
+    FILE *stream = open_memstream(&buffer, &length);
+    int failed = stream == NULL;
+    if (stream != NULL)
+    {
+        for (size_t i = range->start; i < range->end; i++)
+        {
+            job->print_content(range->processes[i], stream);
+        }
+        failed = fclose(stream) != 0;
+    }
+
+    pthread_mutex_lock(&job->lock);
+    while (job->turn != range->index)
+        pthread_cond_wait(&job->turnChanged, &job->lock);
+    job->failed |= failed;
+    // read under the lock, as ranges writing with pwrite may set failed at any time
+    int skip = job->failed;
+    off_t offset = job->nextOffset;
+    if (job->positional)
+    {
+        // the offset of the next range is known as soon as this one is formatted
+        job->nextOffset += length;
+        job->turn++;
+        pthread_cond_broadcast(&job->turnChanged);
+        pthread_mutex_unlock(&job->lock);
+        if (!skip && write_fully(job->fd, buffer, length, offset) != 0)
+        {
+            pthread_mutex_lock(&job->lock);
+            job->failed = 1;
+            pthread_mutex_unlock(&job->lock);
+        }
+    }
+    else
+    {
+        // streams are written in order, so the next range waits until this one is written
+        pthread_mutex_unlock(&job->lock);
+        int writeFailed = !skip && write_fully(job->fd, buffer, length, -1) != 0;
+        pthread_mutex_lock(&job->lock);
+        job->failed |= writeFailed;
+        job->nextOffset += length;
+        job->turn++;
+        pthread_cond_broadcast(&job->turnChanged);
+        pthread_mutex_unlock(&job->lock);
+    }
+    free(buffer);
+    return NULL;
+}
+
+/**
+ * Format a header or footer into memory and write it at the given offset.
+ * @param print Function printing the header or footer
+ * @param fd File to write to
+ * @param offset Offset to write at, or -1 to write at the current position
+ * @param length Pointer to where the number of bytes written will be assigned to
+ * @return 0 if operation was successful, -1 otherwise
+ */
+static int print_fixed(void (*print)(FILE *), int fd, off_t offset, size_t *length)
+{
+    char *buffer = NULL;
+    *length = 0;
+    FILE *stream = open_memstream(&buffer, length);
+    if (stream == NULL)
+        return -1;
+    print(stream);
+    int result = fclose(stream) != 0 ? -1 : write_fully(fd, buffer, *length, offset);
+    free(buffer);
+    return result;
+}
+
+/**
+ * Print process and file descriptor data to a file descriptor, formatting contiguous ranges of
+ * processes on separate threads. Ranges hold about the same number of rows. Output is identical
+ * to print_table: when fd is a regular file each range is written with pwrite at its offset as
+ * soon as all earlier ranges are formatted, otherwise ranges are written one after the other.
+ * @param print_header Function used to print the table header
+ * @param print_content Function used to print a process in the table. It must only write to the stream given.
+ * @param print_footer Function used to print the table footer
+ * @param processes An array of all processes to consider.
+ * @param numProcesses The size of the processes array.
+ * @param fd File descriptor to output to
+ * @param numThreads Number of threads formatting the table, at most MAX_PRINT_THREADS
+ * @return 0 if operation was successful, -1 otherwise
+ */
+int print_table_parallel(void (*print_header)(FILE *),
+                         void (*print_content)(ProcessData *, FILE *),
+                         void (*print_footer)(FILE *),
+                         ProcessData **processes,
+                         size_t numProcesses,
+                         int fd,
+                         int numThreads)
+{
+    if (numThreads < 1)
+        numThreads = 1;
+    if (numThreads > MAX_PRINT_THREADS)
+        numThreads = MAX_PRINT_THREADS;
+
+    PrintJob job;
+    job.print_content = print_content;
+    job.fd = fd;
+    job.turn = 0;
+    job.failed = 0;
+    pthread_mutex_init(&job.lock, NULL);
+    pthread_cond_init(&job.turnChanged, NULL);
+
+    // pwrite ignores the offset of files opened with O_APPEND, so those are written as streams
+    struct stat stats;
+    int flags = fcntl(fd, F_GETFL);
+    off_t base = lseek(fd, 0, SEEK_CUR);
+    job.positional = fstat(fd, &stats) == 0 && S_ISREG(stats.st_mode) && flags != -1 && !(flags & O_APPEND) && base >= 0;
+
+    size_t headerLength;
+    if (print_fixed(print_header, fd, job.positional ? base : -1, &headerLength) != 0)
+        return -1;
+    job.nextOffset = (job.positional ? base : 0) + headerLength;
+
+    // split processes into contiguous ranges of about the same number of rows, counting a row
+    // per process so that processes without file descriptors are also spread out
+    size_t totalRows = 0;
+    for (size_t i = 0; i < numProcesses; i++)
+        totalRows += processes[i]->size + 1;
+
+    PrintRange ranges[MAX_PRINT_THREADS];
+    pthread_t threads[MAX_PRINT_THREADS];
+    int started[MAX_PRINT_THREADS];
+    size_t start = 0;
+    size_t rows = 0;
+    for (int k = 0; k < numThreads; k++)
+    {
+        size_t end = start;
+        size_t target = totalRows * (k + 1) / numThreads;
+        while (end < numProcesses && (rows < target || k == numThreads - 1))
+        {
+            rows += processes[end]->size + 1;
+            end++;
+        }
+        ranges[k].job = &job;
+        ranges[k].index = k;
+        ranges[k].processes = processes;
+        ranges[k].start = start;
+        ranges[k].end = end;
+        start = end;
+    }
+
+    // the last range is formatted on this thread; ranges whose thread could not start are too
+    for (int k = 0; k < numThreads - 1; k++)
+        started[k] = pthread_create(&threads[k], NULL, print_range, &ranges[k]) == 0;
+    for (int k = 0; k < numThreads - 1; k++)
+    {
+        if (!started[k])
+            print_range(&ranges[k]);
+    }
+    print_range(&ranges[numThreads - 1]);
+    for (int k = 0; k < numThreads - 1; k++)
+    {
+        if (started[k])
+            pthread_join(threads[k], NULL);
+    }
+
+    size_t footerLength;
+    int result = job.failed ? -1 : print_fixed(print_footer, fd, job.positional ? job.nextOffset : -1, &footerLength);
+    // leave the position of fd after the table, as if it had been written sequentially
+    if (result == 0 && job.positional)
+        lseek(fd, job.nextOffset + footerLength, SEEK_SET);
+
+    pthread_cond_destroy(&job.turnChanged);
+    pthread_mutex_destroy(&job.lock);
+    return result;
+}
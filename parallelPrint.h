@@ -0,0 +1,17 @@
+#ifndef PARALLEL_PRINT_H
+#define PARALLEL_PRINT_H
+
+#include <stdio.h>
+#include "processes.h"
+
+#define MAX_PRINT_THREADS 64
+
+extern int print_table_parallel(void (*print_header)(FILE *),
+                                void (*print_content)(ProcessData *, FILE *),
+                                void (*print_footer)(FILE *),
+                                ProcessData **processes,
+                                size_t numProcesses,
+                                int fd,
+                                int numThreads);
+
+#endif
@@ -0,0 +1,331 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "processes.h"
+#include "columns.h"
+#include "readFileDescriptors.h"
+#include "readProcesses.h"
+#include "readSockets.h"
+#include "spscQueue.h"
+#include "pipeline.h"
+
+/**
+ * A contiguous range of processes moving through the pipeline
+ */
+typedef struct PipelineBatch
+{
+    size_t start;
+    size_t end;
+    /**
+     * Rows of the batch, formatted by the formatter and freed by the writer
+    */
+    char *text;
+    size_t length;
+    /**
+     * Set by the scanner if file descriptors of the batch could not be read, or by the formatter
+     * if the batch could not be formatted
+    */
+    int failed;
+} PipelineBatch;
+
+/**
+ * State shared by the stages of one pipeline
+ */
+typedef struct Pipeline
+{
+    ProcessData **processes;
+    PipelineBatch *batches;
+    size_t numBatches;
+    int numScanners;
+    /**
+     * Queues from each scanner to the formatter. Scanner k handles batches k, k + numScanners, ...
+     * so the formatter restores the order of batches by visiting the queues in turn.
+    */
+    SpscQueue *scanned[MAX_PIPELINE_SCANNERS];
+    /**
+     * Queue from the formatter to the writer
+    */
+    SpscQueue *formatted;
+    void (*print_content)(ProcessData *, unsigned int, FILE *);
+    /**
+     * Mask of the columns passed to print_content
+    */
+    unsigned int columns;
+    FILE *stream;
+    /**
+     * Sockets joined to each batch once scanned, NULL if sockets are not printed
+    */
+    SocketTable *sockets;
+    /**
+     * Options of each scanner, sharing the filter of the pipeline but counting separately
+    */
+    ScanOptions scanOptions[MAX_PIPELINE_SCANNERS];
+    ScanStats scanStats[MAX_PIPELINE_SCANNERS];
+    /**
+     * Budgets of each scanner, sharing the CPU budget of the pipeline equally. Unused if budgetShare is 0.
+    */
+    ScanBudget scanBudgets[MAX_PIPELINE_SCANNERS];
+    double budgetShare;
+    unsigned long scannerStalls[MAX_PIPELINE_SCANNERS];
+    unsigned long formatterWaits;
+    unsigned long formatterStalls;
+    unsigned long writerWaits;
+    int failed;
+    /**
+     * Stages wait until started is set, so that numScanners and numBatches are final before any
+     * stage reads them
+    */
+    pthread_mutex_t startLock;
+    pthread_cond_t startChanged;
+    int started;
+} Pipeline;
+
+/**
+ * Arguments of a scanner thread
+ */
+typedef struct ScannerArgument
+{
+    Pipeline *pipeline;
+    int index;
+} ScannerArgument;
+
+/**
+ * Wait until all stages of the pipeline are created.
+ * @param pipeline Pipeline to wait for
+ */
+static void waitForStart(Pipeline *pipeline)
+{
+    pthread_mutex_lock(&pipeline->startLock);
+    while (!pipeline->started)
+        pthread_cond_wait(&pipeline->startChanged, &pipeline->startLock);
+    pthread_mutex_unlock(&pipeline->startLock);
+}
+
+/**
+ * Read the file descriptors of every batch assigned to a scanner and hand them to the formatter.
+ * @param argument The ScannerArgument of the scanner
+ * @return NULL
+ */
+static void *scanBatches(void *argument)
+{
+    Pipeline *pipeline = ((ScannerArgument *)argument)->pipeline;
+    int index = ((ScannerArgument *)argument)->index;
+    waitForStart(pipeline);
+    // the CPU time of a budget is that of the thread it starts on
+    if (pipeline->budgetShare > 0)
+    {
+        initScanBudget(&pipeline->scanBudgets[index], pipeline->budgetShare / pipeline->numScanners);
+        pipeline->scanOptions[index].budget = &pipeline->scanBudgets[index];
+    }
+    for (size_t j = index; j < pipeline->numBatches; j += pipeline->numScanners)
+    {
+        PipelineBatch *batch = &pipeline->batches[j];
+        for (size_t i = batch->start; i < batch->end; i++)
+        {
+            if (readFileDescriptors(pipeline->processes[i], &pipeline->scanOptions[index]) != 0)
+                batch->failed = 1;
+        }
+        // the table is only read, so scanners can join their batches concurrently
+        if (pipeline->sockets != NULL)
+            joinSockets(pipeline->sockets, pipeline->processes + batch->start, batch->end - batch->start);
+        spscPush(pipeline->scanned[index], batch, &pipeline->scannerStalls[index]);
+    }
+    return NULL;
+}
+
+/**
+ * Format every batch into memory, in order, and hand them to the writer.
+ * @param argument The Pipeline
+ * @return NULL
+ */
+static void *formatBatches(void *argument)
+{
+    Pipeline *pipeline = (Pipeline *)argument;
+    waitForStart(pipeline);
+    for (size_t j = 0; j < pipeline->numBatches; j++)
+    {
+        PipelineBatch *batch = (PipelineBatch *)spscPop(pipeline->scanned[j % pipeline->numScanners], &pipeline->formatterWaits);
+        FILE *stream = pipeline->print_content != NULL ? open_memstream(&batch->text, &batch->length) : NULL;
+        if (pipeline->print_content == NULL)
+        {
+            batch->length = 0;
+        }
+        else if (stream == NULL)
+        {
+            batch->failed = 1;
+        }
+        else
+        {
+            for (size_t i = batch->start; i < batch->end; i++)
+            {
+                pipeline->print_content(pipeline->processes[i], pipeline->columns, stream);
+            }
+            batch->failed |= fclose(stream) != 0;
+        }
+        spscPush(pipeline->formatted, batch, &pipeline->formatterStalls);
+    }
+    return NULL;
+}
+
+/**
+ * Write every formatted batch to the output stream, in order, then free its processes.
+ * @param argument The Pipeline
+ * @return NULL
+ */
+static void *writeBatches(void *argument)
+{
+    Pipeline *pipeline = (Pipeline *)argument;
+    waitForStart(pipeline);
+    for (size_t j = 0; j < pipeline->numBatches; j++)
+    {
+        PipelineBatch *batch = (PipelineBatch *)spscPop(pipeline->formatted, &pipeline->writerWaits);
+        if (batch->failed || (batch->length > 0 && fwrite_unlocked(batch->text, 1, batch->length, pipeline->stream) != batch->length))
+            pipeline->failed = 1;
+        free(batch->text);
+        batch->text = NULL;
+        for (size_t i = batch->start; i < batch->end; i++)
+        {
+            freeProcess(pipeline->processes[i]);
+            pipeline->processes[i] = NULL;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Read the file descriptors of processes and print them, with scanning, formatting and writing
+ * overlapped on separate threads. Processes move through the stages in batches of
+ * PIPELINE_BATCH_SIZE over bounded queues, so a slow stage makes the stages before it wait
+ * rather than buffering the whole table. Rows are printed in the order of the processes array.
+ * Each process is freed once written, and its slot in processes is set to NULL. The caller keeps
+ * the array and every process left in it, and frees them with freeProcesses whatever the result:
+ * if a thread of the pipeline cannot be started, nothing is scanned, written or freed.
+ * @param processes An array of processes whose file descriptors are not read yet
+ * @param numProcesses The size of the processes array.
+ * @param numScanners Number of threads reading file descriptors, at most MAX_PIPELINE_SCANNERS
+ * @param options Columns, filter, counters, budget and rollups of the scan, may be NULL to resolve every column. Counters of all scanners are added to its stats, and their use of the CPU to its budget, which they share equally.
+ * @param sockets Sockets to join to the file descriptors of each batch, NULL to leave the socket of every file descriptor unset
+ * @param print_content Function used to print a process with the given columns, as returned by column_printer. It must only write to the stream given. If NULL, processes are only scanned.
+ * @param columns Mask of the columns to print
+ * @param stream Stream to output to. It must not be used by other threads until the pipeline returns.
+ * @param stats If not NULL, the number of times each stage waited is assigned to it
+ * @return 0 if operation was successful, -1 otherwise
+ */
+int runPipeline(ProcessData **processes,
+                int numProcesses,
+                int numScanners,
+                const ScanOptions *options,
+                SocketTable *sockets,
+                void (*print_content)(ProcessData *, unsigned int, FILE *),
+                unsigned int columns,
+                FILE *stream,
+                PipelineStats *stats)
+{
+    if (numScanners < 1)
+        numScanners = 1;
+    if (numScanners > MAX_PIPELINE_SCANNERS)
+        numScanners = MAX_PIPELINE_SCANNERS;
+
+    Pipeline pipeline;
+    memset(&pipeline, 0, sizeof(pipeline));
+    pipeline.processes = processes;
+    pipeline.numScanners = numScanners;
+    pipeline.print_content = print_content;
+    pipeline.columns = columns;
+    pipeline.stream = stream;
+    pipeline.sockets = sockets;
+    pipeline.numBatches = (numProcesses + PIPELINE_BATCH_SIZE - 1) / PIPELINE_BATCH_SIZE;
+    pipeline.budgetShare = options != NULL && options->budget != NULL ? options->budget->share : 0;
+
+    // batches are allocated up front, so stages never fail halfway and leave the others waiting
+    pipeline.batches = (PipelineBatch *)calloc(pipeline.numBatches + 1, sizeof(PipelineBatch));
+    int result = pipeline.batches == NULL ? -1 : 0;
+    for (size_t j = 0; j < pipeline.numBatches && result == 0; j++)
+    {
+        pipeline.batches[j].start = j * PIPELINE_BATCH_SIZE;
+        pipeline.batches[j].end = j * PIPELINE_BATCH_SIZE + PIPELINE_BATCH_SIZE < numProcesses ? j * PIPELINE_BATCH_SIZE + PIPELINE_BATCH_SIZE : numProcesses;
+    }
+    for (int k = 0; k < numScanners && result == 0; k++)
+    {
+        pipeline.scanOptions[k].columns = options != NULL ? options->columns : ALL_COLUMNS;
+        pipeline.scanOptions[k].filter = options != NULL ? options->filter : NULL;
+        pipeline.scanOptions[k].types = options != NULL ? options->types : 0;
+        pipeline.scanOptions[k].groups = options != NULL ? options->groups : NULL;
+        pipeline.scanOptions[k].stats = options != NULL && options->stats != NULL ? &pipeline.scanStats[k] : NULL;
+        pipeline.scanned[k] = createSpscQueue(PIPELINE_QUEUE_CAPACITY);
+        if (pipeline.scanned[k] == NULL)
+            result = -1;
+    }
+    pipeline.formatted = result == 0 ? createSpscQueue(PIPELINE_QUEUE_CAPACITY) : NULL;
+    if (pipeline.formatted == NULL)
+        result = -1;
+
+    ScannerArgument arguments[MAX_PIPELINE_SCANNERS];
+    pthread_t scanners[MAX_PIPELINE_SCANNERS];
+    pthread_t formatter;
+    pthread_t writer;
+    int formatterStarted = 0;
+    int writerStarted = 0;
+    int numStarted = 0;
+    pthread_mutex_init(&pipeline.startLock, NULL);
+    pthread_cond_init(&pipeline.startChanged, NULL);
+    if (result == 0)
+    {
+        writerStarted = pthread_create(&writer, NULL, writeBatches, &pipeline) == 0;
+        formatterStarted = pthread_create(&formatter, NULL, formatBatches, &pipeline) == 0;
+        for (; numStarted < numScanners; numStarted++)
+        {
+            arguments[numStarted].pipeline = &pipeline;
+            arguments[numStarted].index = numStarted;
+            if (pthread_create(&scanners[numStarted], NULL, scanBatches, &arguments[numStarted]) != 0)
+                break;
+        }
+        // continue with the scanners that started; without a formatter or writer, all stages stop at once
+        if (!writerStarted || !formatterStarted || numStarted == 0)
+        {
+            pipeline.numBatches = 0;
+            result = -1;
+        }
+        pipeline.numScanners = numStarted;
+    }
+
+    pthread_mutex_lock(&pipeline.startLock);
+    pipeline.started = 1;
+    pthread_cond_broadcast(&pipeline.startChanged);
+    pthread_mutex_unlock(&pipeline.startLock);
+    for (int k = 0; k < numStarted; k++)
+        pthread_join(scanners[k], NULL);
+    if (formatterStarted)
+        pthread_join(formatter, NULL);
+    if (writerStarted)
+        pthread_join(writer, NULL);
+    if (pipeline.failed)
+        result = -1;
+
+    for (int k = 0; k < numStarted; k++)
+    {
+        if (pipeline.scanOptions[k].stats != NULL)
+            addScanStats(options->stats, pipeline.scanOptions[k].stats);
+        if (pipeline.scanOptions[k].budget != NULL)
+            addScanBudget(options->budget, pipeline.scanOptions[k].budget);
+    }
+    if (stats != NULL)
+    {
+        memset(stats, 0, sizeof(PipelineStats));
+        for (int k = 0; k < numStarted; k++)
+            stats->scannerStalls += pipeline.scannerStalls[k];
+        stats->formatterWaits = pipeline.formatterWaits;
+        stats->formatterStalls = pipeline.formatterStalls;
+        stats->writerWaits = pipeline.writerWaits;
+    }
+    for (int k = 0; k < numScanners; k++)
+        freeSpscQueue(pipeline.scanned[k]);
+    freeSpscQueue(pipeline.formatted);
+    free(pipeline.batches);
+    pthread_cond_destroy(&pipeline.startChanged);
+    pthread_mutex_destroy(&pipeline.startLock);
+    return result;
+}
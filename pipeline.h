@@ -0,0 +1,46 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stdio.h>
+#include "processes.h"
+#include "readFileDescriptors.h"
+#include "readSockets.h"
+
+#define PIPELINE_BATCH_SIZE 32
+#define PIPELINE_QUEUE_CAPACITY 8
+#define MAX_PIPELINE_SCANNERS 64
+
+/**
+ * Number of times each stage of a pipeline found its queue full (backpressure) or empty
+ */
+typedef struct PipelineStats
+{
+    /**
+     * Attempts of scanners to push to a full queue, summed over all scanners
+    */
+    unsigned long scannerStalls;
+    /**
+     * Attempts of the formatter to pop from an empty scanner queue
+    */
+    unsigned long formatterWaits;
+    /**
+     * Attempts of the formatter to push to a full writer queue
+    */
+    unsigned long formatterStalls;
+    /**
+     * Attempts of the writer to pop from an empty queue
+    */
+    unsigned long writerWaits;
+} PipelineStats;
+
+extern int runPipeline(ProcessData **processes,
+                       int numProcesses,
+                       int numScanners,
+                       const ScanOptions *options,
+                       SocketTable *sockets,
+                       void (*print_content)(ProcessData *, unsigned int, FILE *),
+                       unsigned int columns,
+                       FILE *stream,
+                       PipelineStats *stats);
+
+#endif
@@ -1,6 +1,24 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <string.h>
+#include <stdint.h>
 #include "processes.h"
+#include "columns.h"
+#include "readSockets.h"
+#include "stringUtils.h"
+#include "printTables.h"
+
+// as large as a filename, so that both kinds of string columns share the same bound
+#define SOCKET_DESCRIPTION_BUFFER_SIZE SYMBOLIC_LINK_BUFFER_SIZE
+#define NUMBER_BUFFER_SIZE 24
+// large enough for every column of a row, with filenames and socket descriptions escaped
+#define ROW_BUFFER_SIZE 16384
+
+// every byte of a word set to the same value, for scanning 8 bytes at a time
+#define REPEAT_BYTE(x) (0x0101010101010101ull * (uint8_t)(x))
+
+// append a string literal to a row without measuring it at runtime
+#define APPEND_LITERAL(cursor, literal) (memcpy(cursor, literal, sizeof(literal) - 1), cursor + sizeof(literal) - 1)
 
 /**
  * Print header for the system-wide file descriptor table
@@ -21,20 +39,6 @@ void print_systemWide_footer(FILE *stream)
     fprintf(stream, "===============================\n");
 }
 
-/**
- * Print table rows of a process for the system-wide file descriptor table
- * @param process Process to print
- * @param stream Stream to output plain-text to
-*/
-void print_systemWide_content(ProcessData *process, FILE *stream)
-{
-    for (int i = 0; i < process->size; i++)
-    {
-        fprintf(stream, "%ld\t%ld\t%s\n", process->pid, process->fileDescriptors[i]->fd, process->fileDescriptors[i]->filename);
-    }
-    return;
-}
-
 /**
  * Print header for the process file descriptor table
  * @param stream Stream to output plain-text to
@@ -54,20 +58,6 @@ void print_perProcess_footer(FILE *stream)
     fprintf(stream, "===================\n");
 }
 
-/**
- * Print table rows of a process for the process file descriptor table
- * @param process Process to print
- * @param stream Stream to output plain-text to
-*/
-void print_perProcess_content(ProcessData *process, FILE *stream)
-{
-    for (int i = 0; i < process->size; i++)
-    {
-        fprintf(stream, "%ld\t%ld\n", process->pid, process->fileDescriptors[i]->fd);
-    }
-    return;
-}
-
 /**
  * Print header for the Vnodes file descriptor table
  * @param stream Stream to output plain-text to
@@ -87,25 +77,6 @@ void print_vnodes_footer(FILE *stream)
     fprintf(stream, "===================\n");
 }
 
-/**
- * Print table rows of a process for the Vnodes file descriptor table
- * @param process Process to print
- * @param stream Stream to output plain-text to
-*/
-/**
- * Print the Vnodes file descriptor table
- * @param rows Information for each row to print
- * @param size The number of elements in rows to print
- */
-void print_vnodes_content(ProcessData *process, FILE *stream)
-{
-    for (int i = 0; i < process->size; i++)
-    {
-        fprintf(stream, "%ld\t%ld\n", process->pid, process->fileDescriptors[i]->inode);
-    }
-    return;
-}
-
 /**
  * Print header for the composite table
  * @param stream Stream to output plain-text to
@@ -128,16 +99,11 @@ void print_composite_footer(FILE *stream)
 }
 
 /**
- * Print the composite table for a process
- * @param process Process to print
- * @param stream Stream to output plain-text to
- */
-void print_composite_content(ProcessData *process, FILE *stream)
+ * Print nothing, for formats without a header or footer
+ * @param stream Stream to output to
+*/
+void print_empty(FILE *stream)
 {
-    for (int i = 0; i < process->size; i++)
-    {
-        fprintf(stream, "%d\t%ld\t%ld\t%s\t%ld\n", i+1, process->pid, process->fileDescriptors[i]->fd, process->fileDescriptors[i]->filename, process->fileDescriptors[i]->inode);
-    }
     return;
 }
 
@@ -166,38 +132,673 @@ void print_table(void (*print_header)(FILE *),
 }
 
 /**
- * Save composite table to binary file.
+ * Append an unsigned number in decimal to a row, without going through printf.
+ * @param cursor Position in the row to write to
+ * @param value Number to write
+ * @return Position in the row after the number
+ */
+static char *append_unsigned(char *cursor, unsigned long value)
+{
+    char digits[NUMBER_BUFFER_SIZE];
+    int start = NUMBER_BUFFER_SIZE;
+    do
+    {
+        digits[--start] = '0' + value % 10;
+        value /= 10;
+    } while (value != 0);
+    memcpy(cursor, digits + start, NUMBER_BUFFER_SIZE - start);
+    return cursor + NUMBER_BUFFER_SIZE - start;
+}
+
+/**
+ * Append a string to a row as it is.
+ * @param cursor Position in the row to write to
+ * @param string String to write, NULL is written as an empty string
+ * @return Position in the row after the string
+ */
+static char *append_string(char *cursor, const char *string)
+{
+    size_t length = string != NULL ? strnlen(string, SYMBOLIC_LINK_BUFFER_SIZE) : 0;
+    memcpy(cursor, string, length);
+    return cursor + length;
+}
+
+/**
+ * Check whether any byte of a word is a control character (below 0x20).
+ * @param word 8 bytes of a string
+ * @return Nonzero if any byte is below 0x20
+ */
+static inline uint64_t has_control_byte(uint64_t word)
+{
+    return (word - REPEAT_BYTE(0x20)) & ~word & REPEAT_BYTE(0x80);
+}
+
+/**
+ * Check whether any byte of a word equals the given byte.
+ * @param word 8 bytes of a string
+ * @param byte Byte to search for
+ * @return Nonzero if any byte of word equals byte
+ */
+static inline uint64_t has_byte(uint64_t word, uint8_t byte)
+{
+    uint64_t matches = word ^ REPEAT_BYTE(byte);
+    return (matches - REPEAT_BYTE(0x01)) & ~matches & REPEAT_BYTE(0x80);
+}
+
+/**
+ * Find the length of a well-formed UTF-8 sequence of more than one byte (RFC 3629), rejecting
+ * overlong forms, surrogates and code points above U+10FFFF.
+ * @param string Sequence to check, starting with a byte of 0x80 or above
+ * @param length Number of bytes available in string
+ * @return Length of the sequence, or 0 if it is not well-formed
+ */
+static size_t utf8_sequence_length(const unsigned char *string, size_t length)
+{
+    unsigned char c = string[0];
+    size_t needed;
+    unsigned char low = 0x80;
+    unsigned char high = 0xBF;
+    if (c >= 0xC2 && c <= 0xDF)
+        needed = 2;
+    else if (c >= 0xE0 && c <= 0xEF)
+    {
+        needed = 3;
+        low = c == 0xE0 ? 0xA0 : 0x80;
+        high = c == 0xED ? 0x9F : 0xBF;
+    }
+    else if (c >= 0xF0 && c <= 0xF4)
+    {
+        needed = 4;
+        low = c == 0xF0 ? 0x90 : 0x80;
+        high = c == 0xF4 ? 0x8F : 0xBF;
+    }
+    else
+        return 0;
+    if (length < needed || string[1] < low || string[1] > high)
+        return 0;
+    for (size_t i = 2; i < needed; i++)
+    {
+        if ((string[i] & 0xC0) != 0x80)
+            return 0;
+    }
+    return needed;
+}
+
+/**
+ * Find how many leading bytes of a string can be copied as they are into a JSON string,
+ * scanning 8 bytes at a time. Filenames are arbitrary bytes, so only well-formed UTF-8 is
+ * copied; other bytes of 0x80 and above must be escaped.
+ * @param string String to scan
+ * @param length Length of string
+ * @return Index of the first byte that must be escaped, or length if there is none
+ */
+static size_t json_clean_prefix(const char *string, size_t length)
+{
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8)
+    {
+        uint64_t word;
+        memcpy(&word, string + i, 8);
+        if (has_control_byte(word) | has_byte(word, '"') | has_byte(word, '\\') | (word & REPEAT_BYTE(0x80)))
+            break;
+    }
+    // finish byte by byte from the first word that needs escaping or is not ASCII, or the tail
+    while (i < length)
+    {
+        unsigned char c = string[i];
+        if (c < 0x20 || c == '"' || c == '\\')
+            break;
+        if (c < 0x80)
+        {
+            i++;
+            continue;
+        }
+        size_t sequence = utf8_sequence_length((const unsigned char *)string + i, length - i);
+        if (sequence == 0)
+            break;
+        i += sequence;
+    }
+    return i;
+}
+
+/**
+ * Find how many leading bytes of a string can be copied as they are into a CSV field,
+ * scanning 8 bytes at a time.
+ * @param string String to scan
+ * @param length Length of string
+ * @return Index of the first byte that requires the field to be quoted, or length if there is none
+ */
+static size_t csv_clean_prefix(const char *string, size_t length)
+{
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8)
+    {
+        uint64_t word;
+        memcpy(&word, string + i, 8);
+        if (has_byte(word, ',') | has_byte(word, '"') | has_byte(word, '\n') | has_byte(word, '\r'))
+            break;
+    }
+    for (; i < length; i++)
+    {
+        char c = string[i];
+        if (c == ',' || c == '"' || c == '\n' || c == '\r')
+            break;
+    }
+    return i;
+}
+
+/**
+ * Append a string to a row as a quoted JSON string. Runs of bytes that need no escaping are copied in bulk.
+ * Bytes that are not part of well-formed UTF-8 are written as \u00XX, so every row is valid JSON.
+ * @param cursor Position in the row to write to
+ * @param string String to write, NULL is written as an empty string
+ * @return Position in the row after the string
+ */
+static char *append_json_string(char *cursor, const char *string)
+{
+    size_t length = string != NULL ? strnlen(string, SYMBOLIC_LINK_BUFFER_SIZE) : 0;
+    *cursor++ = '"';
+    while (length > 0)
+    {
+        size_t clean = json_clean_prefix(string, length);
+        memcpy(cursor, string, clean);
+        cursor += clean;
+        if (clean == length)
+            break;
+        unsigned char c = string[clean];
+        switch (c)
+        {
+        case '"':
+            cursor = APPEND_LITERAL(cursor, "\\\"");
+            break;
+        case '\\':
+            cursor = APPEND_LITERAL(cursor, "\\\\");
+            break;
+        case '\n':
+            cursor = APPEND_LITERAL(cursor, "\\n");
+            break;
+        case '\t':
+            cursor = APPEND_LITERAL(cursor, "\\t");
+            break;
+        case '\r':
+            cursor = APPEND_LITERAL(cursor, "\\r");
+            break;
+        default:
+            cursor += sprintf(cursor, "\\u%04x", c);
+            break;
+        }
+        string += clean + 1;
+        length -= clean + 1;
+    }
+    *cursor++ = '"';
+    return cursor;
+}
+
+/**
+ * Append a string to a row as a CSV field (RFC 4180). The field is only quoted if it contains
+ * a comma, quote or line break, in which case quotes are doubled.
+ * @param cursor Position in the row to write to
+ * @param string String to write, NULL is written as an empty field
+ * @return Position in the row after the field
+ */
+static char *append_csv_field(char *cursor, const char *string)
+{
+    size_t length = string != NULL ? strnlen(string, SYMBOLIC_LINK_BUFFER_SIZE) : 0;
+    size_t clean = csv_clean_prefix(string, length);
+    if (clean == length)
+    {
+        memcpy(cursor, string, length);
+        return cursor + length;
+    }
+    *cursor++ = '"';
+    memcpy(cursor, string, clean);
+    cursor += clean;
+    for (size_t i = clean; i < length; i++)
+    {
+        if (string[i] == '"')
+            *cursor++ = '"';
+        *cursor++ = string[i];
+    }
+    *cursor++ = '"';
+    return cursor;
+}
+
+/**
+ * Describe a socket for the socket column.
+ * @param socket Socket details of a file descriptor, or NULL
+ * @param buffer Buffer of size SOCKET_DESCRIPTION_BUFFER_SIZE to write the description to
+ * @return The description, or an empty string if socket is NULL
+ */
+static const char *socket_text(SocketInfo *socket, char *buffer)
+{
+    if (socket == NULL)
+        return "";
+    describeSocket(socket, buffer, SOCKET_DESCRIPTION_BUFFER_SIZE);
+    return buffer;
+}
+
+/*
+ * Row writers are generated from TABLE_COLUMNS for every format. Each format has one generic
+ * writer taking the column mask at runtime, used for --columns, and one writer specialized for
+ * each fixed table, which has its column mask as a compile-time constant, so the checks of which
+ * columns to write are folded away and a row is written without branching per field.
+ * Each format defines how to write each kind of column, and how to begin and end a row.
+ */
+
+// plain text: tab-separated, with trailing empty columns dropped
+#define TEXT_ROW_BEGIN
+#define TEXT_NUMBER(name, value) cursor = append_unsigned(cursor, value); *cursor++ = '\t';
+#define TEXT_ROW_NUMBER TEXT_NUMBER
+#define TEXT_PROCESS_NUMBER TEXT_NUMBER
+#define TEXT_STRING(name, value) cursor = append_string(cursor, value); *cursor++ = '\t';
+#define TEXT_TYPE(name, value) TEXT_STRING(name, fileDescriptorTypeName(value))
+#define TEXT_SOCKET(name, value) TEXT_STRING(name, socket_text(value, socketBuffer))
+#define TEXT_ROW_END                                \
+    while (cursor > line && cursor[-1] == '\t')     \
+        cursor--;                                   \
+    *cursor++ = '\n';
+
+// NDJSON: one object per row, sockets are only included for socket file descriptors
+#define NDJSON_ROW_BEGIN *cursor++ = '{';
+#define NDJSON_NUMBER(name, value) cursor = APPEND_LITERAL(cursor, "\"" #name "\":"); cursor = append_unsigned(cursor, value); *cursor++ = ',';
+#define NDJSON_ROW_NUMBER NDJSON_NUMBER
+#define NDJSON_PROCESS_NUMBER NDJSON_NUMBER
+#define NDJSON_STRING(name, value) cursor = APPEND_LITERAL(cursor, "\"" #name "\":"); cursor = append_json_string(cursor, value); *cursor++ = ',';
+#define NDJSON_TYPE(name, value) NDJSON_STRING(name, fileDescriptorTypeName(value))
+#define NDJSON_SOCKET(name, value) if (value != NULL) { NDJSON_STRING(name, socket_text(value, socketBuffer)) }
+#define NDJSON_ROW_END           \
+    if (cursor[-1] == ',')       \
+        cursor--;                \
+    *cursor++ = '}';             \
+    *cursor++ = '\n';
+
+// CSV: comma-separated, quoted when needed
+#define CSV_ROW_BEGIN
+#define CSV_NUMBER(name, value) cursor = append_unsigned(cursor, value); *cursor++ = ',';
+#define CSV_ROW_NUMBER CSV_NUMBER
+#define CSV_PROCESS_NUMBER CSV_NUMBER
+#define CSV_STRING(name, value) cursor = append_csv_field(cursor, value); *cursor++ = ',';
+#define CSV_TYPE(name, value) CSV_STRING(name, fileDescriptorTypeName(value))
+#define CSV_SOCKET(name, value) CSV_STRING(name, socket_text(value, socketBuffer))
+#define CSV_ROW_END          \
+    if (cursor > line)       \
+        cursor--;            \
+    *cursor++ = '\n';
+
+// binary: numbers as unsigned longs, strings as a size_t length followed by their bytes
+#define BINARY_ROW_BEGIN
+#define BINARY_NUMBER(name, value)                      \
+    {                                                   \
+        unsigned long number = value;                   \
+        memcpy(cursor, &number, sizeof(unsigned long)); \
+        cursor += sizeof(unsigned long);                \
+    }
+#define BINARY_ROW_NUMBER(name, value)
+#define BINARY_PROCESS_NUMBER(name, value)
+#define BINARY_STRING(name, value)                   \
+    {                                                \
+        const char *string = value;                  \
+        size_t length = string != NULL ? strnlen(string, SYMBOLIC_LINK_BUFFER_SIZE) : 0; \
+        memcpy(cursor, &length, sizeof(size_t));     \
+        cursor += sizeof(size_t);                    \
+        memcpy(cursor, string, length);              \
+        cursor += length;                            \
+    }
+#define BINARY_TYPE(name, value) *cursor++ = (char)(value);
+#define BINARY_SOCKET(name, value) BINARY_STRING(name, socket_text(value, socketBuffer))
+#define BINARY_ROW_END
+
+#define TEXT_COLUMN(name, header, kind, value) if (columnMask & COLUMN_MASK(name)) { TEXT_##kind(name, value) }
+#define NDJSON_COLUMN(name, header, kind, value) if (columnMask & COLUMN_MASK(name)) { NDJSON_##kind(name, value) }
+#define CSV_COLUMN(name, header, kind, value) if (columnMask & COLUMN_MASK(name)) { CSV_##kind(name, value) }
+#define BINARY_COLUMN(name, header, kind, value) if (columnMask & COLUMN_MASK(name)) { BINARY_##kind(name, value) }
+
+#define DEFINE_ROW_PRINTER(format, table, mask)                                                             \
+    static void print_##format##_##table(ProcessData *process, unsigned int columns, FILE *stream)          \
+    {                                                                                                       \
+        const unsigned int columnMask = (mask);                                                             \
+        char line[ROW_BUFFER_SIZE];                                                                         \
+        char socketBuffer[SOCKET_DESCRIPTION_BUFFER_SIZE] __attribute__((unused));                          \
+        for (unsigned long row = 0; row < process->size; row++)                                             \
+        {                                                                                                   \
+            FileDescriptorEntry *entry __attribute__((unused)) = process->fileDescriptors[row];             \
+            char *cursor = line;                                                                            \
+            format##_ROW_BEGIN                                                                              \
+            TABLE_COLUMNS(format##_COLUMN)                                                                  \
+            format##_ROW_END                                                                                \
+            fwrite_unlocked(line, 1, cursor - line, stream);                                                \
+        }                                                                                                   \
+    }
+
+// the generic writer of a format, then one writer for each fixed table, in the order of TableType
+#define DEFINE_FORMAT_PRINTERS(format)                                 \
+    DEFINE_ROW_PRINTER(format, columns, columns)                       \
+    DEFINE_ROW_PRINTER(format, perProcess, PER_PROCESS_COLUMNS)        \
+    DEFINE_ROW_PRINTER(format, systemWide, SYSTEM_WIDE_COLUMNS)        \
+    DEFINE_ROW_PRINTER(format, vnodes, VNODES_COLUMNS)                 \
+    DEFINE_ROW_PRINTER(format, composite, COMPOSITE_COLUMNS)
+
+#define FORMAT_PRINTERS(format) {print_##format##_perProcess, print_##format##_systemWide, print_##format##_vnodes, print_##format##_composite}
+
+DEFINE_FORMAT_PRINTERS(TEXT)
+DEFINE_FORMAT_PRINTERS(NDJSON)
+DEFINE_FORMAT_PRINTERS(CSV)
+DEFINE_FORMAT_PRINTERS(BINARY)
+
+_Static_assert(TABLE_TYPE_COUNT == 4, "FORMAT_PRINTERS lists a writer for each of the 4 fixed tables");
+
+/**
+ * Row writers specialized for each fixed table, indexed by [OutputFormat][TableType]
+ */
+static void (*const tablePrinters[OUTPUT_FORMAT_COUNT][TABLE_TYPE_COUNT])(ProcessData *, unsigned int, FILE *) = {
+    [FORMAT_TEXT] = FORMAT_PRINTERS(TEXT),
+    [FORMAT_NDJSON] = FORMAT_PRINTERS(NDJSON),
+    [FORMAT_CSV] = FORMAT_PRINTERS(CSV),
+};
+
+/**
+ * Generic row writers, indexed by OutputFormat
+ */
+static void (*const genericPrinters[OUTPUT_FORMAT_COUNT])(ProcessData *, unsigned int, FILE *) = {
+    [FORMAT_TEXT] = print_TEXT_columns,
+    [FORMAT_NDJSON] = print_NDJSON_columns,
+    [FORMAT_CSV] = print_CSV_columns,
+};
+
+/**
+ * Binary row writers specialized for each fixed table, indexed by TableType
+ */
+static void (*const binaryTablePrinters[TABLE_TYPE_COUNT])(ProcessData *, unsigned int, FILE *) = FORMAT_PRINTERS(BINARY);
+
+/**
+ * Column masks of the fixed tables, indexed by TableType
+ */
+static const unsigned int tableColumns[TABLE_TYPE_COUNT] = {PER_PROCESS_COLUMNS, SYSTEM_WIDE_COLUMNS, VNODES_COLUMNS, COMPOSITE_COLUMNS};
+
+/**
+ * Find the fixed table printing the given columns. Binary rows do not repeat the index and PID
+ * columns, so those are ignored.
+ * @param columns Mask of the columns to print
+ * @param ignored Mask of the columns that do not change the rows written
+ * @return The table with these columns, or TABLE_TYPE_COUNT if there is none
+ */
+static TableType fixed_table(unsigned int columns, unsigned int ignored)
+{
+    for (int table = 0; table < TABLE_TYPE_COUNT; table++)
+    {
+        if (((tableColumns[table] ^ columns) & ~ignored) == 0)
+            return table;
+    }
+    return TABLE_TYPE_COUNT;
+}
+
+#define COLUMN_NAME(name, header, kind, value) #name,
+#define COLUMN_HEADER(name, header, kind, value) header,
+
+/**
+ * Names of the columns, indexed by ColumnBit
+ */
+static const char *columnNames[COLUMN_COUNT] = {TABLE_COLUMNS(COLUMN_NAME)};
+
+/**
+ * Plain-text headings of the columns, indexed by ColumnBit
+ */
+static const char *columnHeaders[COLUMN_COUNT] = {TABLE_COLUMNS(COLUMN_HEADER)};
+
+/**
+ * Get the function printing the rows of a process with the given columns: the writer of the
+ * fixed table with these columns if there is one, and the generic writer of the format otherwise.
+ * @param format Format to print in
+ * @param columns Mask of the columns to print, to be passed to the function along with each process
+ * @return Function printing the rows of a process
+*/
+void (*column_printer(OutputFormat format, unsigned int columns))(ProcessData *, unsigned int, FILE *)
+{
+    TableType table = fixed_table(columns, 0);
+    return table != TABLE_TYPE_COUNT ? tablePrinters[format][table] : genericPrinters[format];
+}
+
+/**
+ * Print table rows of a process for the system-wide file descriptor table
+ * @param process Process to print
+ * @param stream Stream to output plain-text to
+*/
+void print_systemWide_content(ProcessData *process, FILE *stream)
+{
+    print_TEXT_systemWide(process, SYSTEM_WIDE_COLUMNS, stream);
+}
+
+/**
+ * Print table rows of a process for the process file descriptor table
+ * @param process Process to print
+ * @param stream Stream to output plain-text to
+*/
+void print_perProcess_content(ProcessData *process, FILE *stream)
+{
+    print_TEXT_perProcess(process, PER_PROCESS_COLUMNS, stream);
+}
+
+/**
+ * Print table rows of a process for the Vnodes file descriptor table
+ * @param process Process to print
+ * @param stream Stream to output plain-text to
+*/
+void print_vnodes_content(ProcessData *process, FILE *stream)
+{
+    print_TEXT_vnodes(process, VNODES_COLUMNS, stream);
+}
+
+/**
+ * Print the composite table for a process
+ * @param process Process to print
+ * @param stream Stream to output plain-text to
+ */
+void print_composite_content(ProcessData *process, FILE *stream)
+{
+    print_TEXT_composite(process, COMPOSITE_COLUMNS, stream);
+}
+
+/**
+ * Plain-text row writers of the fixed tables, as passed to print_table, indexed by TableType
+ */
+static void (*const tableContentPrinters[TABLE_TYPE_COUNT])(ProcessData *, FILE *) = {
+    print_perProcess_content, print_systemWide_content, print_vnodes_content, print_composite_content};
+
+/**
+ * Print the header of a table with the given columns.
+ * @param format Format to print in. NDJSON has no header.
+ * @param columns Mask of the columns to print
+ * @param stream Stream to output to
+*/
+void print_columns_header(OutputFormat format, unsigned int columns, FILE *stream)
+{
+    if (format == FORMAT_NDJSON)
+        return;
+    bool first = true;
+    for (int column = 0; column < COLUMN_COUNT; column++)
+    {
+        if (!(columns & (1u << column)))
+            continue;
+        if (!first)
+            putc(format == FORMAT_CSV ? ',' : '\t', stream);
+        fputs(format == FORMAT_CSV ? columnNames[column] : columnHeaders[column], stream);
+        first = false;
+    }
+    putc('\n', stream);
+    if (format == FORMAT_TEXT)
+        fprintf(stream, "===================\n");
+}
+
+/**
+ * Print the footer of a table with the given columns.
+ * @param format Format to print in. Only plain text has a footer.
+ * @param stream Stream to output to
+*/
+void print_columns_footer(OutputFormat format, FILE *stream)
+{
+    if (format == FORMAT_TEXT)
+        fprintf(stream, "===================\n");
+}
+
+/**
+ * Print a table with the given columns.
+ * @param format Format to print in
+ * @param columns Mask of the columns to print
+ * @param processes An array of all processes to consider.
+ * @param numProcesses The size of the processes array.
+ * @param stream Stream to output to
+*/
+void print_columns(OutputFormat format, unsigned int columns, ProcessData **processes, size_t numProcesses, FILE *stream)
+{
+    void (*print_content)(ProcessData *, unsigned int, FILE *) = column_printer(format, columns);
+    print_columns_header(format, columns, stream);
+    for (size_t i = 0; i < numProcesses; i++)
+    {
+        print_content(processes[i], columns, stream);
+    }
+    print_columns_footer(format, stream);
+}
+
+/**
+ * Columns and plain-text header and footer of each fixed table, indexed by TableType
+ */
+static const TableDefinition tableDefinitions[TABLE_TYPE_COUNT] = {
+    [TABLE_PER_PROCESS] = {PER_PROCESS_COLUMNS, print_perProcess_header, print_perProcess_footer},
+    [TABLE_SYSTEM_WIDE] = {SYSTEM_WIDE_COLUMNS, print_systemWide_header, print_systemWide_footer},
+    [TABLE_VNODES] = {VNODES_COLUMNS, print_vnodes_header, print_vnodes_footer},
+    [TABLE_COMPOSITE] = {COMPOSITE_COLUMNS, print_composite_header, print_composite_footer},
+};
+
+/**
+ * Get the columns and plain-text header and footer of a fixed table.
+ * @param table Table to describe
+ * @return Definition of the table
+*/
+const TableDefinition *table_definition(TableType table)
+{
+    return &tableDefinitions[table];
+}
+
+/**
+ * Print a table in the given format.
+ * @param table Table to print
+ * @param format Format to print the table in
+ * @param processes An array of all processes to consider.
+ * @param numProcesses The size of the processes array.
+ * @param stream Stream to output to
+*/
+void print_table_formatted(TableType table, OutputFormat format, ProcessData **processes, size_t numProcesses, FILE *stream)
+{
+    const TableDefinition *definition = &tableDefinitions[table];
+    if (format == FORMAT_TEXT)
+        print_table(definition->print_header, tableContentPrinters[table], definition->print_footer, processes, numProcesses, stream);
+    else
+        print_columns(format, definition->columns, processes, numProcesses, stream);
+}
+
+/**
+ * Parse the name of an output format.
+ * @param name Name of the format: "text", "ndjson" or "csv"
+ * @param format Pointer to where the format will be assigned to
+ * @return Returns 0 if operation was successful, 1 if the name is unknown
+*/
+int parse_output_format(const char *name, OutputFormat *format)
+{
+    if (strcmp(name, "text") == 0)
+        *format = FORMAT_TEXT;
+    else if (strcmp(name, "ndjson") == 0)
+        *format = FORMAT_NDJSON;
+    else if (strcmp(name, "csv") == 0)
+        *format = FORMAT_CSV;
+    else
+        return 1;
+    return 0;
+}
+
+/**
+ * Parse a comma-separated list of column names, e.g. "pid,fd,inode".
+ * @param list List of column names
+ * @param columns Pointer to where the mask of the columns will be assigned to
+ * @return Returns 0 if operation was successful, 1 if a name is unknown or the list is empty
+*/
+int parse_columns(const char *list, unsigned int *columns)
+{
+    *columns = 0;
+    while (*list != '\0')
+    {
+        size_t length = strcspn(list, ",");
+        int column = 0;
+        for (; column < COLUMN_COUNT; column++)
+        {
+            if (strlen(columnNames[column]) == length && strncmp(list, columnNames[column], length) == 0)
+                break;
+        }
+        if (column == COLUMN_COUNT)
+            return 1;
+        *columns |= 1u << column;
+        list += length;
+        if (*list == ',')
+            list++;
+    }
+    return *columns == 0;
+}
+
+/**
+ * Save the given columns of all processes to a binary file. The file starts with BINARY_MAGIC,
+ * the column mask and the number of types FD_TYPE_COUNT, followed by the number of file
+ * descriptors of each FileDescriptorType as unsigned longs, then by each process: its PID, inode
+ * and number of file descriptors, then the columns of each file descriptor in schema order. The
+ * index and PID columns are not repeated in every row. Types are counted whether or not the type
+ * column is saved, so they must have been resolved by the scan.
+ * @param fileName Name of the file to write
+ * @param columns Mask of the columns to save
  * @param processes Structs containing all processes and file descriptors to output to binary
  * @param numProcesses The total number of processes to output
- * @return Returns 0 if operation was successful, nonzero otherwise
+ * @return Returns 0 if operation was successful, -1 if the file could not be opened or written
 */
-int print_composite_binary(char* fileName, ProcessData **processes, int numProcesses) {
+int print_columns_binary(char *fileName, unsigned int columns, ProcessData **processes, int numProcesses)
+{
     FILE* binaryStream = fopen(fileName, "wb");
     if (binaryStream == NULL) {
         perror("Error opening to .bin output file");
         return -1;
     }
-    FileDescriptorEntry* point;
-    size_t filenameLen;
+    setvbuf(binaryStream, NULL, _IOFBF, OUTPUT_BUFFER_SIZE);
+    unsigned int fileHeader[3] = {BINARY_MAGIC, columns & (COLUMN_MASK_COUNT - 1), FD_TYPE_COUNT};
+    int failed = fwrite(fileHeader, sizeof(unsigned int), 3, binaryStream) != 3;
+    unsigned long byType[FD_TYPE_COUNT] = {0};
     for (size_t i = 0; i < numProcesses; i++)
     {
-        fwrite(&processes[i]->pid, sizeof(unsigned long), 1, binaryStream);
-        fwrite(&processes[i]->inode, sizeof(unsigned long), 1, binaryStream);
-        fwrite(&processes[i]->size, sizeof(unsigned long), 1, binaryStream); // number of fds
-        for (size_t j = 0; j < processes[i]->size; j++)
-        {
-            point = processes[i]->fileDescriptors[j];
-            filenameLen = strnlen(point->filename, SYMBOLIC_LINK_BUFFER_SIZE);
-            fwrite(&(point->fd), sizeof(unsigned long), 1, binaryStream);
-            fwrite(&(point->inode), sizeof(unsigned long), 1, binaryStream);
-            fwrite(&filenameLen, sizeof(size_t), 1, binaryStream); // length of string
-            for (size_t i = 0; i < filenameLen; i++) // filename string
-            {
-                fwrite(point->filename + i, sizeof(char), 1, binaryStream);
-            }
-        }
+        for (unsigned long fd = 0; fd < processes[i]->size; fd++)
+            byType[processes[i]->fileDescriptors[fd]->type < FD_TYPE_COUNT ? processes[i]->fileDescriptors[fd]->type : FD_TYPE_OTHER]++;
+    }
+    failed |= fwrite(byType, sizeof(unsigned long), FD_TYPE_COUNT, binaryStream) != FD_TYPE_COUNT;
+    TableType table = fixed_table(columns, PROCESS_COLUMNS);
+    void (*print_rows)(ProcessData *, unsigned int, FILE *) = table != TABLE_TYPE_COUNT ? binaryTablePrinters[table] : print_BINARY_columns;
+    for (size_t i = 0; i < numProcesses && !failed; i++)
+    {
+        failed |= fwrite(&processes[i]->pid, sizeof(unsigned long), 1, binaryStream) != 1;
+        failed |= fwrite(&processes[i]->inode, sizeof(unsigned long), 1, binaryStream) != 1;
+        failed |= fwrite(&processes[i]->size, sizeof(unsigned long), 1, binaryStream) != 1; // number of fds
+        print_rows(processes[i], columns, binaryStream);
+        // a row that could not be written leaves the stream in error
+        failed |= ferror(binaryStream) != 0;
+    }
+    // the end of the buffer is only written, and a full disk only noticed, when the file is closed
+    failed |= fclose(binaryStream) != 0;
+    if (failed) {
+        perror("Error writing to .bin output file");
+        return -1;
     }
-    fclose(binaryStream);
     return 0;
 }
 
+/**
+ * Save composite table to binary file.
+ * @param processes Structs containing all processes and file descriptors to output to binary
+ * @param numProcesses The total number of processes to output
+ * @return Returns 0 if operation was successful, nonzero otherwise
+*/
+int print_composite_binary(char* fileName, ProcessData **processes, int numProcesses) {
+    return print_columns_binary(fileName, COMPOSITE_COLUMNS, processes, numProcesses);
+}
@@ -2,8 +2,51 @@
 #define PRINT_TABLES_H
 
 #include <stdio.h>
+#include <stdbool.h>
 #include "processes.h"
 
+#define OUTPUT_BUFFER_SIZE (1 << 20)
+// "TVB2", the first 4 bytes of binary tables, which store the number of file descriptors of each type
+#define BINARY_MAGIC 0x32425654u
+// "TVB1", the first 4 bytes of binary tables written before types were counted, still readable
+#define BINARY_MAGIC_V1 0x31425654u
+
+/**
+ * Formats that tables can be printed in
+ */
+typedef enum OutputFormat
+{
+    FORMAT_TEXT,
+    FORMAT_NDJSON,
+    FORMAT_CSV,
+    OUTPUT_FORMAT_COUNT
+} OutputFormat;
+
+/**
+ * Tables that can be printed
+ */
+typedef enum TableType
+{
+    TABLE_PER_PROCESS,
+    TABLE_SYSTEM_WIDE,
+    TABLE_VNODES,
+    TABLE_COMPOSITE,
+    TABLE_TYPE_COUNT
+} TableType;
+
+/**
+ * Columns of a fixed table, and the functions printing its plain-text header and footer
+ */
+typedef struct TableDefinition
+{
+    /**
+     * Mask of the columns of the table, as defined in columns.h
+    */
+    unsigned int columns;
+    void (*print_header)(FILE *);
+    void (*print_footer)(FILE *);
+} TableDefinition;
+
 extern void print_systemWide_header(FILE *stream);
 
 extern void print_systemWide_footer(FILE *stream);
@@ -35,6 +78,24 @@ extern void print_table(void (*print_header)(FILE *),
                         size_t numProcesses,
                         FILE *stream);
 
+extern void print_table_formatted(TableType table, OutputFormat format, ProcessData **processes, size_t numProcesses, FILE *stream);
+
+extern int parse_output_format(const char *name, OutputFormat *format);
+
+extern const TableDefinition *table_definition(TableType table);
+
+extern void (*column_printer(OutputFormat format, unsigned int columns))(ProcessData *, unsigned int, FILE *);
+
+extern void print_columns_header(OutputFormat format, unsigned int columns, FILE *stream);
+
+extern void print_columns_footer(OutputFormat format, FILE *stream);
+
+extern void print_columns(OutputFormat format, unsigned int columns, ProcessData **processes, size_t numProcesses, FILE *stream);
+
+extern int parse_columns(const char *list, unsigned int *columns);
+
+extern int print_columns_binary(char *fileName, unsigned int columns, ProcessData **processes, int numProcesses);
+
 extern int print_composite_binary(char* fileName, ProcessData **processes, int numProcesses);
 
 #endif
\ No newline at end of file
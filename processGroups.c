@@ -0,0 +1,256 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "processes.h"
+#include "processGroups.h"
+
+/**
+ * Allocate empty rollups.
+ * @return The rollups, NULL if they could not be allocated
+ */
+ProcessGroups *createProcessGroups()
+{
+    ProcessGroups *groups = (ProcessGroups *)calloc(1, sizeof(ProcessGroups));
+    if (groups == NULL)
+        return NULL;
+    pthread_mutex_init(&groups->lock, NULL);
+    return groups;
+}
+
+/**
+ * Free every group of a table.
+ * @param table Table to empty
+ */
+static void freeGroupTable(GroupTable *table)
+{
+    for (int bucket = 0; bucket < GROUP_TABLE_BUCKETS; bucket++)
+    {
+        ProcessGroup *group = table->buckets[bucket];
+        while (group != NULL)
+        {
+            ProcessGroup *next = group->next;
+            free(group->key);
+            free(group->label);
+            free(group);
+            group = next;
+        }
+        table->buckets[bucket] = NULL;
+    }
+    table->size = 0;
+}
+
+/**
+ * Free rollups, and with them the cgroup labels of the processes added to them.
+ * @param groups Rollups to free, may be NULL
+ */
+void freeProcessGroups(ProcessGroups *groups)
+{
+    if (groups == NULL)
+        return;
+    freeGroupTable(&groups->cgroups);
+    freeGroupTable(&groups->netNamespaces);
+    pthread_mutex_destroy(&groups->lock);
+    free(groups);
+}
+
+/**
+ * Hash the contents of a cgroup file with FNV-1a.
+ */
+static unsigned long hashContents(const char *contents)
+{
+    unsigned long hash = 14695981039346656037UL;
+    for (; *contents != '\0'; contents++)
+    {
+        hash ^= (unsigned char)*contents;
+        hash *= 1099511628211UL;
+    }
+    return hash;
+}
+
+/**
+ * Make the label of a cgroup from the contents of /proc/<pid>/cgroup, whose lines are
+ * hierarchy-ID:controllers:path. The line of the unified hierarchy alone gives its path, other
+ * lines give controllers:path, separated by commas.
+ * @param contents Contents of the cgroup file
+ * @return Dynamically allocated label, NULL if it could not be allocated
+ */
+static char *labelCgroup(const char *contents)
+{
+    size_t firstLength = strcspn(contents, "\n");
+    if (strncmp(contents, "0::", 3) == 0 && (contents[firstLength] == '\0' || contents[firstLength + 1] == '\0'))
+        return strndup(contents + 3, firstLength - 3);
+
+    // the unified hierarchy, which has no controllers, is written as unified:path
+    char *label = (char *)malloc(strlen(contents) + strlen("unified") * 2 + 1);
+    if (label == NULL)
+        return NULL;
+    size_t length = 0;
+    for (const char *line = contents; *line != '\0';)
+    {
+        size_t lineLength = strcspn(line, "\n");
+        const char *controllers = memchr(line, ':', lineLength);
+        controllers = controllers != NULL ? controllers + 1 : line;
+        size_t kept = lineLength - (controllers - line);
+        if (kept > 0)
+        {
+            if (length > 0)
+                label[length++] = ',';
+            if (controllers[0] == ':')
+            {
+                memcpy(label + length, "unified", strlen("unified"));
+                length += strlen("unified");
+            }
+            memcpy(label + length, controllers, kept);
+            length += kept;
+        }
+        line += lineLength;
+        if (*line == '\n')
+            line++;
+    }
+    label[length] = '\0';
+    return label;
+}
+
+/**
+ * Find the group of a key in a table, adding it if it is not there yet. Must be called with the
+ * lock of the rollups held.
+ * @param table Table to search
+ * @param id Hash of the key, or inode of a namespace
+ * @param key Contents of a cgroup file, NULL for namespaces
+ * @return The group, NULL if it could not be allocated
+ */
+static ProcessGroup *findGroup(GroupTable *table, unsigned long id, const char *key)
+{
+    ProcessGroup **bucket = &table->buckets[id % GROUP_TABLE_BUCKETS];
+    for (ProcessGroup *group = *bucket; group != NULL; group = group->next)
+    {
+        if (group->id == id && (key == NULL || strcmp(group->key, key) == 0))
+            return group;
+    }
+    ProcessGroup *group = (ProcessGroup *)calloc(1, sizeof(ProcessGroup));
+    if (group == NULL)
+        return NULL;
+    group->id = id;
+    if (key != NULL)
+    {
+        group->key = strdup(key);
+        group->label = labelCgroup(key);
+        if (group->key == NULL || group->label == NULL)
+        {
+            free(group->key);
+            free(group->label);
+            free(group);
+            return NULL;
+        }
+    }
+    group->next = *bucket;
+    *bucket = group;
+    table->size++;
+    return group;
+}
+
+/**
+ * Add a scanned process and its file descriptors to the group of its cgroup and of its network
+ * namespace, and label the cgroup of the process.
+ * @param groups Rollups to add to
+ * @param process Process whose file descriptors were read, with its network namespace if known
+ * @param cgroupContents Contents of the cgroup file of the process, NULL if it could not be read
+ */
+void addToProcessGroups(ProcessGroups *groups, ProcessData *process, const char *cgroupContents)
+{
+    pthread_mutex_lock(&groups->lock);
+    if (cgroupContents == NULL || process->netNamespace == 0)
+        groups->unreadable++;
+    if (cgroupContents != NULL)
+    {
+        ProcessGroup *group = findGroup(&groups->cgroups, hashContents(cgroupContents), cgroupContents);
+        if (group != NULL)
+        {
+            group->processes++;
+            group->fileDescriptors += process->size;
+            process->cgroup = group->label;
+        }
+    }
+    if (process->netNamespace != 0)
+    {
+        ProcessGroup *group = findGroup(&groups->netNamespaces, process->netNamespace, NULL);
+        if (group != NULL)
+        {
+            group->processes++;
+            group->fileDescriptors += process->size;
+        }
+    }
+    pthread_mutex_unlock(&groups->lock);
+}
+
+/**
+ * Order groups by descending number of file descriptors
+ */
+static int compareGroups(const void *a, const void *b)
+{
+    const ProcessGroup *first = *(const ProcessGroup **)a;
+    const ProcessGroup *second = *(const ProcessGroup **)b;
+    if (first->fileDescriptors != second->fileDescriptors)
+        return first->fileDescriptors < second->fileDescriptors ? 1 : -1;
+    return first->processes < second->processes ? 1 : first->processes > second->processes ? -1 : 0;
+}
+
+/**
+ * Print the groups of a table, those with the most file descriptors first.
+ * @param table Table to print
+ * @param cgroups If true, groups are printed by their cgroup label, otherwise by their namespace inode
+ * @param stream Stream to output plain-text to
+ */
+static void printGroupTable(const GroupTable *table, int cgroups, FILE *stream)
+{
+    ProcessGroup **sorted = (ProcessGroup **)malloc(sizeof(ProcessGroup *) * (table->size + 1));
+    if (sorted == NULL)
+        return;
+    size_t count = 0;
+    for (int bucket = 0; bucket < GROUP_TABLE_BUCKETS; bucket++)
+    {
+        for (ProcessGroup *group = table->buckets[bucket]; group != NULL; group = group->next)
+            sorted[count++] = group;
+    }
+    qsort(sorted, count, sizeof(ProcessGroup *), compareGroups);
+    for (size_t i = 0; i < count; i++)
+    {
+        if (cgroups)
+            fprintf(stream, "%lu\t%lu\t%s\n", sorted[i]->processes, sorted[i]->fileDescriptors, sorted[i]->label);
+        else
+            fprintf(stream, "%lu\t%lu\t%lu\n", sorted[i]->processes, sorted[i]->fileDescriptors, sorted[i]->id);
+    }
+    free(sorted);
+}
+
+/**
+ * Print the processes and file descriptors of each cgroup
+ * @param groups Rollups of the scan
+ * @param stream Stream to output plain-text to
+ */
+void print_cgroup_table(const ProcessGroups *groups, FILE *stream)
+{
+    fprintf(stream, "processes\tFDs\tcgroup\n");
+    fprintf(stream, "===================================\n");
+    printGroupTable(&groups->cgroups, 1, stream);
+    fprintf(stream, "===================================\n");
+    if (groups->unreadable > 0)
+        fprintf(stream, "## %lu processes without a readable cgroup or network namespace\n", groups->unreadable);
+}
+
+/**
+ * Print the processes and file descriptors of each network namespace
+ * @param groups Rollups of the scan
+ * @param stream Stream to output plain-text to
+ */
+void print_netns_table(const ProcessGroups *groups, FILE *stream)
+{
+    fprintf(stream, "processes\tFDs\tnetns\n");
+    fprintf(stream, "===================================\n");
+    printGroupTable(&groups->netNamespaces, 0, stream);
+    fprintf(stream, "===================================\n");
+    if (groups->unreadable > 0)
+        fprintf(stream, "## %lu processes without a readable cgroup or network namespace\n", groups->unreadable);
+}
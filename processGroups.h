@@ -0,0 +1,68 @@
+#ifndef PROCESS_GROUPS_H
+#define PROCESS_GROUPS_H
+
+#include <stdio.h>
+#include <pthread.h>
+#include "processes.h"
+
+#define GROUP_TABLE_BUCKETS 4096
+#define CGROUP_BUFFER_SIZE 4096
+
+/**
+ * Processes sharing a cgroup or a network namespace, and their file descriptors
+ */
+typedef struct ProcessGroup
+{
+    /**
+     * Contents of /proc/<pid>/cgroup shared by the processes, NULL for namespaces
+    */
+    char *key;
+    /**
+     * Cgroup path printed for the group: the path of the unified hierarchy, or each
+     * controller:path of other hierarchies separated by commas. NULL for namespaces.
+    */
+    char *label;
+    /**
+     * Hash of the key of cgroups, inode of namespaces
+    */
+    unsigned long id;
+    unsigned long processes;
+    unsigned long fileDescriptors;
+    struct ProcessGroup *next;
+} ProcessGroup;
+
+/**
+ * Hash table of groups, chained in each bucket
+ */
+typedef struct GroupTable
+{
+    ProcessGroup *buckets[GROUP_TABLE_BUCKETS];
+    unsigned long size;
+} GroupTable;
+
+/**
+ * Rollups of the file descriptors of scanned processes by cgroup and by network namespace. Each
+ * distinct cgroup is stored once, however many processes share it. Safe to share between threads.
+ */
+typedef struct ProcessGroups
+{
+    pthread_mutex_t lock;
+    GroupTable cgroups;
+    GroupTable netNamespaces;
+    /**
+     * Processes whose cgroup or network namespace could not be read, e.g. because they exited
+    */
+    unsigned long unreadable;
+} ProcessGroups;
+
+extern ProcessGroups *createProcessGroups();
+
+extern void freeProcessGroups(ProcessGroups *groups);
+
+extern void addToProcessGroups(ProcessGroups *groups, ProcessData *process, const char *cgroupContents);
+
+extern void print_cgroup_table(const ProcessGroups *groups, FILE *stream);
+
+extern void print_netns_table(const ProcessGroups *groups, FILE *stream);
+
+#endif
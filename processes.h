@@ -4,6 +4,7 @@
 #define SYMBOLIC_LINK_BUFFER_SIZE 1024
 #define GETDENTS_BUFFER_SIZE 1024
 #define MAX_PROCESS_COUNT 2048
+#define SOCKET_PATH_BUFFER_SIZE 108
 
 #include <sys/stat.h>
 
@@ -18,6 +19,98 @@ typedef struct linux_dirent
     char d_name[];
 } linux_dirent;
 
+/**
+ * Describes a socket as reported by the kernel through NETLINK_SOCK_DIAG
+ */
+typedef struct SocketInfo
+{
+    /**
+     * Inode of the socket, as it appears in socket:[<inode>]
+    */
+    unsigned long inode;
+    /**
+     * Address family (AF_INET, AF_INET6 or AF_UNIX)
+    */
+    unsigned char family;
+    /**
+     * Protocol for inet sockets (IPPROTO_TCP, IPPROTO_UDP), or socket type for unix sockets (SOCK_STREAM, ...)
+    */
+    unsigned char protocol;
+    /**
+     * Connection state, using the TCP_* state numbering of the kernel
+    */
+    unsigned char state;
+    /**
+     * Number of bytes (or for listening sockets, connections) waiting in the receive queue
+    */
+    unsigned int receiveQueue;
+    /**
+     * Number of bytes (or for listening sockets, the backlog) of the send queue
+    */
+    unsigned int sendQueue;
+    /**
+     * Local and remote ports of inet sockets, in host byte order
+    */
+    unsigned short localPort;
+    unsigned short remotePort;
+    /**
+     * Inode of the peer of a connected unix socket, 0 if unknown
+    */
+    unsigned int peerInode;
+    /**
+     * Local and remote addresses of inet sockets, in network byte order. IPv4 addresses use the first 4 bytes.
+    */
+    unsigned char localAddress[16];
+    unsigned char remoteAddress[16];
+    /**
+     * Bound path of a unix socket, with abstract names starting with '@'. Empty if unbound.
+    */
+    char path[SOCKET_PATH_BUFFER_SIZE];
+} SocketInfo;
+
+/**
+ * Kinds of file descriptors, as determined from the target of the /proc/<pid>/fd/<fd> link. The
+ * values are stored in binary tables and shared memory, so new kinds are only ever appended.
+ */
+typedef enum FileDescriptorType
+{
+    /**
+     * Path of a file other than those below
+    */
+    FD_TYPE_FILE,
+    FD_TYPE_SOCKET,
+    FD_TYPE_PIPE,
+    /**
+     * Any other target, e.g. a namespace or an unreadable link
+    */
+    FD_TYPE_OTHER,
+    /**
+     * Path under /dev/, other than /dev/shm/
+    */
+    FD_TYPE_DEVICE,
+    /**
+     * Path of a file unlinked while open, ending with " (deleted)"
+    */
+    FD_TYPE_DELETED,
+    /**
+     * Anonymous memory file created by memfd_create
+    */
+    FD_TYPE_MEMFD,
+    /**
+     * anon_inode: file other than those below, e.g. [pidfd] or [io_uring]
+    */
+    FD_TYPE_ANON_INODE,
+    FD_TYPE_EVENTFD,
+    FD_TYPE_EVENTPOLL,
+    FD_TYPE_TIMERFD,
+    FD_TYPE_SIGNALFD,
+    FD_TYPE_INOTIFY,
+    FD_TYPE_COUNT
+} FileDescriptorType;
+
+// bit of a type in a set of types
+#define FD_TYPE_MASK(type) (1u << (type))
+
 /**
  * Describes information in a a row of the composite table
  */
@@ -31,10 +124,22 @@ typedef struct fileDescriptorEntry
      * Inode
     */
     unsigned long inode;
+    /**
+     * Device of the inode, 0 if unknown
+    */
+    unsigned long dev;
     /**
      * Filename
     */
     char* filename;
+    /**
+     * Kind of file descriptor
+    */
+    FileDescriptorType type;
+    /**
+     * Socket details if the file descriptor is a socket known to sock_diag, NULL otherwise
+    */
+    SocketInfo* socket;
 } FileDescriptorEntry;
 
 /**
@@ -58,6 +163,20 @@ typedef struct ProcessData
      * All file descriptors of the process
     */
     FileDescriptorEntry **fileDescriptors;
+    /**
+     * Expected number of file descriptors, from the size of /proc/<pid>/fd or from a count cache,
+     * 0 if unknown. Once the process is scanned, the number found before filtering.
+    */
+    unsigned long sizeHint;
+    /**
+     * Cgroup of the process as labelled by processGroups.h, owned by the ProcessGroups it was
+     * added to. NULL if it was not read.
+    */
+    const char *cgroup;
+    /**
+     * Inode of the network namespace of the process, 0 if it was not read
+    */
+    unsigned long netNamespace;
 } ProcessData;
 
 #endif
\ No newline at end of file
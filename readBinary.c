@@ -5,52 +5,167 @@
 #include <string.h>
 #include "processes.h"
 #include "printTables.h"
+#include "stringUtils.h"
+#include "readProcesses.h"
+#include "sharedSnapshot.h"
+#include "snapshotStream.h"
+#include "fleetMerge.h"
+
+#define ARG_SHARED_MEMORY "--shm"
+#define ARG_MERGE "--merge"
+#define ARG_THREADS "--threads="
+#define ARG_OUTPUT "--output="
+#define ARG_LOOKUP "--lookup"
+#define ARG_INDEX "--index="
 
 /**
- * Read composite table from a binary file "compositeTable.bin"
+ * Read composite table from a binary file "compositeTable.bin". The columns stored in the file
+ * are given by its header, columns that were not stored are left empty.
  * @param numProcessesFound A pointer to an int that will store the number of processes read from file
+ * @param byType Array of FD_TYPE_COUNT to assign the number of file descriptors of each type stored in the header to
  * @return Returns pointer to a dynamically allocated array with composite table data if successful. Returns NULL otherwise.
 */
-ProcessData** read_composite_binary(int* numProcessesFound) {
-    FILE* binaryStream = fopen("compositeTable.bin", "rb");
-    if (binaryStream == NULL) {
-        perror("Error opening to .bin output file");
+ProcessData** read_composite_binary(int* numProcessesFound, unsigned long* byType) {
+    SnapshotStream stream;
+    if (openSnapshotStream(&stream, "compositeTable.bin") != 0) {
+        fprintf(stderr, "Error: compositeTable.bin could not be opened, or is not a table written by this version of tableViewer.\n");
         return NULL;
     }
-    FileDescriptorEntry* point;
-    size_t filenameLen;
-    unsigned long pid = 0l;
-    *numProcessesFound = 0;
-    
-    ProcessData** processes = (ProcessData**)malloc(sizeof(ProcessData*) * MAX_PROCESS_COUNT);
-
-    while (fread(&pid, sizeof(unsigned long), 1, binaryStream) > 0)
-    {
-        ProcessData* process = (ProcessData*)malloc(sizeof(ProcessData));
-        process->pid = pid;
-        fread(&(process->inode), sizeof(unsigned long), 1, binaryStream); // process inode
-        fread(&(process->size), sizeof(unsigned long), 1, binaryStream); // number of fds
-        process->fileDescriptors = (FileDescriptorEntry**)malloc(sizeof(FileDescriptorEntry*) * process->size);
-        for (size_t j = 0; j < process->size; j++)
-        {
-            process->fileDescriptors[j] = (FileDescriptorEntry*)malloc(sizeof(FileDescriptorEntry));
-            point = process->fileDescriptors[j];
-            fread(&(point->fd), sizeof(unsigned long), 1, binaryStream);
-            fread(&(point->inode), sizeof(unsigned long), 1, binaryStream);
-            fread(&filenameLen, sizeof(size_t), 1, binaryStream); // length of string
-            point->filename = (char*)malloc(sizeof(char) * filenameLen);
-            fread(point->filename, sizeof(char), filenameLen, binaryStream);
-            point->filename[filenameLen] = '\0';
-        }
-        processes[(*numProcessesFound)++] = process;
+    memcpy(byType, stream.byType, sizeof(stream.byType));
+    ProcessData** processes = readSnapshotProcesses(&stream, numProcessesFound);
+    if (processes == NULL)
+        fprintf(stderr, "Error: compositeTable.bin is truncated, or could not be read into memory.\n");
+    closeSnapshotStream(&stream);
+    return processes;
+}
+
+/**
+ * Read composite table from the snapshot published to shared memory by "tableViewer --publish"
+ * @param numProcessesFound A pointer to an int that will store the number of processes read
+ * @return Returns pointer to a dynamically allocated array with composite table data if successful. Returns NULL otherwise.
+*/
+ProcessData** read_composite_shared(int* numProcessesFound) {
+    SharedSnapshotReader* reader = openSharedSnapshot(SHARED_SNAPSHOT_NAME);
+    if (reader == NULL) {
+        fprintf(stderr, "Error: No snapshot published in shared memory.\n");
+        return NULL;
+    }
+    SharedSnapshot snapshot;
+    memset(&snapshot, 0, sizeof(snapshot));
+    ProcessData** processes = NULL;
+    if (readSharedSnapshot(reader, &snapshot) == 0) {
+        processes = sharedSnapshotToProcesses(&snapshot, numProcessesFound);
     }
-    fclose(binaryStream);
+    freeSharedSnapshot(&snapshot);
+    closeSharedSnapshot(reader);
     return processes;
 }
 
-int main() {
+/**
+ * Merge the binary tables given as <node>:<path> arguments into a fleet index.
+ * @param argc Number of arguments after --merge
+ * @param argv Arguments after --merge: [--threads=N] [--output=FILE] <node>:<path>...
+ * @return 0 if operation was successful, 1 otherwise
+*/
+int merge_fleet(int argc, char** argv) {
+    int numThreads = 1;
+    const char* outputName = FLEET_INDEX_NAME;
+    MergeInput* inputs = (MergeInput*)malloc(sizeof(MergeInput) * (argc > 0 ? argc : 1));
+    int numInputs = 0;
+    if (inputs == NULL)
+        return 1;
+    for (int i = 0; i < argc; i++) {
+        if (strncmp(argv[i], ARG_THREADS, strlen(ARG_THREADS)) == 0) {
+            numThreads = atoi(argv[i] + strlen(ARG_THREADS));
+            if (numThreads < 1 || numThreads > MAX_MERGE_THREADS) {
+                fprintf(stderr, "Error: --threads= must be between 1 and %d.\n", MAX_MERGE_THREADS);
+                free(inputs);
+                return 1;
+            }
+        }
+        else if (strncmp(argv[i], ARG_OUTPUT, strlen(ARG_OUTPUT)) == 0)
+            outputName = argv[i] + strlen(ARG_OUTPUT);
+        else if (parseMergeInput(argv[i], i, &inputs[numInputs]) == 0)
+            numInputs++;
+        else {
+            free(inputs);
+            return 1;
+        }
+    }
+    if (numInputs == 0) {
+        fprintf(stderr, "Usage: binRead --merge [--threads=N] [--output=FILE] <node>:<path>...\n");
+        free(inputs);
+        return 1;
+    }
+    int result = mergeSnapshots(inputs, numInputs, outputName, numThreads, stdout);
+    free(inputs);
+    return result == 0 ? 0 : 1;
+}
+
+/**
+ * Look up the rows of a process, or of one of its file descriptors, in a fleet index.
+ * @param argc Number of arguments after --lookup
+ * @param argv Arguments after --lookup: [--index=FILE] <node> <pid> [fd]
+ * @return 0 if rows were found, 1 otherwise
+*/
+int lookup_fleet(int argc, char** argv) {
+    const char* indexName = FLEET_INDEX_NAME;
+    if (argc > 0 && strncmp(argv[0], ARG_INDEX, strlen(ARG_INDEX)) == 0) {
+        indexName = argv[0] + strlen(ARG_INDEX);
+        argc--;
+        argv++;
+    }
+    long pid = argc >= 2 && isNumber(argv[1]) ? atol(argv[1]) : 0;
+    long fd = argc == 3 && isNumber(argv[2]) ? atol(argv[2]) : -1;
+    if (argc < 2 || argc > 3 || pid <= 0 || (argc == 3 && fd < 0)) {
+        fprintf(stderr, "Usage: binRead --lookup [--index=FILE] <node> <pid> [fd]\n");
+        return 1;
+    }
+    FleetIndex index;
+    if (openFleetIndex(&index, indexName) != 0) {
+        fprintf(stderr, "Error: %s could not be opened, or is not a fleet index written by this version of binRead.\n", indexName);
+        return 1;
+    }
+    long found = lookupFleetRows(&index, argv[0], pid, fd, stdout);
+    closeFleetIndex(&index);
+    if (found < 0)
+        fprintf(stderr, "Error: %s is truncated.\n", indexName);
+    else if (found == 0)
+        fprintf(stderr, "No rows for %s:%ld%s%s in %s.\n", argv[0], pid, fd >= 0 ? " fd " : "", fd >= 0 ? argv[2] : "", indexName);
+    return found > 0 ? 0 : 1;
+}
+
+/**
+ * Print the number of file descriptors of each type stored in a binary table, if any.
+ * @param byType Number of file descriptors of each FileDescriptorType
+*/
+void print_type_counts(const unsigned long* byType) {
+    int printed = 0;
+    for (int type = 0; type < FD_TYPE_COUNT; type++) {
+        if (byType[type] == 0)
+            continue;
+        printf("%s %s %lu", printed ? "," : "## File descriptors by type:", fileDescriptorTypeName((FileDescriptorType)type), byType[type]);
+        printed = 1;
+    }
+    if (printed)
+        printf("\n");
+}
+
+int main(int argc, char** argv) {
     int num = 0;
-    ProcessData** procs = read_composite_binary(&num);
-    if (procs != NULL)
+    ProcessData** procs;
+    unsigned long byType[FD_TYPE_COUNT] = {0};
+    if (argc > 1 && strcmp(argv[1], ARG_MERGE) == 0)
+        return merge_fleet(argc - 2, argv + 2);
+    if (argc > 1 && strcmp(argv[1], ARG_LOOKUP) == 0)
+        return lookup_fleet(argc - 2, argv + 2);
+    if (argc > 1 && strcmp(argv[1], ARG_SHARED_MEMORY) == 0)
+        procs = read_composite_shared(&num);
+    else
+        procs = read_composite_binary(&num, byType);
+    if (procs != NULL) {
         print_table(print_composite_header, print_composite_content, print_composite_footer, procs, num, stdout);
+        print_type_counts(byType);
+    }
+    return procs != NULL ? 0 : 1;
 }
\ No newline at end of file
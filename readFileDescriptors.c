@@ -8,116 +8,311 @@
 #include <sys/stat.h>
 
 #include "processes.h"
+#include "columns.h"
 #include "stringUtils.h"
+#include "rowFilter.h"
+#include "readFileDescriptors.h"
+
+// types whose link names a file of anon_inodefs, where every file descriptor shares one inode
+#define ANON_INODE_TYPES (FD_TYPE_MASK(FD_TYPE_ANON_INODE) | FD_TYPE_MASK(FD_TYPE_EVENTFD) | FD_TYPE_MASK(FD_TYPE_EVENTPOLL) | \
+                          FD_TYPE_MASK(FD_TYPE_TIMERFD) | FD_TYPE_MASK(FD_TYPE_SIGNALFD) | FD_TYPE_MASK(FD_TYPE_INOTIFY))
+
+// add one to a counter of the scan, if the scan is counted
+#define COUNT_SCAN(options, counter)                     \
+    if ((options) != NULL && (options)->stats != NULL)  \
+        (options)->stats->counter++;
 
 /**
- * Extract file descriptor information
- * @param process Data of process to which this file descriptor belongs
- * @param fileEntry File information of the file descriptor file to be read, as retrieved by getdents
- * @param folderPath Absolute path of parent folder containing the file descriptor
- * @return Data about the file descriptor.
+ * Evaluate the filter of a scan once a stage is reached, unless the row is already decided or no
+ * field of this stage is used by the filter.
+ * @param options Options of the scan
+ * @param stage Stage reached
+ * @param row Fields of the row resolved so far
+ * @param decision Result of the filter at the previous stage, updated with the result at this stage
+ * @return 1 if the row must be skipped, 0 otherwise
+ */
+static int rejectAtStage(const ScanOptions *options, FilterStage stage, const FilterRow *row, FilterResult *decision)
+{
+    if (*decision != FILTER_UNKNOWN || !options->filter->usesStage[stage])
+        return 0;
+    *decision = evaluateRowFilter(options->filter, stage, row);
+    if (*decision != FILTER_FALSE)
+        return 0;
+    COUNT_SCAN(options, rejected[stage]);
+    return 1;
+}
+
+/**
+ * Parse the inode of a socket or pipe from the target of its link, of the form type:[inode].
+ * @param filename Target of the link
+ * @param startIndex Index of the first digit of the inode
+ * @return The inode
  */
-FileDescriptorEntry *readFileDescriptor(ProcessData *process, linux_dirent *fileEntry, char *folderPath)
+static unsigned long parseLinkInode(const char *filename, int startIndex)
 {
-    // temp variable to read file descriptor file name
-    char fullFdPath[GETDENTS_BUFFER_SIZE * 2];
     // temp variable to store inode string
     char inodeString[SYMBOLIC_LINK_BUFFER_SIZE];
+    int len = strnlen(filename, SYMBOLIC_LINK_BUFFER_SIZE);
+    int i = startIndex;
+    // gather digits into a string
+    for (; i < len && filename[i] != ']'; i++)
+    {
+        inodeString[i - startIndex] = filename[i];
+    }
+    inodeString[i > startIndex ? i - startIndex : 0] = '\0';
+    return strtoul(inodeString, NULL, 10);
+}
+
+/**
+ * Extract file descriptor information. Fields are resolved one stage at a time, and the filter
+ * of the scan is checked after each stage, so that rows it rejects skip the remaining syscalls.
+ * Only the fields of the columns of the scan are resolved: the link is read for the filename,
+ * type and socket columns, and the file descriptor is stat'ed for the inode and dev columns,
+ * unless the link already gave the inode of a socket or pipe, which the socket column needs, or
+ * names an anon_inode file, which has no inode of its own. The set of types of the scan is
+ * checked as soon as the link is read.
+ * @param process Data of process to which this file descriptor belongs
+ * @param fileEntry File information of the file descriptor file to be read, as retrieved by getdents
+ * @param directoryFd Open /proc/<pid>/fd directory containing the file descriptor
+ * @param options Columns, filter and counters of the scan, may be NULL to resolve every column
+ * @param entry Pointer to store the dynamically-allocated data about the file descriptor in, if it is kept
+ * @return 0 if the file descriptor is kept, 1 if it is rejected by the filter or the set of types,
+ * -1 if memory could not be allocated
+ */
+int readFileDescriptor(ProcessData *process, linux_dirent *fileEntry, int directoryFd, const ScanOptions *options, FileDescriptorEntry **entry)
+{
+    *entry = NULL;
     // temp variable to store buffer
     char buffer[SYMBOLIC_LINK_BUFFER_SIZE] = "";
+
+    FilterRow row;
+    memset(&row, 0, sizeof(row));
+    row.pid = process->pid;
+    row.fd = strtol(fileEntry->d_name, NULL, 10);
+    FilterResult decision = options != NULL && options->filter != NULL ? FILTER_UNKNOWN : FILTER_TRUE;
+    COUNT_SCAN(options, rowsSeen);
+    if (rejectAtStage(options, FILTER_STAGE_FD, &row, &decision))
+        return 1;
+
+    // work out which syscalls the columns and the undecided filter still need
+    unsigned int columns = options != NULL ? options->columns : ALL_COLUMNS;
+    int needsLink = (columns & (COLUMN_MASK(filename) | COLUMN_MASK(type) | COLUMN_MASK(socket))) ||
+                    (options != NULL && options->types != 0) ||
+                    (decision == FILTER_UNKNOWN && options->filter->usesStage[FILTER_STAGE_PATH]);
+    int needsStat = (columns & (COLUMN_MASK(inode) | COLUMN_MASK(dev))) ||
+                     (decision == FILTER_UNKNOWN && options->filter->usesStage[FILTER_STAGE_INODE]);
+
+    row.type = FD_TYPE_OTHER;
+    if (needsLink)
+    {
+        ssize_t linkLength = readlinkat(directoryFd, fileEntry->d_name, buffer, SYMBOLIC_LINK_BUFFER_SIZE - 1);
+        COUNT_SCAN(options, readlinkCalls);
+        buffer[linkLength > 0 ? linkLength : 0] = '\0';
+        row.path = buffer;
+        row.type = classifyLink(buffer, linkLength > 0 ? linkLength : 0);
+        // the set of types is a single test, decided before the filter and any allocation
+        if (options != NULL && options->types != 0 && !(options->types & FD_TYPE_MASK(row.type)))
+        {
+            COUNT_SCAN(options, rejected[FILTER_STAGE_PATH]);
+            return 1;
+        }
+        if (rejectAtStage(options, FILTER_STAGE_PATH, &row, &decision))
+            return 1;
+    }
+
     FileDescriptorEntry *newRow = (FileDescriptorEntry *)malloc(sizeof(FileDescriptorEntry));
-    snprintf(fullFdPath, GETDENTS_BUFFER_SIZE * 2, "%s/%s", folderPath, fileEntry->d_name);
-    readlink(fullFdPath, buffer, SYMBOLIC_LINK_BUFFER_SIZE);
-    newRow->filename = strndup(buffer, SYMBOLIC_LINK_BUFFER_SIZE);
-    
-    // newRow->filename = (char *)malloc(sizeof(char) * len);
-    if (newRow->filename == NULL) {
-        fprintf(stderr, "Error: could not allocate enough memory for filenames.");
-        return NULL;
+    if (newRow == NULL) {
+        fprintf(stderr, "Error: could not allocate enough memory for file descriptors.");
+        return -1;
+    }
+    newRow->filename = NULL;
+    if (needsLink)
+    {
+        newRow->filename = strndup(buffer, SYMBOLIC_LINK_BUFFER_SIZE);
+        if (newRow->filename == NULL) {
+            fprintf(stderr, "Error: could not allocate enough memory for filenames.");
+            free(newRow);
+            return -1;
+        }
     }
-    // strncpy(newRow->filename, buffer, GETDENTS_BUFFER_SIZE);
 
-    newRow->fd = strtol(fileEntry->d_name, NULL, 10);
+    newRow->fd = row.fd;
+    newRow->socket = NULL;
+    newRow->type = row.type;
 
     // default inode value
     newRow->inode = process->inode;
+    newRow->dev = 0;
 
     // For sockets and pipes, parse the inode from the string type:[inode]
-    int startIndex = -1;
-
-    // sockets
-    if (strncmp(newRow->filename, SOCKET_TOKEN, strlen(SOCKET_TOKEN)) == 0)
-        startIndex = strlen(SOCKET_TOKEN);
-    // FIFO/pipes
-    else if (strncmp(newRow->filename, PIPE_TOKEN, strlen(PIPE_TOKEN)) == 0)
-        startIndex = strlen(PIPE_TOKEN);
-    else
+    if (needsLink && newRow->type == FD_TYPE_SOCKET)
+        newRow->inode = parseLinkInode(newRow->filename, strlen(SOCKET_TOKEN));
+    else if (needsLink && newRow->type == FD_TYPE_PIPE)
+        newRow->inode = parseLinkInode(newRow->filename, strlen(PIPE_TOKEN));
+    else if (needsStat && !(needsLink && (ANON_INODE_TYPES & FD_TYPE_MASK(newRow->type))))
     {
-        // get stats of the file descriptor file
+        // stat the open file through its link, which follows it without opening it again
         struct stat stats;
-        int fd = open(fullFdPath, O_RDWR);
-        if (fstat(fd, &stats) != -1)
+        COUNT_SCAN(options, statCalls);
+        if (fstatat(directoryFd, fileEntry->d_name, &stats, 0) != -1)
         {
-            struct stat inodestats;
             switch (stats.st_mode & S_IFMT)
             {
+            case S_IFSOCK:
+            case S_IFIFO:
+                // the same inode as in the link, and no device, as when it is parsed
+                newRow->inode = stats.st_ino;
+                break;
             case S_IFDIR:
             case S_IFREG:
             case S_IFCHR:
             case S_IFBLK:
             case S_IFLNK:
-                if (lstat(newRow->filename, &inodestats) != -1)
-                    newRow->inode = inodestats.st_ino; // inode of file
+                newRow->inode = stats.st_ino; // inode of file
+                newRow->dev = stats.st_dev;
+                break;
             default:
+                newRow->dev = stats.st_dev;
                 break;
             }
         }
-        close(fd);
     }
 
-    // for pipes and sockets, parse the inode from the string
-    if (startIndex > -1)
+    row.inode = newRow->inode;
+    if (rejectAtStage(options, FILTER_STAGE_INODE, &row, &decision))
     {
-        int len = strnlen(newRow->filename, SYMBOLIC_LINK_BUFFER_SIZE);
-        int i = startIndex;
-        // gather digits into a string
-        for (; i < len && newRow->filename[i] != ']'; i++)
-        {
-            inodeString[i - startIndex] = newRow->filename[i];
-        }
-        if (i < SYMBOLIC_LINK_BUFFER_SIZE)
+        free(newRow->filename);
+        free(newRow);
+        return 1;
+    }
+    *entry = newRow;
+    return 0;
+}
+
+/**
+ * Read the cgroup and network namespace of a process, and add it to the rollups of the scan.
+ * @param process Process whose file descriptors were read
+ * @param options Options of the scan, with the rollups to add to
+ */
+static void readProcessGroups(ProcessData *process, const ScanOptions *options)
+{
+    char path[GETDENTS_BUFFER_SIZE];
+    char contents[CGROUP_BUFFER_SIZE];
+    char link[SYMBOLIC_LINK_BUFFER_SIZE];
+
+    snprintf(path, GETDENTS_BUFFER_SIZE, "/proc/%lu/cgroup", process->pid);
+    int cgroupFd = open(path, O_RDONLY);
+    COUNT_SCAN(options, openCalls);
+    ssize_t length = -1;
+    if (cgroupFd != -1)
+    {
+        length = read(cgroupFd, contents, CGROUP_BUFFER_SIZE - 1);
+        COUNT_SCAN(options, readCalls);
+        close(cgroupFd);
+        COUNT_SCAN(options, closeCalls);
+    }
+    contents[length > 0 ? length : 0] = '\0';
+
+    // the link reads net:[<inode>]
+    snprintf(path, GETDENTS_BUFFER_SIZE, "/proc/%lu/ns/net", process->pid);
+    ssize_t linkLength = readlink(path, link, SYMBOLIC_LINK_BUFFER_SIZE - 1);
+    COUNT_SCAN(options, readlinkCalls);
+    link[linkLength > 0 ? linkLength : 0] = '\0';
+    process->netNamespace = strncmp(link, "net:[", 5) == 0 ? parseLinkInode(link, 5) : 0;
+
+    addToProcessGroups(options->groups, process, length > 0 ? contents : NULL);
+}
+
+/**
+ * Append a file descriptor to the array of a process, doubling the array if it is full.
+ * @param process Process to append to
+ * @param entry File descriptor to append, freed if the array could not grow
+ * @param capacity Capacity of the array of the process, updated if it grows
+ * @param options Options of the scan, counting reallocations
+ * @return 0 if the file descriptor was appended, nonzero otherwise
+ */
+static int appendFileDescriptor(ProcessData *process, FileDescriptorEntry *entry, unsigned long *capacity, const ScanOptions *options)
+{
+    if (process->size == *capacity)
+    {
+        FileDescriptorEntry **grown = (FileDescriptorEntry **)realloc(process->fileDescriptors, sizeof(FileDescriptorEntry *) * *capacity * 2);
+        COUNT_SCAN(options, reallocations);
+        if (grown == NULL)
         {
-            inodeString[i - startIndex] = '\0';
+            fprintf(stderr, "Error: could not allocate enough memory for file descriptors.");
+            free(entry->filename);
+            free(entry);
+            return 1;
         }
-        newRow->inode = strtoul(inodeString, NULL, 10);
+        process->fileDescriptors = grown;
+        *capacity *= 2;
     }
-
-    return newRow;
+    process->fileDescriptors[process->size++] = entry;
+    return 0;
 }
 
 /**
  * Given a process of id ID, populate its array of file descriptors with data found
- * in /proc/{ID}/fd.
+ * in /proc/{ID}/fd. The array is sized from the expected number of file descriptors of the
+ * process, or else from the size of /proc/{ID}/fd, which is the number of open file descriptors
+ * on Linux 6.2 and later, and grows if more are found.
  * @param process Contains a process identified by PID
- * @returns 0 if operation was successful, nonzero otherwise
+ * @param options Columns, filter, counters, budget and rollups of the scan, may be NULL to resolve every column
+ * @returns 0 if operation was successful, nonzero if memory for a file descriptor could not be
+ * allocated, in which case the process holds the file descriptors read before and after it
  */
-int readFileDescriptors(ProcessData *process)
+int readFileDescriptors(ProcessData *process, const ScanOptions *options)
 {
+    // reset number of file descs added to zero
+    process->size = 0;
+    process->fileDescriptors = NULL;
+
+    // skip the whole process if the filter rejects its PID
+    FilterRow row;
+    memset(&row, 0, sizeof(row));
+    row.pid = process->pid;
+    FilterResult decision = options != NULL && options->filter != NULL ? FILTER_UNKNOWN : FILTER_TRUE;
+    if (rejectAtStage(options, FILTER_STAGE_PID, &row, &decision))
+        return 0;
+
     // generate the path and open the folder to search in
     char folderPath[GETDENTS_BUFFER_SIZE];
     snprintf(folderPath, GETDENTS_BUFFER_SIZE, "/proc/%ld/fd/", process->pid);
     int procDirFd = open(folderPath, O_RDONLY | O_DIRECTORY);
+    COUNT_SCAN(options, openCalls);
+    // the process exited since it was listed
+    if (procDirFd == -1)
+        return 0;
+    COUNT_SCAN(options, processesScanned);
+
+    unsigned long capacity = process->sizeHint;
+    if (capacity == 0)
+    {
+        struct stat directoryStats;
+        COUNT_SCAN(options, statCalls);
+        if (fstat(procDirFd, &directoryStats) != -1)
+            capacity = directoryStats.st_size;
+    }
+    if (capacity == 0)
+        capacity = FD_ARRAY_INITIAL_CAPACITY;
+    process->fileDescriptors = (FileDescriptorEntry **)malloc(sizeof(FileDescriptorEntry *) * capacity);
+    if (process->fileDescriptors == NULL)
+    {
+        fprintf(stderr, "Error: could not allocate enough memory for file descriptors.");
+        close(procDirFd);
+        COUNT_SCAN(options, closeCalls);
+        return 1;
+    }
 
     // buffer for getdents
     char entBuffer[GETDENTS_BUFFER_SIZE];
 
     // number of entries found in the folder
     long numEntries = syscall(SYS_getdents, procDirFd, entBuffer, GETDENTS_BUFFER_SIZE);
+    COUNT_SCAN(options, getdentsCalls);
 
-    process->fileDescriptors = (FileDescriptorEntry **)malloc(sizeof(FileDescriptorEntry *) * numEntries);
-    // reset number of file descs added to zero
-    process->size = 0;
-
+    int result = 0;
+    unsigned long found = 0;
     linux_dirent *fileEntry;
     while (numEntries > 0)
     {
@@ -127,14 +322,61 @@ int readFileDescriptors(ProcessData *process)
 
             if (isNumber(fileEntry->d_name))
             {
-                // add file descriptor information to process table
-                process->fileDescriptors[process->size] = readFileDescriptor(process, fileEntry, folderPath);
-                process->size++;
+                // add file descriptor information to process table, unless it was filtered out
+                FileDescriptorEntry *entry;
+                int status = readFileDescriptor(process, fileEntry, procDirFd, options, &entry);
+                if (status < 0 || (status == 0 && appendFileDescriptor(process, entry, &capacity, options) != 0))
+                    result = 1;
+                found++;
             }
             i += fileEntry->d_reclen;
         }
+        // spread the scan over time, giving the CPU and kernel locks to others between batches
+        if (options != NULL)
+            chargeScanBudget(options->budget);
         numEntries = syscall(SYS_getdents, procDirFd, entBuffer, GETDENTS_BUFFER_SIZE);
+        COUNT_SCAN(options, getdentsCalls);
     }
     close(procDirFd);
-    return 0;
+    COUNT_SCAN(options, closeCalls);
+    process->sizeHint = found;
+    if (options != NULL && options->groups != NULL)
+        readProcessGroups(process, options);
+    return result;
+}
+
+/**
+ * Add the counters of one scan to another, e.g. to sum the scans of several threads.
+ * @param total Counters to add to
+ * @param part Counters to add
+ */
+void addScanStats(ScanStats *total, const ScanStats *part)
+{
+    total->getdentsCalls += part->getdentsCalls;
+    total->openCalls += part->openCalls;
+    total->readCalls += part->readCalls;
+    total->readlinkCalls += part->readlinkCalls;
+    total->statCalls += part->statCalls;
+    total->closeCalls += part->closeCalls;
+    total->processesScanned += part->processesScanned;
+    total->rowsSeen += part->rowsSeen;
+    total->reallocations += part->reallocations;
+    for (int stage = 0; stage < FILTER_STAGE_COUNT; stage++)
+        total->rejected[stage] += part->rejected[stage];
+}
+
+/**
+ * Print the counters of a scan.
+ * @param stats Counters to print
+ * @param stream Stream to output plain-text to
+ */
+void printScanStats(const ScanStats *stats, FILE *stream)
+{
+    unsigned long kept = stats->rowsSeen - stats->rejected[FILTER_STAGE_FD] - stats->rejected[FILTER_STAGE_PATH] - stats->rejected[FILTER_STAGE_INODE];
+    fprintf(stream, "## Scanned %lu processes, %lu file descriptors, %lu kept, %lu reallocations\n", stats->processesScanned, stats->rowsSeen, kept, stats->reallocations);
+    fprintf(stream, "## Syscalls: %lu (getdents %lu, open %lu, read %lu, readlink %lu, stat %lu, close %lu)\n",
+            stats->getdentsCalls + stats->openCalls + stats->readCalls + stats->readlinkCalls + stats->statCalls + stats->closeCalls,
+            stats->getdentsCalls, stats->openCalls, stats->readCalls, stats->readlinkCalls, stats->statCalls, stats->closeCalls);
+    fprintf(stream, "## Skipped by filter: %lu processes by pid, %lu rows by fd, %lu by path, %lu by inode\n",
+            stats->rejected[FILTER_STAGE_PID], stats->rejected[FILTER_STAGE_FD], stats->rejected[FILTER_STAGE_PATH], stats->rejected[FILTER_STAGE_INODE]);
 }
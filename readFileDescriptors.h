@@ -1,15 +1,90 @@
 #ifndef READ_FILE_DESCRIPTORS_H
 #define READ_FILE_DESCRIPTORS_H
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <sys/syscall.h>
 #include <fcntl.h>
 #include <dirent.h>
 
 #include "processes.h"
+#include "rowFilter.h"
+#include "scanBudget.h"
+#include "processGroups.h"
 
-extern FileDescriptorEntry *readFileDescriptor(ProcessData *process, linux_dirent *fileEntry, char *folderPath);
+// capacity of the array of file descriptors of a process whose number of file descriptors is unknown
+#define FD_ARRAY_INITIAL_CAPACITY 64
 
-extern int readFileDescriptors(ProcessData *process);
+/**
+ * Counts of the work done while scanning file descriptors
+ */
+typedef struct ScanStats
+{
+    unsigned long getdentsCalls;
+    unsigned long openCalls;
+    unsigned long readCalls;
+    unsigned long readlinkCalls;
+    /**
+     * Calls to fstat and lstat
+    */
+    unsigned long statCalls;
+    unsigned long closeCalls;
+    /**
+     * Processes whose /proc/<pid>/fd was read, and file descriptors found in them
+    */
+    unsigned long processesScanned;
+    unsigned long rowsSeen;
+    /**
+     * Times the array of file descriptors of a process was found too small and had to grow
+    */
+    unsigned long reallocations;
+    /**
+     * Processes (at FILTER_STAGE_PID) or rows (at later stages) skipped by the filter at each stage
+    */
+    unsigned long rejected[FILTER_STAGE_COUNT];
+} ScanStats;
 
-#endif
\ No newline at end of file
+/**
+ * Options of a scan of file descriptors
+ */
+typedef struct ScanOptions
+{
+    /**
+     * Mask of the columns to resolve, as defined in columns.h. Fields of other columns may be left
+     * empty: NULL filename, FD_TYPE_OTHER type, and the inode of the process with no device.
+    */
+    unsigned int columns;
+    /**
+     * Rows to keep, NULL to keep every row
+    */
+    const RowFilter *filter;
+    /**
+     * Counters to add to, NULL to not count. Must not be shared between threads.
+    */
+    ScanStats *stats;
+    /**
+     * CPU budget of the scanning thread, charged between getdents batches, NULL to scan at full
+     * speed. Must not be shared between threads.
+    */
+    ScanBudget *budget;
+    /**
+     * Rollups to add each scanned process to, by cgroup and network namespace, NULL to not read
+     * them. May be shared between threads.
+    */
+    ProcessGroups *groups;
+    /**
+     * Set of the types of file descriptors to keep, see FD_TYPE_MASK, 0 to keep every type. Checked
+     * as soon as the link is read, before the filter.
+    */
+    unsigned int types;
+} ScanOptions;
+
+extern int readFileDescriptor(ProcessData *process, linux_dirent *fileEntry, int directoryFd, const ScanOptions *options, FileDescriptorEntry **entry);
+
+extern int readFileDescriptors(ProcessData *process, const ScanOptions *options);
+
+extern void addScanStats(ScanStats *total, const ScanStats *part);
+
+extern void printScanStats(const ScanStats *stats, FILE *stream);
+
+#endif
@@ -4,10 +4,32 @@
 #include <fcntl.h>
 #include <dirent.h>
 #include <stdio.h>
+#include <errno.h>
+#include <string.h>
 #include <sys/stat.h>
 
 #include "processes.h"
 #include "stringUtils.h"
+#include "scanBudget.h"
+
+/**
+ * Free memory used to store a process and its file descriptors
+ * @param process Process to free, may be NULL
+ */
+void freeProcess(ProcessData* process) {
+    if (process == NULL) return;
+    if (process->fileDescriptors != NULL)
+    for (int fd = 0; fd < process->size; fd++)
+    {
+        if (process->fileDescriptors[fd] == NULL) continue;
+        if (process->fileDescriptors[fd]->filename != NULL) {
+            free(process->fileDescriptors[fd]->filename);
+        }
+        free(process->fileDescriptors[fd]);
+    }
+    free(process->fileDescriptors);
+    free(process);
+}
 
 /**
  * Free memory used to store process and FD data
@@ -19,18 +41,9 @@ void freeProcesses(ProcessData** processes, int size) {
     if (processes == NULL) return;
     for (int i = 0; i < size; i++)
     {
-        if (processes[i] == NULL) continue;
-        if (processes[i]->fileDescriptors != NULL)
-        for (int fd = 0; fd < processes[i]->size; fd++)
-        {
-            if (processes[i]->fileDescriptors[fd] == NULL) continue;
-            if (processes[i]->fileDescriptors[fd]->filename != NULL) {
-                free(processes[i]->fileDescriptors[fd]->filename);
-            }
-            free(processes[i]->fileDescriptors[fd]);
-        }
-        free(processes[i]);
+        freeProcess(processes[i]);
     }
+    free(processes);
 }
 
 /**
@@ -46,16 +59,49 @@ ProcessData *readProcess(linux_dirent *source)
     }
     result->inode = source->d_ino;
     result->pid = strtoul(source->d_name, NULL, 10);
+    result->size = 0;
+    result->fileDescriptors = NULL;
+    result->cgroup = NULL;
+    result->netNamespace = 0;
+    result->sizeHint = 0;
     return result;
 };
 
+/**
+ * Read the start time of a process, field 22 of /proc/<pid>/stat. Unlike the inode of /proc/<pid>,
+ * which the kernel reassigns when the directory entry is evicted from its cache, the start time
+ * stays the same for the whole life of a process, so it tells apart processes reusing a PID.
+ * @param pid Process identifier
+ * @return Clock ticks between boot and the start of the process, 0 if it could not be read
+ */
+unsigned long readProcessStartTime(unsigned long pid)
+{
+    char path[64];
+    char stat[1024];
+    snprintf(path, sizeof(path), "/proc/%lu/stat", pid);
+    int statFd = open(path, O_RDONLY);
+    if (statFd == -1)
+        return 0;
+    ssize_t length = read(statFd, stat, sizeof(stat) - 1);
+    close(statFd);
+    if (length <= 0)
+        return 0;
+    stat[length] = '\0';
+    // the command name (field 2) may contain spaces and parentheses, fields are counted after its last ')'
+    char *field = strrchr(stat, ')');
+    for (int number = 2; field != NULL && number < 22; number++)
+        field = strchr(field + 1, ' ');
+    return field != NULL ? strtoul(field + 1, NULL, 10) : 0;
+}
+
 /**
  * Gather data on processes in an array, except for file descriptor data
  * @param size Pointer to int which will store to the number of processes found and put in the return array.
  * @param processIdSelected If set to a non-negative number, then only read process if the PID matches processIdSelected.
+ * @param budget If not NULL, CPU budget of the scan, charged after each batch of directory entries
  * @return If successful, returns an array of pointers each pointing to data of one process. NULL otherwise.
  */
-ProcessData **fetchProcesses(int *size, long processIdSelected)
+ProcessData **fetchProcesses(int *size, long processIdSelected, ScanBudget *budget)
 {
     char getdentsBuffer[GETDENTS_BUFFER_SIZE];
     long numEntries = 0;
@@ -83,6 +129,8 @@ ProcessData **fetchProcesses(int *size, long processIdSelected)
         if (numEntries < 0)
         {
             perror("Error calling getdents");
+            freeProcesses(processes, *size);
+            close(procDirFd);
             return NULL;
         }
         else
@@ -94,7 +142,13 @@ ProcessData **fetchProcesses(int *size, long processIdSelected)
                 // make path to file, and get stats
                 snprintf(processFilename, GETDENTS_BUFFER_SIZE, "/proc/%s", dirEntry->d_name);
                 if (lstat(processFilename, &stats) == -1) {
-                    freeProcesses(processes, arraySize);
+                    // the process may have exited since the directory was listed
+                    if (errno == ENOENT) {
+                        i += dirEntry->d_reclen;
+                        continue;
+                    }
+                    freeProcesses(processes, *size);
+                    close(procDirFd);
                     fprintf(stderr, "Failed to read stats of file %s", processFilename);
                     return NULL;
                 } 
@@ -113,17 +167,34 @@ ProcessData **fetchProcesses(int *size, long processIdSelected)
                     {
                         ProcessData* process = readProcess(dirEntry);
                         if (process == NULL) {
-                            freeProcesses(processes, arraySize);
+                            freeProcesses(processes, *size);
+                            close(procDirFd);
                             fprintf(stderr, "Failed to read data for process %s", dirEntry->d_name);
                             return NULL;
                         }
+                        // grow the array when there are more processes than MAX_PROCESS_COUNT
+                        if (*size == arraySize) {
+                            arraySize *= 2;
+                            ProcessData **grown = (ProcessData **)realloc(processes, sizeof(ProcessData *) * arraySize);
+                            if (grown == NULL) {
+                                free(process);
+                                freeProcesses(processes, *size);
+                                close(procDirFd);
+                                fprintf(stderr, "Failed to allocate memory for process %s", dirEntry->d_name);
+                                return NULL;
+                            }
+                            processes = grown;
+                        }
                         processes[(*size)++] = process;
                     }
                 }
                 i += dirEntry->d_reclen;
             }
+            // listing /proc takes an lstat per process, which counts towards the budget as the scan does
+            chargeScanBudget(budget);
             numEntries = syscall(SYS_getdents, procDirFd, getdentsBuffer, GETDENTS_BUFFER_SIZE);
         }
     }
+    close(procDirFd);
     return processes;
 }
@@ -2,12 +2,17 @@
 #define READ_PROCESSES_H
 
 #include "processes.h"
+#include "scanBudget.h"
 #include <stddef.h>
 
+extern void freeProcess(ProcessData* process);
+
 extern void freeProcesses(ProcessData** processes, int size);
 
 extern ProcessData *readProcess(linux_dirent *source);
 
-extern ProcessData **fetchProcesses(int *size, long processIdSelected);
+extern unsigned long readProcessStartTime(unsigned long pid);
+
+extern ProcessData **fetchProcesses(int *size, long processIdSelected, ScanBudget *budget);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,429 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <linux/sock_diag.h>
+#include <linux/inet_diag.h>
+#include <linux/unix_diag.h>
+
+#include "processes.h"
+#include "readSockets.h"
+
+#define SOCKET_TABLE_INITIAL_CAPACITY 1024
+#define NETLINK_RECEIVE_BUFFER_SIZE 32768
+#define SOCKET_QUERY_COUNT 5
+#define SOCKET_ADDRESS_BUFFER_SIZE 128
+
+/**
+ * Names of socket states, indexed by the kernel's TCP_* state numbers
+ */
+static const char *socketStateNames[] = {
+    "UNKNOWN", "ESTABLISHED", "SYN_SENT", "SYN_RECV", "FIN_WAIT1", "FIN_WAIT2", "TIME_WAIT",
+    "CLOSE", "CLOSE_WAIT", "LAST_ACK", "LISTEN", "CLOSING", "NEW_SYN_RECV"};
+
+/**
+ * A single sock_diag dump request
+ */
+typedef struct SocketQuery
+{
+    unsigned char family;
+    unsigned char protocol;
+} SocketQuery;
+
+/**
+ * All dumps needed to cover tcp, udp and unix sockets
+ */
+static const SocketQuery socketQueries[SOCKET_QUERY_COUNT] = {
+    {AF_INET, IPPROTO_TCP},
+    {AF_INET, IPPROTO_UDP},
+    {AF_INET6, IPPROTO_TCP},
+    {AF_INET6, IPPROTO_UDP},
+    {AF_UNIX, 0}};
+
+/**
+ * Compute the slot at which probing starts for an inode.
+ * @param inode Inode to hash
+ * @param capacity Capacity of the table, a power of two
+ * @return Index of the first slot to probe
+ */
+static size_t socketSlot(unsigned long inode, size_t capacity)
+{
+    return (size_t)((inode * 0x9E3779B97F4A7C15ul) >> 32) & (capacity - 1);
+}
+
+/**
+ * Double the capacity of the table and rehash all sockets.
+ * @param table Table to grow
+ * @return 0 if operation was successful, nonzero otherwise
+ */
+static int growSocketTable(SocketTable *table)
+{
+    size_t newCapacity = table->capacity * 2;
+    SocketInfo *newEntries = (SocketInfo *)calloc(newCapacity, sizeof(SocketInfo));
+    if (newEntries == NULL)
+    {
+        return -1;
+    }
+    for (size_t i = 0; i < table->capacity; i++)
+    {
+        if (table->entries[i].inode == 0)
+            continue;
+        size_t slot = socketSlot(table->entries[i].inode, newCapacity);
+        while (newEntries[slot].inode != 0)
+            slot = (slot + 1) & (newCapacity - 1);
+        newEntries[slot] = table->entries[i];
+    }
+    free(table->entries);
+    table->entries = newEntries;
+    table->capacity = newCapacity;
+    return 0;
+}
+
+/**
+ * Find the slot for an inode, inserting an empty entry for it if it is absent.
+ * @param table Table to insert into
+ * @param inode Inode of the socket
+ * @return Pointer to the entry for inode, or NULL if memory could not be allocated
+ */
+static SocketInfo *insertSocket(SocketTable *table, unsigned long inode)
+{
+    // keep load factor under 1/2 so that probe sequences stay short
+    if ((table->size + 1) * 2 > table->capacity && growSocketTable(table) != 0)
+    {
+        return NULL;
+    }
+    size_t slot = socketSlot(inode, table->capacity);
+    while (table->entries[slot].inode != 0 && table->entries[slot].inode != inode)
+        slot = (slot + 1) & (table->capacity - 1);
+    if (table->entries[slot].inode == 0)
+    {
+        table->entries[slot].inode = inode;
+        table->size++;
+    }
+    return &table->entries[slot];
+}
+
+/**
+ * Look up a socket by inode.
+ * @param table Table to search
+ * @param inode Inode of the socket, as it appears in socket:[<inode>]
+ * @return Pointer to the socket information if found, NULL otherwise
+ */
+SocketInfo *findSocket(SocketTable *table, unsigned long inode)
+{
+    if (table == NULL || inode == 0)
+        return NULL;
+    size_t slot = socketSlot(inode, table->capacity);
+    while (table->entries[slot].inode != 0)
+    {
+        if (table->entries[slot].inode == inode)
+            return &table->entries[slot];
+        slot = (slot + 1) & (table->capacity - 1);
+    }
+    return NULL;
+}
+
+/**
+ * Store the contents of an inet_diag message in the table.
+ * @param table Table to store the socket in
+ * @param protocol Protocol that was requested in the dump
+ * @param message Message returned by the kernel
+ * @return 0 if operation was successful, nonzero otherwise
+ */
+static int storeInetSocket(SocketTable *table, unsigned char protocol, struct nlmsghdr *message)
+{
+    struct inet_diag_msg *diag = (struct inet_diag_msg *)NLMSG_DATA(message);
+    SocketInfo *socket = insertSocket(table, diag->idiag_inode);
+    if (socket == NULL)
+        return -1;
+    socket->family = diag->idiag_family;
+    socket->protocol = protocol;
+    socket->state = diag->idiag_state;
+    socket->receiveQueue = diag->idiag_rqueue;
+    socket->sendQueue = diag->idiag_wqueue;
+    socket->localPort = ntohs(diag->id.idiag_sport);
+    socket->remotePort = ntohs(diag->id.idiag_dport);
+    // addresses are kept raw and only formatted by describeSocket for rows that are printed
+    memcpy(socket->localAddress, diag->id.idiag_src, sizeof(socket->localAddress));
+    memcpy(socket->remoteAddress, diag->id.idiag_dst, sizeof(socket->remoteAddress));
+    return 0;
+}
+
+/**
+ * Store the contents of an unix_diag message, and its attributes, in the table.
+ * @param table Table to store the socket in
+ * @param message Message returned by the kernel
+ * @return 0 if operation was successful, nonzero otherwise
+ */
+static int storeUnixSocket(SocketTable *table, struct nlmsghdr *message)
+{
+    struct unix_diag_msg *diag = (struct unix_diag_msg *)NLMSG_DATA(message);
+    SocketInfo *socket = insertSocket(table, diag->udiag_ino);
+    if (socket == NULL)
+        return -1;
+    socket->family = AF_UNIX;
+    socket->protocol = diag->udiag_type;
+    socket->state = diag->udiag_state;
+    socket->path[0] = '\0';
+    socket->peerInode = 0;
+
+    int attributesLength = message->nlmsg_len - NLMSG_LENGTH(sizeof(*diag));
+    struct rtattr *attribute = (struct rtattr *)(diag + 1);
+    for (; RTA_OK(attribute, attributesLength); attribute = RTA_NEXT(attribute, attributesLength))
+    {
+        switch (attribute->rta_type)
+        {
+        case UNIX_DIAG_NAME:
+        {
+            // abstract socket names start with a null byte, shown as '@' like ss does
+            size_t nameLength = RTA_PAYLOAD(attribute);
+            char *name = (char *)RTA_DATA(attribute);
+            if (nameLength >= SOCKET_PATH_BUFFER_SIZE)
+                nameLength = SOCKET_PATH_BUFFER_SIZE - 1;
+            memcpy(socket->path, name, nameLength);
+            socket->path[nameLength] = '\0';
+            if (nameLength > 0 && name[0] == '\0')
+                socket->path[0] = '@';
+            break;
+        }
+        case UNIX_DIAG_PEER:
+            socket->peerInode = *(unsigned int *)RTA_DATA(attribute);
+            break;
+        case UNIX_DIAG_RQLEN:
+        {
+            struct unix_diag_rqlen *queues = (struct unix_diag_rqlen *)RTA_DATA(attribute);
+            socket->receiveQueue = queues->udiag_rqueue;
+            socket->sendQueue = queues->udiag_wqueue;
+            break;
+        }
+        default:
+            break;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Open a sock_diag netlink socket and send a dump request for one family and protocol.
+ * @param query Family and protocol to dump
+ * @return The netlink socket with the dump in flight, or -1 on failure
+ */
+static int sendSocketQuery(const SocketQuery *query)
+{
+    int netlinkFd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_SOCK_DIAG);
+    if (netlinkFd < 0)
+        return -1;
+
+    struct sockaddr_nl kernel = {.nl_family = AF_NETLINK};
+    struct
+    {
+        struct nlmsghdr header;
+        union
+        {
+            struct inet_diag_req_v2 inetRequest;
+            struct unix_diag_req unixRequest;
+        } body;
+    } request;
+    memset(&request, 0, sizeof(request));
+    request.header.nlmsg_type = SOCK_DIAG_BY_FAMILY;
+    request.header.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    if (query->family == AF_UNIX)
+    {
+        request.header.nlmsg_len = NLMSG_LENGTH(sizeof(struct unix_diag_req));
+        request.body.unixRequest.sdiag_family = AF_UNIX;
+        request.body.unixRequest.udiag_states = ~0u;
+        request.body.unixRequest.udiag_show = UDIAG_SHOW_NAME | UDIAG_SHOW_PEER | UDIAG_SHOW_RQLEN;
+    }
+    else
+    {
+        request.header.nlmsg_len = NLMSG_LENGTH(sizeof(struct inet_diag_req_v2));
+        request.body.inetRequest.sdiag_family = query->family;
+        request.body.inetRequest.sdiag_protocol = query->protocol;
+        request.body.inetRequest.idiag_states = ~0u;
+    }
+
+    if (sendto(netlinkFd, &request, request.header.nlmsg_len, 0, (struct sockaddr *)&kernel, sizeof(kernel)) < 0)
+    {
+        close(netlinkFd);
+        return -1;
+    }
+    return netlinkFd;
+}
+
+/**
+ * Read all messages of a dump from a netlink socket and store them in the table.
+ * @param netlinkFd Netlink socket returned by sendSocketQuery
+ * @param query Family and protocol that were requested
+ * @param table Table to store the sockets in
+ * @return 0 if operation was successful, nonzero otherwise. A dump refused with ENOENT or EOPNOTSUPP
+ * (e.g. udp_diag not loaded) is not an error, any other error reported by the kernel is.
+ */
+static int receiveSocketQuery(int netlinkFd, const SocketQuery *query, SocketTable *table)
+{
+    // long-aligned so the nlmsghdr casts below are aligned
+    long buffer[NETLINK_RECEIVE_BUFFER_SIZE / sizeof(long)];
+    while (1)
+    {
+        ssize_t length = recv(netlinkFd, buffer, sizeof(buffer), 0);
+        if (length < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        struct nlmsghdr *message = (struct nlmsghdr *)buffer;
+        for (; NLMSG_OK(message, length); message = NLMSG_NEXT(message, length))
+        {
+            if (message->nlmsg_type == NLMSG_DONE)
+                return 0;
+            if (message->nlmsg_type == NLMSG_ERROR)
+            {
+                // only a family or protocol whose diag module is not loaded is skipped, e.g. EPERM is an error
+                struct nlmsgerr *error = (struct nlmsgerr *)NLMSG_DATA(message);
+                if (message->nlmsg_len < NLMSG_LENGTH(sizeof(struct nlmsgerr)))
+                    return -1;
+                if (error->error == 0 || error->error == -ENOENT || error->error == -EOPNOTSUPP)
+                    return 0;
+                errno = -error->error;
+                return -1;
+            }
+            int result = query->family == AF_UNIX ? storeUnixSocket(table, message) : storeInetSocket(table, query->protocol, message);
+            if (result != 0)
+                return result;
+        }
+    }
+}
+
+/**
+ * Retrieve all inet, inet6 and unix sockets on the machine through NETLINK_SOCK_DIAG.
+ * All dump requests are sent before any reply is read, so that the kernel can fill the
+ * replies of every query at once instead of one round trip per family.
+ * @return If successful, a dynamically-allocated table of sockets keyed by inode. NULL otherwise.
+ */
+SocketTable *fetchSockets()
+{
+    SocketTable *table = (SocketTable *)malloc(sizeof(SocketTable));
+    if (table == NULL)
+        return NULL;
+    table->capacity = SOCKET_TABLE_INITIAL_CAPACITY;
+    table->size = 0;
+    table->entries = (SocketInfo *)calloc(table->capacity, sizeof(SocketInfo));
+    if (table->entries == NULL)
+    {
+        free(table);
+        return NULL;
+    }
+
+    // a netlink socket can only run one dump at a time, so each query gets its own socket
+    int netlinkFds[SOCKET_QUERY_COUNT];
+    for (int i = 0; i < SOCKET_QUERY_COUNT; i++)
+    {
+        netlinkFds[i] = sendSocketQuery(&socketQueries[i]);
+    }
+
+    int result = 0;
+    for (int i = 0; i < SOCKET_QUERY_COUNT; i++)
+    {
+        if (netlinkFds[i] < 0)
+            continue;
+        if (result == 0)
+            result = receiveSocketQuery(netlinkFds[i], &socketQueries[i], table);
+        close(netlinkFds[i]);
+    }
+
+    if (result != 0)
+    {
+        freeSockets(table);
+        return NULL;
+    }
+    return table;
+}
+
+/**
+ * Attach socket details to every socket file descriptor of the given processes.
+ * @param table Table of sockets returned by fetchSockets
+ * @param processes An array of all processes to consider.
+ * @param numProcesses The size of the processes array.
+ */
+void joinSockets(SocketTable *table, ProcessData **processes, int numProcesses)
+{
+    for (int i = 0; i < numProcesses; i++)
+    {
+        for (unsigned long j = 0; j < processes[i]->size; j++)
+        {
+            FileDescriptorEntry *entry = processes[i]->fileDescriptors[j];
+            if (entry->socket == NULL && entry->type == FD_TYPE_SOCKET)
+            {
+                entry->socket = findSocket(table, entry->inode);
+            }
+        }
+    }
+}
+
+/**
+ * Free memory used to store a table of sockets
+ * @param table Table to free
+ */
+void freeSockets(SocketTable *table)
+{
+    if (table == NULL)
+        return;
+    free(table->entries);
+    free(table);
+}
+
+/**
+ * Format the address and port of an inet socket, e.g. "127.0.0.1:80" or "[::1]:80".
+ * @param family AF_INET or AF_INET6
+ * @param address Address in network byte order
+ * @param port Port in host byte order
+ * @param buffer Buffer to write the string to, of size SOCKET_ADDRESS_BUFFER_SIZE
+ */
+static void formatInetAddress(unsigned char family, const unsigned char *address, unsigned short port, char *buffer)
+{
+    char host[INET6_ADDRSTRLEN] = "";
+    inet_ntop(family, address, host, INET6_ADDRSTRLEN);
+    if (family == AF_INET6)
+        snprintf(buffer, SOCKET_ADDRESS_BUFFER_SIZE, "[%s]:%u", host, port);
+    else
+        snprintf(buffer, SOCKET_ADDRESS_BUFFER_SIZE, "%s:%u", host, port);
+}
+
+/**
+ * Write a one-line human readable description of a socket, e.g. "TCP LISTEN 127.0.0.1:80 -> 0.0.0.0:0 rq=0 wq=128"
+ * @param socket Socket to describe
+ * @param buffer Buffer to write the description to
+ * @param bufferSize Size of buffer
+ * @return Number of characters written, as returned by snprintf
+ */
+int describeSocket(SocketInfo *socket, char *buffer, size_t bufferSize)
+{
+    char local[SOCKET_ADDRESS_BUFFER_SIZE] = "*";
+    char remote[SOCKET_ADDRESS_BUFFER_SIZE] = "*";
+    const char *protocol;
+    if (socket->family == AF_UNIX)
+    {
+        protocol = socket->protocol == SOCK_DGRAM ? "UNIX_DGRAM" : socket->protocol == SOCK_SEQPACKET ? "UNIX_SEQPACKET" : "UNIX_STREAM";
+        if (socket->path[0] != '\0')
+            snprintf(local, SOCKET_ADDRESS_BUFFER_SIZE, "%s", socket->path);
+        if (socket->peerInode != 0)
+            snprintf(remote, SOCKET_ADDRESS_BUFFER_SIZE, "peer:[%u]", socket->peerInode);
+    }
+    else
+    {
+        if (socket->protocol == IPPROTO_UDP)
+            protocol = socket->family == AF_INET6 ? "UDP6" : "UDP";
+        else
+            protocol = socket->family == AF_INET6 ? "TCP6" : "TCP";
+        formatInetAddress(socket->family, socket->localAddress, socket->localPort, local);
+        formatInetAddress(socket->family, socket->remoteAddress, socket->remotePort, remote);
+    }
+    const char *state = socket->state < sizeof(socketStateNames) / sizeof(socketStateNames[0]) ? socketStateNames[socket->state] : socketStateNames[0];
+    return snprintf(buffer, bufferSize, "%s %s %s -> %s rq=%u wq=%u", protocol, state, local, remote, socket->receiveQueue, socket->sendQueue);
+}
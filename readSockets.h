@@ -0,0 +1,38 @@
+#ifndef READ_SOCKETS_H
+#define READ_SOCKETS_H
+
+#include <stddef.h>
+
+#include "processes.h"
+
+/**
+ * Hash map of sockets keyed by inode, using open addressing with linear probing.
+ * An inode of 0 marks an empty slot.
+ */
+typedef struct SocketTable
+{
+    /**
+     * Slots of the map, of length capacity
+    */
+    SocketInfo *entries;
+    /**
+     * Number of slots in entries. Always a power of two.
+    */
+    size_t capacity;
+    /**
+     * Number of occupied slots in entries
+    */
+    size_t size;
+} SocketTable;
+
+extern SocketTable *fetchSockets();
+
+extern SocketInfo *findSocket(SocketTable *table, unsigned long inode);
+
+extern void joinSockets(SocketTable *table, ProcessData **processes, int numProcesses);
+
+extern void freeSockets(SocketTable *table);
+
+extern int describeSocket(SocketInfo *socket, char *buffer, size_t bufferSize);
+
+#endif
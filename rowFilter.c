@@ -0,0 +1,453 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <fnmatch.h>
+
+#include "processes.h"
+#include "stringUtils.h"
+#include "rowFilter.h"
+
+#define FILTER_WORD_SIZE SYMBOLIC_LINK_BUFFER_SIZE
+
+/**
+ * State of the compiler while it reads an expression
+ */
+typedef struct FilterParser
+{
+    const char *expression;
+    const char *cursor;
+    RowFilter *filter;
+    /**
+     * Set to a description of the first error found, NULL while there is none
+    */
+    const char *error;
+    /**
+     * Storage for an error built at runtime
+    */
+    char message[FD_TYPE_NAMES_SIZE + 16];
+} FilterParser;
+
+/**
+ * Names of fields as written in expressions, indexed by FilterField
+ */
+static const char *filterFieldNames[] = {"pid", "fd", "path", "type", "inode"};
+
+/**
+ * Stage at which each field becomes known, indexed by FilterField
+ */
+static const FilterStage filterFieldStages[] = {FILTER_STAGE_PID, FILTER_STAGE_FD, FILTER_STAGE_PATH, FILTER_STAGE_PATH, FILTER_STAGE_INODE};
+
+static void parseOr(FilterParser *parser);
+
+/**
+ * Record an error, keeping the first one.
+ * @param parser Parser that found the error
+ * @param error Description of the error
+ */
+static void fail(FilterParser *parser, const char *error)
+{
+    if (parser->error == NULL)
+        parser->error = error;
+}
+
+static void skipSpace(FilterParser *parser)
+{
+    while (isspace((unsigned char)*parser->cursor))
+        parser->cursor++;
+}
+
+/**
+ * Consume the given token if the expression continues with it.
+ * @param parser Parser to read from
+ * @param token Token to look for
+ * @return 1 if the token was consumed, 0 otherwise
+ */
+static int accept(FilterParser *parser, const char *token)
+{
+    skipSpace(parser);
+    size_t length = strlen(token);
+    if (strncmp(parser->cursor, token, length) != 0)
+        return 0;
+    // keywords must not be the start of a longer word
+    if (isalpha((unsigned char)token[0]) && isalnum((unsigned char)parser->cursor[length]))
+        return 0;
+    parser->cursor += length;
+    return 1;
+}
+
+/**
+ * Read a value: either a double-quoted string, in which backslash escapes the next character,
+ * or a bare word ending at a space, parenthesis, '&', '|' or "..".
+ * @param parser Parser to read from
+ * @param word Buffer of size FILTER_WORD_SIZE to store the value in
+ */
+static void readWord(FilterParser *parser, char *word)
+{
+    skipSpace(parser);
+    size_t length = 0;
+    if (*parser->cursor == '"')
+    {
+        parser->cursor++;
+        while (*parser->cursor != '"' && *parser->cursor != '\0' && length < FILTER_WORD_SIZE - 1)
+        {
+            if (*parser->cursor == '\\' && parser->cursor[1] != '\0')
+                parser->cursor++;
+            word[length++] = *parser->cursor++;
+        }
+        if (*parser->cursor != '"')
+            fail(parser, "unterminated string");
+        else
+            parser->cursor++;
+    }
+    else
+    {
+        while (*parser->cursor != '\0' && !isspace((unsigned char)*parser->cursor) && strchr("()&|", *parser->cursor) == NULL &&
+               strncmp(parser->cursor, "..", 2) != 0 && length < FILTER_WORD_SIZE - 1)
+            word[length++] = *parser->cursor++;
+        if (length == 0)
+            fail(parser, "expected a value");
+    }
+    word[length] = '\0';
+}
+
+/**
+ * Read a decimal number.
+ * @param parser Parser to read from
+ * @return The number read
+ */
+static unsigned long readNumber(FilterParser *parser)
+{
+    char word[FILTER_WORD_SIZE];
+    readWord(parser, word);
+    if (parser->error == NULL && !isNumber(word))
+        fail(parser, "expected a number");
+    return strtoul(word, NULL, 10);
+}
+
+/**
+ * Append an instruction to the program.
+ * @param parser Parser compiling the program
+ * @return The new instruction, zeroed, or a scratch instruction if the program is full
+ */
+static FilterInstruction *emit(FilterParser *parser, FilterOpcode opcode)
+{
+    static FilterInstruction overflow;
+    if (parser->filter->length == FILTER_MAX_INSTRUCTIONS)
+    {
+        fail(parser, "expression is too long");
+        return &overflow;
+    }
+    FilterInstruction *instruction = &parser->filter->instructions[parser->filter->length++];
+    memset(instruction, 0, sizeof(FilterInstruction));
+    instruction->opcode = opcode;
+    return instruction;
+}
+
+/**
+ * Compile a comparison: <field> <operator> <value>, or <field> in <low>..<high>.
+ * @param parser Parser to read from
+ */
+static void parseComparison(FilterParser *parser)
+{
+    skipSpace(parser);
+    int field = -1;
+    for (int i = 0; i < sizeof(filterFieldNames) / sizeof(filterFieldNames[0]); i++)
+    {
+        if (accept(parser, filterFieldNames[i]))
+        {
+            field = i;
+            break;
+        }
+    }
+    if (field == -1)
+    {
+        fail(parser, "expected pid, fd, path, type or inode");
+        return;
+    }
+
+    FilterComparison comparison;
+    if (accept(parser, "=="))
+        comparison = FILTER_EQUAL;
+    else if (accept(parser, "!="))
+        comparison = FILTER_NOT_EQUAL;
+    else if (accept(parser, "<="))
+        comparison = FILTER_LESS_EQUAL;
+    else if (accept(parser, ">="))
+        comparison = FILTER_GREATER_EQUAL;
+    else if (accept(parser, "^="))
+        comparison = FILTER_PREFIX;
+    else if (accept(parser, "<"))
+        comparison = FILTER_LESS;
+    else if (accept(parser, ">"))
+        comparison = FILTER_GREATER;
+    else if (accept(parser, "="))
+        comparison = FILTER_EQUAL;
+    else if (accept(parser, "~"))
+        comparison = FILTER_GLOB;
+    else if (accept(parser, "in"))
+        comparison = FILTER_IN_RANGE;
+    else
+    {
+        fail(parser, "expected a comparison operator");
+        return;
+    }
+
+    FilterInstruction *instruction = emit(parser, FILTER_OP_COMPARE);
+    instruction->field = (FilterField)field;
+    instruction->comparison = comparison;
+    parser->filter->usesStage[filterFieldStages[field]] = 1;
+
+    if (field == FILTER_FIELD_PATH)
+    {
+        if (comparison != FILTER_EQUAL && comparison != FILTER_NOT_EQUAL && comparison != FILTER_GLOB && comparison != FILTER_PREFIX)
+        {
+            fail(parser, "paths can only be compared with ==, !=, ~ or ^=");
+            return;
+        }
+        char word[FILTER_WORD_SIZE];
+        readWord(parser, word);
+        instruction->text = strdup(word);
+        instruction->low = strlen(word);
+        if (instruction->text == NULL)
+            fail(parser, "out of memory");
+    }
+    else if (field == FILTER_FIELD_TYPE)
+    {
+        if (comparison != FILTER_EQUAL && comparison != FILTER_NOT_EQUAL)
+        {
+            fail(parser, "types can only be compared with == or !=");
+            return;
+        }
+        char word[FILTER_WORD_SIZE];
+        readWord(parser, word);
+        instruction->low = FD_TYPE_COUNT;
+        for (int type = 0; type < FD_TYPE_COUNT; type++)
+        {
+            if (strcmp(word, fileDescriptorTypeName(type)) == 0)
+                instruction->low = type;
+        }
+        if (instruction->low == FD_TYPE_COUNT)
+        {
+            char names[FD_TYPE_NAMES_SIZE];
+            snprintf(parser->message, sizeof(parser->message), "expected %s", listFileDescriptorTypeNames(names, sizeof(names)));
+            fail(parser, parser->message);
+        }
+    }
+    else
+    {
+        if (comparison == FILTER_GLOB || comparison == FILTER_PREFIX)
+        {
+            fail(parser, "numbers can not be compared with ~ or ^=");
+            return;
+        }
+        instruction->low = readNumber(parser);
+        if (comparison == FILTER_IN_RANGE)
+        {
+            if (!accept(parser, ".."))
+                fail(parser, "expected .. in range");
+            instruction->high = readNumber(parser);
+        }
+    }
+}
+
+/**
+ * Compile a negation, a parenthesized expression or a comparison.
+ * @param parser Parser to read from
+ */
+static void parseUnary(FilterParser *parser)
+{
+    if (parser->error != NULL)
+        return;
+    if (accept(parser, "!"))
+    {
+        parseUnary(parser);
+        emit(parser, FILTER_OP_NOT);
+    }
+    else if (accept(parser, "("))
+    {
+        parseOr(parser);
+        if (!accept(parser, ")"))
+            fail(parser, "expected )");
+    }
+    else
+    {
+        parseComparison(parser);
+    }
+}
+
+/**
+ * Compile a conjunction of unary expressions.
+ * @param parser Parser to read from
+ */
+static void parseAnd(FilterParser *parser)
+{
+    parseUnary(parser);
+    while (parser->error == NULL && accept(parser, "&&"))
+    {
+        parseUnary(parser);
+        emit(parser, FILTER_OP_AND);
+    }
+}
+
+/**
+ * Compile a disjunction of conjunctions.
+ * @param parser Parser to read from
+ */
+static void parseOr(FilterParser *parser)
+{
+    parseAnd(parser);
+    while (parser->error == NULL && accept(parser, "||"))
+    {
+        parseAnd(parser);
+        emit(parser, FILTER_OP_OR);
+    }
+}
+
+/**
+ * Compile a filter expression, e.g. "type == socket && (fd >= 1000 || path ^= /var/log/)".
+ * Comparisons are joined with && and ||, negated with ! and grouped with parentheses.
+ * Numeric fields (pid, fd, inode) support ==, !=, <, <=, >, >= and "in low..high". path supports
+ * == and != with a path, ~ with a shell glob and ^= with a prefix. type supports == and != with
+ * the name of any FileDescriptorType, as printed in the type column. Errors are printed to stderr.
+ * @param expression Expression to compile
+ * @return If successful, a dynamically-allocated filter. NULL otherwise.
+ */
+RowFilter *compileRowFilter(const char *expression)
+{
+    RowFilter *filter = (RowFilter *)calloc(1, sizeof(RowFilter));
+    if (filter == NULL)
+        return NULL;
+    FilterParser parser = {expression, expression, filter, NULL, {0}};
+    parseOr(&parser);
+    skipSpace(&parser);
+    if (parser.error == NULL && *parser.cursor != '\0')
+        fail(&parser, "unexpected text after expression");
+    if (parser.error != NULL)
+    {
+        fprintf(stderr, "Error: Invalid filter at character %ld of \"%s\": %s.\n", (long)(parser.cursor - expression) + 1, expression, parser.error);
+        freeRowFilter(filter);
+        return NULL;
+    }
+    return filter;
+}
+
+/**
+ * Free memory used to store a filter
+ * @param filter Filter to free, may be NULL
+ */
+void freeRowFilter(RowFilter *filter)
+{
+    if (filter == NULL)
+        return;
+    for (int i = 0; i < filter->length; i++)
+        free(filter->instructions[i].text);
+    free(filter);
+}
+
+/**
+ * Compare a field of a row with the constant of an instruction.
+ * @param instruction Comparison to evaluate
+ * @param row Row whose field is compared
+ * @return Nonzero if the comparison holds
+ */
+static int compareField(const FilterInstruction *instruction, const FilterRow *row)
+{
+    if (instruction->field == FILTER_FIELD_PATH)
+    {
+        const char *path = row->path != NULL ? row->path : "";
+        switch (instruction->comparison)
+        {
+        case FILTER_EQUAL:
+            return strcmp(path, instruction->text) == 0;
+        case FILTER_NOT_EQUAL:
+            return strcmp(path, instruction->text) != 0;
+        case FILTER_GLOB:
+            return fnmatch(instruction->text, path, 0) == 0;
+        case FILTER_PREFIX:
+            return strncmp(path, instruction->text, instruction->low) == 0;
+        default:
+            return 0;
+        }
+    }
+
+    unsigned long value;
+    switch (instruction->field)
+    {
+    case FILTER_FIELD_PID:
+        value = row->pid;
+        break;
+    case FILTER_FIELD_FD:
+        value = row->fd;
+        break;
+    case FILTER_FIELD_TYPE:
+        value = row->type;
+        break;
+    default:
+        value = row->inode;
+        break;
+    }
+    switch (instruction->comparison)
+    {
+    case FILTER_EQUAL:
+        return value == instruction->low;
+    case FILTER_NOT_EQUAL:
+        return value != instruction->low;
+    case FILTER_LESS:
+        return value < instruction->low;
+    case FILTER_LESS_EQUAL:
+        return value <= instruction->low;
+    case FILTER_GREATER:
+        return value > instruction->low;
+    case FILTER_GREATER_EQUAL:
+        return value >= instruction->low;
+    case FILTER_IN_RANGE:
+        return value >= instruction->low && value <= instruction->high;
+    default:
+        return 0;
+    }
+}
+
+/**
+ * Evaluate a filter over a row resolved up to the given stage. Comparisons of fields that are
+ * not resolved yet are unknown, so the filter is only false once no later field can make it true.
+ * @param filter Filter to evaluate, NULL to accept every row
+ * @param stage Latest stage reached by the row
+ * @param row Fields of the row
+ * @return FILTER_FALSE if the row can be skipped, FILTER_TRUE if it is kept whatever its later fields, FILTER_UNKNOWN otherwise
+ */
+FilterResult evaluateRowFilter(const RowFilter *filter, FilterStage stage, const FilterRow *row)
+{
+    if (filter == NULL || filter->length == 0)
+        return FILTER_TRUE;
+    unsigned char stack[FILTER_MAX_INSTRUCTIONS];
+    int top = 0;
+    for (int i = 0; i < filter->length; i++)
+    {
+        const FilterInstruction *instruction = &filter->instructions[i];
+        switch (instruction->opcode)
+        {
+        case FILTER_OP_COMPARE:
+            if (filterFieldStages[instruction->field] > stage)
+                stack[top++] = FILTER_UNKNOWN;
+            else
+                stack[top++] = compareField(instruction, row) ? FILTER_TRUE : FILTER_FALSE;
+            break;
+        case FILTER_OP_AND:
+            top--;
+            if (stack[top] < stack[top - 1])
+                stack[top - 1] = stack[top];
+            break;
+        case FILTER_OP_OR:
+            top--;
+            if (stack[top] > stack[top - 1])
+                stack[top - 1] = stack[top];
+            break;
+        case FILTER_OP_NOT:
+            stack[top - 1] = FILTER_TRUE - stack[top - 1];
+            break;
+        }
+    }
+    return (FilterResult)stack[0];
+}
@@ -0,0 +1,135 @@
+#ifndef ROW_FILTER_H
+#define ROW_FILTER_H
+
+#include "processes.h"
+
+#define FILTER_MAX_INSTRUCTIONS 64
+
+/**
+ * Points of a scan at which more fields of a row become known, in the order they are reached
+ */
+typedef enum FilterStage
+{
+    /**
+     * Before /proc/<pid>/fd is opened: pid
+    */
+    FILTER_STAGE_PID,
+    /**
+     * After getdents, from the name of the entry: fd
+    */
+    FILTER_STAGE_FD,
+    /**
+     * After readlink: path and type
+    */
+    FILTER_STAGE_PATH,
+    /**
+     * After stat, or parsing the inode of sockets and pipes: inode
+    */
+    FILTER_STAGE_INODE,
+    FILTER_STAGE_COUNT
+} FilterStage;
+
+/**
+ * Result of a filter over a partially resolved row, using three-valued logic. The values are
+ * ordered so that AND is the minimum, OR the maximum and NOT the complement.
+ */
+typedef enum FilterResult
+{
+    FILTER_FALSE = 0,
+    /**
+     * The result depends on fields that are not resolved yet
+    */
+    FILTER_UNKNOWN = 1,
+    FILTER_TRUE = 2
+} FilterResult;
+
+/**
+ * Fields of a row being scanned. Only the fields of stages already reached are valid.
+ */
+typedef struct FilterRow
+{
+    unsigned long pid;
+    unsigned long fd;
+    const char *path;
+    FileDescriptorType type;
+    unsigned long inode;
+} FilterRow;
+
+typedef enum FilterOpcode
+{
+    /**
+     * Push the result of comparing a field with a constant
+    */
+    FILTER_OP_COMPARE,
+    FILTER_OP_AND,
+    FILTER_OP_OR,
+    FILTER_OP_NOT
+} FilterOpcode;
+
+typedef enum FilterField
+{
+    FILTER_FIELD_PID,
+    FILTER_FIELD_FD,
+    FILTER_FIELD_PATH,
+    FILTER_FIELD_TYPE,
+    FILTER_FIELD_INODE
+} FilterField;
+
+typedef enum FilterComparison
+{
+    FILTER_EQUAL,
+    FILTER_NOT_EQUAL,
+    FILTER_LESS,
+    FILTER_LESS_EQUAL,
+    FILTER_GREATER,
+    FILTER_GREATER_EQUAL,
+    /**
+     * Number within low..high, inclusive
+    */
+    FILTER_IN_RANGE,
+    /**
+     * Path matching a shell glob
+    */
+    FILTER_GLOB,
+    /**
+     * Path starting with a prefix
+    */
+    FILTER_PREFIX
+} FilterComparison;
+
+/**
+ * One instruction of a compiled filter
+ */
+typedef struct FilterInstruction
+{
+    FilterOpcode opcode;
+    FilterField field;
+    FilterComparison comparison;
+    unsigned long low;
+    unsigned long high;
+    /**
+     * Constant path, glob or prefix of path comparisons
+    */
+    char *text;
+} FilterInstruction;
+
+/**
+ * A filter expression compiled into a postfix program
+ */
+typedef struct RowFilter
+{
+    FilterInstruction instructions[FILTER_MAX_INSTRUCTIONS];
+    int length;
+    /**
+     * Whether any instruction reads a field of each stage, so that stages without one are not evaluated
+    */
+    int usesStage[FILTER_STAGE_COUNT];
+} RowFilter;
+
+extern RowFilter *compileRowFilter(const char *expression);
+
+extern void freeRowFilter(RowFilter *filter);
+
+extern FilterResult evaluateRowFilter(const RowFilter *filter, FilterStage stage, const FilterRow *row);
+
+#endif
@@ -0,0 +1,99 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+
+#include "scanBudget.h"
+
+/**
+ * Read a clock in milliseconds.
+ * @param clock Clock to read, e.g. CLOCK_MONOTONIC
+ * @return Time of the clock in milliseconds
+ */
+static double clockMilliseconds(clockid_t clock)
+{
+    struct timespec now;
+    clock_gettime(clock, &now);
+    return now.tv_sec * 1e3 + now.tv_nsec / 1e6;
+}
+
+/**
+ * Start a budget for the calling thread, with a full bucket.
+ * @param budget Budget to initialize
+ * @param share Share of one CPU the thread may use, between 0 and 1
+ */
+void initScanBudget(ScanBudget *budget, double share)
+{
+    memset(budget, 0, sizeof(ScanBudget));
+    budget->share = share;
+    budget->tokens = SCAN_BUDGET_BURST_MS;
+    budget->startWall = budget->lastWall = clockMilliseconds(CLOCK_MONOTONIC);
+    budget->lastCpu = clockMilliseconds(CLOCK_THREAD_CPUTIME_ID);
+}
+
+/**
+ * Take the CPU time used since the last checkpoint from the bucket of the calling thread. If
+ * the bucket is empty, sleep until it has refilled, otherwise yield the CPU so that other
+ * runnable threads go first. Must be called by the thread the budget was initialized on.
+ * @param budget Budget of the calling thread, nothing is done if NULL
+ */
+void chargeScanBudget(ScanBudget *budget)
+{
+    if (budget == NULL)
+        return;
+    double wall = clockMilliseconds(CLOCK_MONOTONIC);
+    double cpu = clockMilliseconds(CLOCK_THREAD_CPUTIME_ID);
+    budget->tokens += (wall - budget->lastWall) * budget->share - (cpu - budget->lastCpu);
+    budget->usedMs += cpu - budget->lastCpu;
+    if (budget->tokens > SCAN_BUDGET_BURST_MS)
+        budget->tokens = SCAN_BUDGET_BURST_MS;
+    budget->lastWall = wall;
+    budget->lastCpu = cpu;
+    if (budget->tokens >= 0)
+    {
+        budget->yields++;
+        sched_yield();
+        return;
+    }
+    // the time slept is added back to the bucket at the next checkpoint
+    double pause = -budget->tokens / budget->share;
+    struct timespec duration = {(time_t)(pause / 1e3), (long)((pause - (long)(pause / 1e3) * 1e3) * 1e6)};
+    nanosleep(&duration, NULL);
+    budget->sleeps++;
+    budget->sleptMs += pause;
+}
+
+/**
+ * Add the use of one budget to another, e.g. to sum the budgets of several threads sharing the
+ * budget of the total. The time of the total spans both budgets.
+ * @param total Budget to add to
+ * @param part Budget to add
+ */
+void addScanBudget(ScanBudget *total, const ScanBudget *part)
+{
+    total->usedMs += part->usedMs;
+    if (part->startWall < total->startWall)
+        total->startWall = part->startWall;
+    if (part->lastWall > total->lastWall)
+        total->lastWall = part->lastWall;
+    total->yields += part->yields;
+    total->sleeps += part->sleeps;
+    total->sleptMs += part->sleptMs;
+}
+
+/**
+ * Print the share of a CPU a scan was allowed and actually used, and its rate.
+ * @param budget Budget of the scan, up to its last checkpoint
+ * @param processes Number of processes scanned
+ * @param rows Number of file descriptors seen
+ * @param stream Stream to output plain-text to
+ */
+void printScanBudget(const ScanBudget *budget, unsigned long processes, unsigned long rows, FILE *stream)
+{
+    double wall = budget->lastWall - budget->startWall;
+    double cpu = budget->usedMs;
+    double seconds = wall > 0 ? wall / 1e3 : 1e-9;
+    fprintf(stream, "## Budget %.1f%% of a CPU: used %.1f%% over %.2f s, %.0f processes/s, %.0f file descriptors/s\n",
+            budget->share * 100, wall > 0 ? cpu / wall * 100 : 0, wall / 1e3, processes / seconds, rows / seconds);
+    fprintf(stream, "## Throttling: yielded %lu times, slept %lu times for %.2f s\n", budget->yields, budget->sleeps, budget->sleptMs / 1e3);
+}
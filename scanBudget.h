@@ -0,0 +1,51 @@
+#ifndef SCAN_BUDGET_H
+#define SCAN_BUDGET_H
+
+#include <stdio.h>
+
+// CPU time a scan may spend in one burst before it is made to sleep, in milliseconds
+#define SCAN_BUDGET_BURST_MS 2.0
+
+/**
+ * Token bucket limiting the CPU time of a scanning thread to a share of one CPU. Tokens are
+ * milliseconds of CPU time: they accrue with wall-clock time at the rate of the share, and the
+ * CPU time of the thread, user and system, is taken from them at every checkpoint.
+ */
+typedef struct ScanBudget
+{
+    /**
+     * Share of one CPU the thread may use, between 0 and 1
+    */
+    double share;
+    /**
+     * Milliseconds of CPU time the thread may still use before it sleeps, at most SCAN_BUDGET_BURST_MS
+    */
+    double tokens;
+    /**
+     * Wall-clock time of the start and of the last checkpoint, and thread CPU time of the last
+     * checkpoint, in milliseconds
+    */
+    double startWall;
+    double lastWall;
+    double lastCpu;
+    /**
+     * CPU time taken from the bucket so far, in milliseconds
+    */
+    double usedMs;
+    /**
+     * Checkpoints at which the thread yielded the CPU, or slept until the bucket refilled
+    */
+    unsigned long yields;
+    unsigned long sleeps;
+    double sleptMs;
+} ScanBudget;
+
+extern void initScanBudget(ScanBudget *budget, double share);
+
+extern void chargeScanBudget(ScanBudget *budget);
+
+extern void addScanBudget(ScanBudget *total, const ScanBudget *part);
+
+extern void printScanBudget(const ScanBudget *budget, unsigned long processes, unsigned long rows, FILE *stream);
+
+#endif
@@ -0,0 +1,257 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+
+#include "processes.h"
+#include "columns.h"
+#include "readFileDescriptors.h"
+#include "fdCountCache.h"
+#include "scanScheduler.h"
+
+/**
+ * A process to scan and the number of file descriptors it is expected to have
+ */
+typedef struct ScheduledProcess
+{
+    unsigned long hint;
+    int index;
+} ScheduledProcess;
+
+/**
+ * State shared by the threads of a scan
+ */
+typedef struct ScanSchedule
+{
+    ProcessData **processes;
+    /**
+     * Indexes of the processes, in the order they are taken
+    */
+    int *order;
+    int numProcesses;
+    int numThreads;
+    /**
+     * Position in order of the next process to take
+    */
+    atomic_int next;
+    /**
+     * Options of each thread, sharing the filter and rollups of the scan but counting separately
+    */
+    ScanOptions scanOptions[MAX_SCAN_THREADS];
+    ScanStats scanStats[MAX_SCAN_THREADS];
+    /**
+     * Budgets of each thread, sharing the CPU budget of the scan equally. Unused if budgetShare is 0.
+    */
+    ScanBudget scanBudgets[MAX_SCAN_THREADS];
+    double budgetShare;
+    double startMs;
+    double finishMs[MAX_SCAN_THREADS];
+    atomic_int failed;
+} ScanSchedule;
+
+/**
+ * Arguments of a scanning thread
+ */
+typedef struct ScanThreadArgument
+{
+    ScanSchedule *schedule;
+    int index;
+} ScanThreadArgument;
+
+/**
+ * Read the monotonic clock in milliseconds.
+ */
+static double scheduleMilliseconds()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1e3 + now.tv_nsec / 1e6;
+}
+
+/**
+ * Set the expected number of file descriptors of each process from the size of /proc/<pid>/fd,
+ * which is the number of open file descriptors on Linux 6.2 and later, or else from the counts of
+ * a previous scan.
+ * @param processes An array of processes whose file descriptors are not read yet
+ * @param numProcesses The size of the processes array.
+ * @param cache Counts of a previous scan, used where the size of the directory is 0. May be NULL.
+ * @param options Options of the scan, counting the stat calls made
+ */
+void estimateFileDescriptorCounts(ProcessData **processes, int numProcesses, const FdCountCache *cache, const ScanOptions *options)
+{
+    char folderPath[GETDENTS_BUFFER_SIZE];
+    for (int i = 0; i < numProcesses; i++)
+    {
+        struct stat stats;
+        snprintf(folderPath, GETDENTS_BUFFER_SIZE, "/proc/%ld/fd", processes[i]->pid);
+        processes[i]->sizeHint = stat(folderPath, &stats) != -1 ? stats.st_size : 0;
+        if (options != NULL && options->stats != NULL)
+            options->stats->statCalls++;
+        if (processes[i]->sizeHint == 0 && cache != NULL)
+            processes[i]->sizeHint = lookupFdCount(cache, processes[i]->pid);
+    }
+}
+
+/**
+ * Order processes by descending expected number of file descriptors, then by position
+ */
+static int compareScheduled(const void *a, const void *b)
+{
+    const ScheduledProcess *first = (const ScheduledProcess *)a;
+    const ScheduledProcess *second = (const ScheduledProcess *)b;
+    if (first->hint != second->hint)
+        return first->hint < second->hint ? 1 : -1;
+    return first->index - second->index;
+}
+
+/**
+ * Take processes from the schedule and read their file descriptors until none are left.
+ * @param argument The ScanThreadArgument of the thread
+ * @return NULL
+ */
+static void *scanScheduled(void *argument)
+{
+    ScanSchedule *schedule = ((ScanThreadArgument *)argument)->schedule;
+    int index = ((ScanThreadArgument *)argument)->index;
+    // the CPU time of a budget is that of the thread it starts on
+    if (schedule->budgetShare > 0)
+    {
+        initScanBudget(&schedule->scanBudgets[index], schedule->budgetShare / schedule->numThreads);
+        schedule->scanOptions[index].budget = &schedule->scanBudgets[index];
+    }
+    for (int i = atomic_fetch_add(&schedule->next, 1); i < schedule->numProcesses; i = atomic_fetch_add(&schedule->next, 1))
+    {
+        if (readFileDescriptors(schedule->processes[schedule->order[i]], &schedule->scanOptions[index]) != 0)
+            atomic_store(&schedule->failed, 1);
+    }
+    schedule->finishMs[index] = scheduleMilliseconds();
+    return NULL;
+}
+
+/**
+ * Read the file descriptors of processes on several threads, which take the next process in the
+ * given order as they become free. The processes array itself is not reordered, so tables print
+ * in the same order whatever the schedule.
+ * @param processes An array of processes whose file descriptors are not read yet
+ * @param numProcesses The size of the processes array.
+ * @param numThreads Number of threads reading file descriptors, at most MAX_SCAN_THREADS. With a
+ * single thread, processes are scanned on the calling thread.
+ * @param order Order in which processes are taken. Largest first uses the expected number of file
+ * descriptors set by estimateFileDescriptorCounts.
+ * @param options Columns, filter, counters, budget and rollups of the scan, may be NULL to resolve every column. Counters of all threads are added to its stats, and their use of the CPU to its budget, which they share equally.
+ * @param stats If not NULL, the timing of the scan is assigned to it
+ * @return 0 if operation was successful, nonzero otherwise
+ */
+int scanProcesses(ProcessData **processes,
+                  int numProcesses,
+                  int numThreads,
+                  ScanOrder order,
+                  const ScanOptions *options,
+                  ScanScheduleStats *stats)
+{
+    if (numThreads < 1)
+        numThreads = 1;
+    if (numThreads > MAX_SCAN_THREADS)
+        numThreads = MAX_SCAN_THREADS;
+
+    ScanSchedule *schedule = (ScanSchedule *)calloc(1, sizeof(ScanSchedule));
+    ScheduledProcess *scheduled = (ScheduledProcess *)malloc(sizeof(ScheduledProcess) * (numProcesses + 1));
+    int *indexes = (int *)malloc(sizeof(int) * (numProcesses + 1));
+    if (schedule == NULL || scheduled == NULL || indexes == NULL)
+    {
+        free(schedule);
+        free(scheduled);
+        free(indexes);
+        return 1;
+    }
+    for (int i = 0; i < numProcesses; i++)
+    {
+        scheduled[i].hint = processes[i]->sizeHint;
+        scheduled[i].index = i;
+    }
+    if (order == SCAN_ORDER_LARGEST_FIRST)
+        qsort(scheduled, numProcesses, sizeof(ScheduledProcess), compareScheduled);
+    for (int i = 0; i < numProcesses; i++)
+        indexes[i] = scheduled[i].index;
+    free(scheduled);
+
+    schedule->processes = processes;
+    schedule->order = indexes;
+    schedule->numProcesses = numProcesses;
+    schedule->numThreads = numThreads;
+    schedule->startMs = scheduleMilliseconds();
+    atomic_init(&schedule->next, 0);
+    atomic_init(&schedule->failed, 0);
+
+    int numStarted = 0;
+    if (numThreads > 1)
+    {
+        schedule->budgetShare = options != NULL && options->budget != NULL ? options->budget->share : 0;
+        ScanThreadArgument arguments[MAX_SCAN_THREADS];
+        pthread_t threads[MAX_SCAN_THREADS];
+        for (int k = 0; k < numThreads; k++)
+        {
+            schedule->scanOptions[k].columns = options != NULL ? options->columns : ALL_COLUMNS;
+            schedule->scanOptions[k].filter = options != NULL ? options->filter : NULL;
+            schedule->scanOptions[k].types = options != NULL ? options->types : 0;
+            schedule->scanOptions[k].groups = options != NULL ? options->groups : NULL;
+            schedule->scanOptions[k].stats = options != NULL && options->stats != NULL ? &schedule->scanStats[k] : NULL;
+        }
+        for (; numStarted < numThreads; numStarted++)
+        {
+            arguments[numStarted].schedule = schedule;
+            arguments[numStarted].index = numStarted;
+            if (pthread_create(&threads[numStarted], NULL, scanScheduled, &arguments[numStarted]) != 0)
+                break;
+        }
+        for (int k = 0; k < numStarted; k++)
+        {
+            pthread_join(threads[k], NULL);
+            if (schedule->scanOptions[k].stats != NULL)
+                addScanStats(options->stats, schedule->scanOptions[k].stats);
+            if (schedule->scanOptions[k].budget != NULL)
+                addScanBudget(options->budget, schedule->scanOptions[k].budget);
+        }
+    }
+    // with a single thread, or if no thread could start, the calling thread scans with the
+    // options, and the budget, of the scan
+    if (numStarted == 0)
+    {
+        for (int i = 0; i < numProcesses; i++)
+        {
+            if (readFileDescriptors(processes[indexes[i]], options) != 0)
+                atomic_store(&schedule->failed, 1);
+        }
+        schedule->finishMs[0] = scheduleMilliseconds();
+        numStarted = 1;
+    }
+
+    if (stats != NULL)
+    {
+        stats->numThreads = numStarted;
+        // once scanned, the hint of a process is its number of file descriptors
+        stats->largestProcess = 0;
+        for (int i = 0; i < numProcesses; i++)
+        {
+            if (processes[i]->sizeHint > stats->largestProcess)
+                stats->largestProcess = processes[i]->sizeHint;
+        }
+        stats->makespanMs = 0;
+        stats->firstIdleMs = schedule->finishMs[0] - schedule->startMs;
+        for (int k = 0; k < numStarted; k++)
+        {
+            double finish = schedule->finishMs[k] - schedule->startMs;
+            if (finish > stats->makespanMs)
+                stats->makespanMs = finish;
+            if (finish < stats->firstIdleMs)
+                stats->firstIdleMs = finish;
+        }
+    }
+    int result = atomic_load(&schedule->failed);
+    free(indexes);
+    free(schedule);
+    return result;
+}
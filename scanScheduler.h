@@ -0,0 +1,54 @@
+#ifndef SCAN_SCHEDULER_H
+#define SCAN_SCHEDULER_H
+
+#include "processes.h"
+#include "readFileDescriptors.h"
+#include "fdCountCache.h"
+
+#define MAX_SCAN_THREADS 64
+
+/**
+ * Order in which the threads of a scan take processes
+ */
+typedef enum ScanOrder
+{
+    /**
+     * Order of the processes array, i.e. of /proc
+    */
+    SCAN_ORDER_LISTED,
+    /**
+     * Most expected file descriptors first, so that no large process is left to scan alone at the end
+    */
+    SCAN_ORDER_LARGEST_FIRST
+} ScanOrder;
+
+/**
+ * Timing of a scan of processes on several threads
+ */
+typedef struct ScanScheduleStats
+{
+    int numThreads;
+    /**
+     * Milliseconds from the start of the scan until the last thread finished
+    */
+    double makespanMs;
+    /**
+     * Milliseconds from the start of the scan until the first thread ran out of processes
+    */
+    double firstIdleMs;
+    /**
+     * Number of file descriptors found in the largest process
+    */
+    unsigned long largestProcess;
+} ScanScheduleStats;
+
+extern void estimateFileDescriptorCounts(ProcessData **processes, int numProcesses, const FdCountCache *cache, const ScanOptions *options);
+
+extern int scanProcesses(ProcessData **processes,
+                         int numProcesses,
+                         int numThreads,
+                         ScanOrder order,
+                         const ScanOptions *options,
+                         ScanScheduleStats *stats);
+
+#endif
@@ -0,0 +1,513 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "processes.h"
+#include "readProcesses.h"
+#include "sharedSnapshot.h"
+
+#define SHARED_MIN_ROW_CAPACITY 4096
+#define SHARED_MIN_STRING_CAPACITY (64 * 1024)
+// attempts to map the region that replaced a retired one, waiting 100 us then twice as long after each
+#define SHARED_REMAP_ATTEMPTS 10
+#define SHARED_REMAP_FIRST_PAUSE_NS 100000L
+
+/**
+ * Locate a buffer within the shared region.
+ * @param header Start of the shared region
+ * @param index Index of the buffer, 0 or 1
+ * @return Pointer to the buffer
+ */
+static SharedBuffer *sharedBufferAt(const SharedSnapshotHeader *header, unsigned int index)
+{
+    return (SharedBuffer *)((char *)header + sizeof(SharedSnapshotHeader) + index * header->bufferSize);
+}
+
+/**
+ * Locate the rows of a buffer.
+ * @param buffer Buffer of the shared region
+ * @return Pointer to the first row of the buffer
+ */
+static SharedRow *sharedRowsOf(const SharedBuffer *buffer)
+{
+    return (SharedRow *)((char *)buffer + sizeof(SharedBuffer));
+}
+
+/**
+ * Locate the string area of a buffer.
+ * @param header Start of the shared region
+ * @param buffer Buffer of the shared region
+ * @return Pointer to the first byte of the string area of the buffer
+ */
+static char *sharedStringsOf(const SharedSnapshotHeader *header, const SharedBuffer *buffer)
+{
+    return (char *)sharedRowsOf(buffer) + header->rowCapacity * sizeof(SharedRow);
+}
+
+/**
+ * Prepare to publish snapshots under the given shared memory name. The region itself is created
+ * by the first call to publishSharedSnapshot, once its required size is known.
+ * @param name Name of the shared memory object, e.g. SHARED_SNAPSHOT_NAME
+ * @return If successful, a dynamically-allocated publisher. NULL otherwise.
+ */
+SharedSnapshotPublisher *createSharedSnapshotPublisher(const char *name)
+{
+    SharedSnapshotPublisher *publisher = (SharedSnapshotPublisher *)malloc(sizeof(SharedSnapshotPublisher));
+    if (publisher == NULL)
+        return NULL;
+    snprintf(publisher->name, sizeof(publisher->name), "%s", name);
+    publisher->header = NULL;
+    publisher->mappedSize = 0;
+    return publisher;
+}
+
+/**
+ * Mark a region left behind by an earlier publisher as retired, so that its readers move to the new one.
+ * @param name Name of the shared memory object
+ */
+static void retireStaleRegion(const char *name)
+{
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0)
+        return;
+    struct stat stats;
+    if (fstat(fd, &stats) == 0 && (size_t)stats.st_size >= sizeof(SharedSnapshotHeader))
+    {
+        SharedSnapshotHeader *header = (SharedSnapshotHeader *)mmap(NULL, sizeof(SharedSnapshotHeader), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (header != MAP_FAILED)
+        {
+            if (header->magic == SHARED_SNAPSHOT_MAGIC)
+                atomic_store_explicit(&header->retired, 1, memory_order_release);
+            munmap(header, sizeof(SharedSnapshotHeader));
+        }
+    }
+    close(fd);
+}
+
+/**
+ * Replace the shared region with a new one large enough for the given snapshot. Readers of the
+ * old region are told to reopen it through the retired flag.
+ * @param publisher Publisher to resize
+ * @param rowsNeeded Number of rows of the snapshot about to be published
+ * @param stringsNeeded Number of string bytes of the snapshot about to be published
+ * @return 0 if operation was successful, nonzero otherwise
+ */
+static int createSharedRegion(SharedSnapshotPublisher *publisher, unsigned long rowsNeeded, unsigned long stringsNeeded)
+{
+    // leave room for the snapshot to double before the region has to be replaced again
+    unsigned long rowCapacity = rowsNeeded * 2 > SHARED_MIN_ROW_CAPACITY ? rowsNeeded * 2 : SHARED_MIN_ROW_CAPACITY;
+    unsigned long stringCapacity = stringsNeeded * 2 > SHARED_MIN_STRING_CAPACITY ? stringsNeeded * 2 : SHARED_MIN_STRING_CAPACITY;
+    unsigned long bufferSize = sizeof(SharedBuffer) + rowCapacity * sizeof(SharedRow) + stringCapacity;
+    // keep every buffer aligned for its atomic sequence number
+    bufferSize = (bufferSize + 63) & ~63ul;
+    size_t regionSize = sizeof(SharedSnapshotHeader) + SHARED_SNAPSHOT_BUFFER_COUNT * bufferSize;
+
+    if (publisher->header != NULL)
+    {
+        atomic_store_explicit(&publisher->header->retired, 1, memory_order_release);
+        munmap(publisher->header, publisher->mappedSize);
+        publisher->header = NULL;
+    }
+    else
+    {
+        retireStaleRegion(publisher->name);
+    }
+
+    // readers still mapping the old object keep it alive until they reopen
+    shm_unlink(publisher->name);
+    int fd = shm_open(publisher->name, O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0)
+    {
+        perror("Error creating shared snapshot");
+        return -1;
+    }
+    if (ftruncate(fd, regionSize) != 0)
+    {
+        perror("Error sizing shared snapshot");
+        close(fd);
+        shm_unlink(publisher->name);
+        return -1;
+    }
+    void *region = mmap(NULL, regionSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (region == MAP_FAILED)
+    {
+        perror("Error mapping shared snapshot");
+        shm_unlink(publisher->name);
+        return -1;
+    }
+
+    // the new object is zero-filled, so every buffer starts with an even sequence number
+    SharedSnapshotHeader *header = (SharedSnapshotHeader *)region;
+    header->rowCapacity = rowCapacity;
+    header->stringCapacity = stringCapacity;
+    header->bufferSize = bufferSize;
+    header->version = SHARED_SNAPSHOT_VERSION;
+    atomic_store_explicit(&header->active, 0, memory_order_relaxed);
+    atomic_store_explicit(&header->retired, 0, memory_order_relaxed);
+    atomic_store_explicit(&header->generation, 0, memory_order_relaxed);
+    // readers check the magic number last, so it is written once everything else is in place
+    atomic_thread_fence(memory_order_release);
+    header->magic = SHARED_SNAPSHOT_MAGIC;
+
+    publisher->header = header;
+    publisher->mappedSize = regionSize;
+    return 0;
+}
+
+/**
+ * Publish a finished snapshot. It is written into the buffer readers are not using, and
+ * becomes visible to readers at once when the active buffer index is switched.
+ * @param publisher Publisher to write with
+ * @param processes An array of all processes, with file descriptors read
+ * @param numProcesses The size of the processes array.
+ * @return 0 if operation was successful, nonzero otherwise
+ */
+int publishSharedSnapshot(SharedSnapshotPublisher *publisher, ProcessData **processes, int numProcesses)
+{
+    unsigned long rowsNeeded = 0;
+    unsigned long stringsNeeded = 0;
+    for (int i = 0; i < numProcesses; i++)
+    {
+        rowsNeeded += processes[i]->size;
+        for (unsigned long j = 0; j < processes[i]->size; j++)
+        {
+            FileDescriptorEntry *entry = processes[i]->fileDescriptors[j];
+            stringsNeeded += (entry->filename != NULL ? strnlen(entry->filename, SYMBOLIC_LINK_BUFFER_SIZE) : 0) + 1;
+        }
+    }
+
+    SharedSnapshotHeader *header = publisher->header;
+    unsigned long generation = 1;
+    unsigned int index = 0;
+    if (header == NULL || rowsNeeded > header->rowCapacity || stringsNeeded > header->stringCapacity)
+    {
+        if (header != NULL)
+            generation = atomic_load_explicit(&header->generation, memory_order_relaxed) + 1;
+        if (createSharedRegion(publisher, rowsNeeded, stringsNeeded) != 0)
+            return -1;
+        header = publisher->header;
+    }
+    else
+    {
+        generation = atomic_load_explicit(&header->generation, memory_order_relaxed) + 1;
+        index = atomic_load_explicit(&header->active, memory_order_relaxed) ^ 1;
+    }
+
+    SharedBuffer *buffer = sharedBufferAt(header, index);
+    SharedRow *rows = sharedRowsOf(buffer);
+    char *strings = sharedStringsOf(header, buffer);
+
+    // mark the buffer as being written, so that a reader still copying it from two generations ago retries
+    unsigned long sequence = atomic_load_explicit(&buffer->sequence, memory_order_relaxed);
+    atomic_store_explicit(&buffer->sequence, sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    unsigned long row = 0;
+    unsigned long stringBytes = 0;
+    for (int i = 0; i < numProcesses; i++)
+    {
+        for (unsigned long j = 0; j < processes[i]->size; j++)
+        {
+            FileDescriptorEntry *entry = processes[i]->fileDescriptors[j];
+            size_t length = entry->filename != NULL ? strnlen(entry->filename, SYMBOLIC_LINK_BUFFER_SIZE) : 0;
+            rows[row].pid = processes[i]->pid;
+            rows[row].fd = entry->fd;
+            rows[row].inode = entry->inode;
+            rows[row].filenameOffset = stringBytes;
+            rows[row].filenameLength = length;
+            rows[row].type = entry->type;
+            rows[row].reserved = 0;
+            memcpy(strings + stringBytes, entry->filename != NULL ? entry->filename : "", length);
+            strings[stringBytes + length] = '\0';
+            stringBytes += length + 1;
+            row++;
+        }
+    }
+    buffer->generation = generation;
+    buffer->numProcesses = numProcesses;
+    buffer->numRows = row;
+    buffer->stringBytes = stringBytes;
+
+    atomic_store_explicit(&buffer->sequence, sequence + 2, memory_order_release);
+    atomic_store_explicit(&header->active, index, memory_order_release);
+    atomic_store_explicit(&header->generation, generation, memory_order_release);
+    return 0;
+}
+
+/**
+ * Stop publishing.
+ * @param publisher Publisher to close
+ * @param unlink If nonzero, remove the shared memory object so that new readers can no longer open it
+ */
+void closeSharedSnapshotPublisher(SharedSnapshotPublisher *publisher, int unlink)
+{
+    if (publisher == NULL)
+        return;
+    if (publisher->header != NULL)
+    {
+        if (unlink)
+        {
+            atomic_store_explicit(&publisher->header->retired, 1, memory_order_release);
+            shm_unlink(publisher->name);
+        }
+        munmap(publisher->header, publisher->mappedSize);
+    }
+    free(publisher);
+}
+
+/**
+ * Map the current shared region read-only.
+ * @param reader Reader to map the region for
+ * @return 0 if operation was successful, nonzero otherwise
+ */
+static int mapSharedRegion(SharedSnapshotReader *reader)
+{
+    int fd = shm_open(reader->name, O_RDONLY, 0);
+    if (fd < 0)
+        return -1;
+    struct stat stats;
+    if (fstat(fd, &stats) != 0 || (size_t)stats.st_size < sizeof(SharedSnapshotHeader))
+    {
+        close(fd);
+        return -1;
+    }
+    void *region = mmap(NULL, stats.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (region == MAP_FAILED)
+        return -1;
+    const SharedSnapshotHeader *header = (const SharedSnapshotHeader *)region;
+    unsigned int magic = header->magic;
+    atomic_thread_fence(memory_order_acquire);
+    if (magic != SHARED_SNAPSHOT_MAGIC || header->version != SHARED_SNAPSHOT_VERSION ||
+        sizeof(SharedSnapshotHeader) + SHARED_SNAPSHOT_BUFFER_COUNT * header->bufferSize > (size_t)stats.st_size)
+    {
+        munmap(region, stats.st_size);
+        return -1;
+    }
+    reader->header = header;
+    reader->mappedSize = stats.st_size;
+    return 0;
+}
+
+/**
+ * Map the region that replaced a retired one. The publisher unlinks the old region before it
+ * creates the new one and writes its magic number last, so mapping fails for a short while;
+ * it is retried with exponential back-off, for about 100 ms in total.
+ * @param reader Reader whose region was retired and unmapped
+ * @return 0 if operation was successful, nonzero if no new region appeared
+ */
+static int remapSharedRegion(SharedSnapshotReader *reader)
+{
+    long pauseNs = SHARED_REMAP_FIRST_PAUSE_NS;
+    for (int attempt = 0; attempt < SHARED_REMAP_ATTEMPTS; attempt++)
+    {
+        if (mapSharedRegion(reader) == 0)
+            return 0;
+        struct timespec pause = {pauseNs / 1000000000L, pauseNs % 1000000000L};
+        nanosleep(&pause, NULL);
+        pauseNs *= 2;
+    }
+    return mapSharedRegion(reader);
+}
+
+/**
+ * Open a shared snapshot for reading.
+ * @param name Name of the shared memory object, e.g. SHARED_SNAPSHOT_NAME
+ * @return If successful, a dynamically-allocated reader. NULL otherwise.
+ */
+SharedSnapshotReader *openSharedSnapshot(const char *name)
+{
+    SharedSnapshotReader *reader = (SharedSnapshotReader *)malloc(sizeof(SharedSnapshotReader));
+    if (reader == NULL)
+        return NULL;
+    snprintf(reader->name, sizeof(reader->name), "%s", name);
+    reader->header = NULL;
+    reader->mappedSize = 0;
+    if (mapSharedRegion(reader) != 0)
+    {
+        free(reader);
+        return NULL;
+    }
+    return reader;
+}
+
+/**
+ * Grow the arrays of a snapshot copy so that they can hold the given number of rows and string bytes.
+ * @param snapshot Copy to grow
+ * @param rows Number of rows needed
+ * @param stringBytes Number of string bytes needed
+ * @return 0 if operation was successful, nonzero otherwise
+ */
+static int reserveSharedSnapshot(SharedSnapshot *snapshot, unsigned long rows, unsigned long stringBytes)
+{
+    if (rows > snapshot->rowCapacity)
+    {
+        SharedRow *grown = (SharedRow *)realloc(snapshot->rows, rows * sizeof(SharedRow));
+        if (grown == NULL)
+            return -1;
+        snapshot->rows = grown;
+        snapshot->rowCapacity = rows;
+    }
+    if (stringBytes > snapshot->stringCapacity)
+    {
+        char *grown = (char *)realloc(snapshot->strings, stringBytes);
+        if (grown == NULL)
+            return -1;
+        snapshot->strings = grown;
+        snapshot->stringCapacity = stringBytes;
+    }
+    return 0;
+}
+
+/**
+ * Copy the latest complete snapshot. No locks are taken and, once the arrays of the copy are large
+ * enough, no system calls are made: the copy is retried if the publisher overwrote the buffer meanwhile.
+ * @param reader Reader to copy from
+ * @param snapshot Copy to fill in. Must be zero-initialized before the first call; its arrays are reused.
+ * @return 0 if operation was successful, 1 if nothing was published yet, -1 otherwise, e.g. if the
+ * publisher stopped. The reader can be read from again after a failure.
+ */
+int readSharedSnapshot(SharedSnapshotReader *reader, SharedSnapshot *snapshot)
+{
+    while (1)
+    {
+        const SharedSnapshotHeader *header = reader->header;
+        if (header != NULL && atomic_load_explicit(&((SharedSnapshotHeader *)header)->retired, memory_order_acquire))
+        {
+            // the publisher moved to a larger region, or stopped
+            munmap((void *)header, reader->mappedSize);
+            reader->header = NULL;
+            header = NULL;
+        }
+        // also left unmapped by an earlier read that found no new region
+        if (header == NULL)
+        {
+            if (remapSharedRegion(reader) != 0)
+                return -1;
+            continue;
+        }
+        if (atomic_load_explicit(&((SharedSnapshotHeader *)header)->generation, memory_order_acquire) == 0)
+            return 1;
+
+        unsigned int index = atomic_load_explicit(&((SharedSnapshotHeader *)header)->active, memory_order_acquire);
+        SharedBuffer *buffer = sharedBufferAt(header, index & 1);
+        unsigned long sequence = atomic_load_explicit(&buffer->sequence, memory_order_acquire);
+        if (sequence & 1)
+            continue;
+
+        unsigned long numRows = buffer->numRows;
+        unsigned long stringBytes = buffer->stringBytes;
+        snapshot->generation = buffer->generation;
+        snapshot->numProcesses = buffer->numProcesses;
+        // counts read while the buffer is rewritten may be garbage, they are only trusted once validated
+        if (numRows > header->rowCapacity || stringBytes > header->stringCapacity)
+            continue;
+        if (reserveSharedSnapshot(snapshot, numRows, stringBytes) != 0)
+            return -1;
+        memcpy(snapshot->rows, sharedRowsOf(buffer), numRows * sizeof(SharedRow));
+        memcpy(snapshot->strings, sharedStringsOf(header, buffer), stringBytes);
+        snapshot->numRows = numRows;
+
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&buffer->sequence, memory_order_relaxed) == sequence)
+            return 0;
+    }
+}
+
+/**
+ * Unmap a shared snapshot and free the reader.
+ * @param reader Reader to close
+ */
+void closeSharedSnapshot(SharedSnapshotReader *reader)
+{
+    if (reader == NULL)
+        return;
+    if (reader->header != NULL)
+        munmap((void *)reader->header, reader->mappedSize);
+    free(reader);
+}
+
+/**
+ * Free the arrays of a snapshot copy.
+ * @param snapshot Copy to free
+ */
+void freeSharedSnapshot(SharedSnapshot *snapshot)
+{
+    free(snapshot->rows);
+    free(snapshot->strings);
+    memset(snapshot, 0, sizeof(SharedSnapshot));
+}
+
+/**
+ * Convert a snapshot copy into process data, grouping consecutive rows by PID. Processes without
+ * any file descriptor have no rows, and are therefore not included.
+ * @param snapshot Copy to convert
+ * @param numProcesses Pointer to int which will store the number of processes put in the return array.
+ * @return If successful, a dynamically-allocated array of processes that can be freed with freeProcesses. NULL otherwise.
+ */
+ProcessData **sharedSnapshotToProcesses(SharedSnapshot *snapshot, int *numProcesses)
+{
+    *numProcesses = 0;
+    ProcessData **processes = (ProcessData **)malloc(sizeof(ProcessData *) * (snapshot->numProcesses + 1));
+    if (processes == NULL)
+        return NULL;
+    int failed = 0;
+    for (unsigned long row = 0; row < snapshot->numRows && !failed;)
+    {
+        unsigned long end = row;
+        while (end < snapshot->numRows && snapshot->rows[end].pid == snapshot->rows[row].pid)
+            end++;
+        ProcessData *process = (ProcessData *)malloc(sizeof(ProcessData));
+        if (process == NULL)
+        {
+            failed = 1;
+            break;
+        }
+        process->pid = snapshot->rows[row].pid;
+        process->inode = 0;
+        process->size = 0;
+        process->cgroup = NULL;
+        process->netNamespace = 0;
+        process->sizeHint = 0;
+        process->fileDescriptors = (FileDescriptorEntry **)malloc(sizeof(FileDescriptorEntry *) * (end - row));
+        processes[(*numProcesses)++] = process;
+        failed = process->fileDescriptors == NULL;
+        for (; row < end && !failed; row++)
+        {
+            FileDescriptorEntry *entry = (FileDescriptorEntry *)malloc(sizeof(FileDescriptorEntry));
+            if (entry == NULL)
+            {
+                failed = 1;
+                break;
+            }
+            entry->fd = snapshot->rows[row].fd;
+            entry->inode = snapshot->rows[row].inode;
+            entry->dev = 0;
+            entry->type = (FileDescriptorType)snapshot->rows[row].type;
+            entry->socket = NULL;
+            entry->filename = strndup(snapshot->strings + snapshot->rows[row].filenameOffset, snapshot->rows[row].filenameLength);
+            process->fileDescriptors[process->size++] = entry;
+            failed = entry->filename == NULL;
+        }
+        // a snapshot holding more distinct runs of PIDs than processes is malformed
+        if (*numProcesses > snapshot->numProcesses)
+        {
+            failed = 1;
+            break;
+        }
+    }
+    // a partial table would not match the snapshot, so none is returned
+    if (failed)
+    {
+        freeProcesses(processes, *numProcesses);
+        *numProcesses = 0;
+        return NULL;
+    }
+    return processes;
+}
@@ -0,0 +1,132 @@
+#ifndef SHARED_SNAPSHOT_H
+#define SHARED_SNAPSHOT_H
+
+#include <stddef.h>
+#include <stdatomic.h>
+
+#include "processes.h"
+
+#define SHARED_SNAPSHOT_NAME "/tableViewer"
+#define SHARED_SNAPSHOT_MAGIC 0x54565353u
+#define SHARED_SNAPSHOT_VERSION 1u
+#define SHARED_SNAPSHOT_BUFFER_COUNT 2
+
+/**
+ * Fixed-width row of a shared snapshot. Filenames are stored in the string area of the
+ * buffer, so that rows never need to be truncated.
+ */
+typedef struct SharedRow
+{
+    unsigned long pid;
+    unsigned long fd;
+    unsigned long inode;
+    /**
+     * Offset of the filename from the start of the string area
+    */
+    unsigned int filenameOffset;
+    /**
+     * Length of the filename, without the null terminator
+    */
+    unsigned short filenameLength;
+    /**
+     * FileDescriptorType of the row
+    */
+    unsigned char type;
+    unsigned char reserved;
+} SharedRow;
+
+/**
+ * One of the two buffers of the shared region. A buffer is being written while its sequence
+ * number is odd.
+ */
+typedef struct SharedBuffer
+{
+    _Atomic unsigned long sequence;
+    /**
+     * Generation of the snapshot held in this buffer
+    */
+    unsigned long generation;
+    unsigned long numProcesses;
+    unsigned long numRows;
+    unsigned long stringBytes;
+} SharedBuffer;
+
+/**
+ * Start of the shared region. The two buffers follow it, each bufferSize bytes long, and each
+ * made of a SharedBuffer, rowCapacity SharedRows and stringCapacity bytes of filenames.
+ */
+typedef struct SharedSnapshotHeader
+{
+    unsigned int magic;
+    unsigned int version;
+    unsigned long rowCapacity;
+    unsigned long stringCapacity;
+    unsigned long bufferSize;
+    /**
+     * Index of the buffer holding the latest complete snapshot
+    */
+    _Atomic unsigned int active;
+    /**
+     * Set when the publisher replaced the region with a larger one; readers must reopen it
+    */
+    _Atomic unsigned int retired;
+    /**
+     * Generation of the latest complete snapshot, 0 if none was published yet
+    */
+    _Atomic unsigned long generation;
+} SharedSnapshotHeader;
+
+/**
+ * Writer side of a shared snapshot
+ */
+typedef struct SharedSnapshotPublisher
+{
+    char name[64];
+    SharedSnapshotHeader *header;
+    size_t mappedSize;
+} SharedSnapshotPublisher;
+
+/**
+ * Reader side of a shared snapshot, mapped read-only
+ */
+typedef struct SharedSnapshotReader
+{
+    char name[64];
+    const SharedSnapshotHeader *header;
+    size_t mappedSize;
+} SharedSnapshotReader;
+
+/**
+ * A consistent copy of a shared snapshot, owned by the reader
+ */
+typedef struct SharedSnapshot
+{
+    unsigned long generation;
+    unsigned long numProcesses;
+    unsigned long numRows;
+    SharedRow *rows;
+    char *strings;
+    /**
+     * Allocated lengths of rows and strings, reused across reads
+    */
+    unsigned long rowCapacity;
+    unsigned long stringCapacity;
+} SharedSnapshot;
+
+extern SharedSnapshotPublisher *createSharedSnapshotPublisher(const char *name);
+
+extern int publishSharedSnapshot(SharedSnapshotPublisher *publisher, ProcessData **processes, int numProcesses);
+
+extern void closeSharedSnapshotPublisher(SharedSnapshotPublisher *publisher, int unlink);
+
+extern SharedSnapshotReader *openSharedSnapshot(const char *name);
+
+extern int readSharedSnapshot(SharedSnapshotReader *reader, SharedSnapshot *snapshot);
+
+extern void closeSharedSnapshot(SharedSnapshotReader *reader);
+
+extern void freeSharedSnapshot(SharedSnapshot *snapshot);
+
+extern ProcessData **sharedSnapshotToProcesses(SharedSnapshot *snapshot, int *numProcesses);
+
+#endif
@@ -0,0 +1,201 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "processes.h"
+#include "columns.h"
+#include "printTables.h"
+#include "stringUtils.h"
+#include "readProcesses.h"
+#include "snapshotStream.h"
+
+// read each column of a row as written by print_columns_binary; index and PID are stored per process
+#define READ_ROW_NUMBER(value)
+#define READ_PROCESS_NUMBER(value)
+#define READ_NUMBER(value) ok &= fread(&(value), sizeof(unsigned long), 1, stream->file) == 1;
+#define READ_STRING(value) ok &= readString(stream->file, stream->filename) == 0; value = stream->filename;
+#define READ_TYPE(value)                                                         \
+    {                                                                            \
+        unsigned char type = FD_TYPE_OTHER;                                      \
+        ok &= fread(&type, sizeof(unsigned char), 1, stream->file) == 1;         \
+        value = type < FD_TYPE_COUNT ? (FileDescriptorType)type : FD_TYPE_OTHER; \
+    }
+// socket descriptions are only kept as text, the details are not restored
+#define READ_SOCKET(value)                                      \
+    {                                                           \
+        char description[SYMBOLIC_LINK_BUFFER_SIZE];            \
+        ok &= readString(stream->file, description) == 0;      \
+        value = NULL;                                           \
+    }
+#define READ_COLUMN(name, header, kind, value) if (stream->columns & COLUMN_MASK(name)) { READ_##kind(value) }
+
+/**
+ * Read a string stored as its length followed by its bytes.
+ * @param file File to read from
+ * @param string Buffer of size SYMBOLIC_LINK_BUFFER_SIZE to store the null-terminated string in
+ * @return 0 if operation was successful, -1 otherwise
+ */
+static int readString(FILE *file, char *string)
+{
+    size_t length;
+    string[0] = '\0';
+    if (fread(&length, sizeof(size_t), 1, file) != 1 || length >= SYMBOLIC_LINK_BUFFER_SIZE)
+        return -1;
+    if (fread(string, sizeof(char), length, file) != length)
+        return -1;
+    string[length] = '\0';
+    return 0;
+}
+
+/**
+ * Open a binary table and read its header.
+ * @param stream Stream to initialize
+ * @param fileName Name of the file to read
+ * @return 0 if operation was successful, -1 if the file could not be opened or is not a binary table
+ */
+int openSnapshotStream(SnapshotStream *stream, const char *fileName)
+{
+    stream->file = fopen(fileName, "rb");
+    stream->remaining = 0;
+    if (stream->file == NULL)
+        return -1;
+    setvbuf(stream->file, NULL, _IOFBF, SNAPSHOT_STREAM_BUFFER_SIZE);
+    memset(stream->byType, 0, sizeof(stream->byType));
+    unsigned int fileHeader[3];
+    if (fread(fileHeader, sizeof(unsigned int), 2, stream->file) != 2 || (fileHeader[0] != BINARY_MAGIC && fileHeader[0] != BINARY_MAGIC_V1))
+    {
+        fclose(stream->file);
+        stream->file = NULL;
+        return -1;
+    }
+    stream->columns = fileHeader[1];
+    if (fileHeader[0] == BINARY_MAGIC_V1)
+        return 0;
+    int ok = fread(&fileHeader[2], sizeof(unsigned int), 1, stream->file) == 1;
+    for (unsigned int type = 0; ok && type < fileHeader[2]; type++)
+    {
+        unsigned long count;
+        ok = fread(&count, sizeof(unsigned long), 1, stream->file) == 1;
+        stream->byType[type < FD_TYPE_COUNT ? type : FD_TYPE_OTHER] += count;
+    }
+    if (!ok)
+    {
+        fclose(stream->file);
+        stream->file = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Read the header of the next process. Rows of the previous process must all have been read.
+ * @param stream Stream to read from
+ * @param process Process to assign the PID, inode and number of file descriptors to
+ * @return 1 if a process was read, 0 at the end of the file, -1 if the file is truncated
+ */
+int readSnapshotProcess(SnapshotStream *stream, ProcessData *process)
+{
+    if (fread(&process->pid, sizeof(unsigned long), 1, stream->file) != 1)
+        return feof(stream->file) ? 0 : -1;
+    if (fread(&process->inode, sizeof(unsigned long), 1, stream->file) != 1 ||
+        fread(&process->size, sizeof(unsigned long), 1, stream->file) != 1) // number of fds
+        return -1;
+    stream->remaining = process->size;
+    process->cgroup = NULL;
+    process->netNamespace = 0;
+    process->sizeHint = 0;
+    return 1;
+}
+
+/**
+ * Read the next row of the current process. Columns that are not stored are left empty, and the
+ * type is derived from the filename if it is not stored.
+ * @param stream Stream to read from
+ * @param entry Row to assign the columns to. Its filename points into the stream, and is only
+ * valid until the next row is read.
+ * @return 1 if a row was read, 0 if the current process has no more rows, -1 if the file is truncated
+ */
+int readSnapshotRow(SnapshotStream *stream, FileDescriptorEntry *entry)
+{
+    if (stream->remaining == 0)
+        return 0;
+    stream->remaining--;
+    memset(entry, 0, sizeof(FileDescriptorEntry));
+    stream->filename[0] = '\0';
+    int ok = 1;
+    TABLE_COLUMNS(READ_COLUMN)
+    if (!(stream->columns & COLUMN_MASK(type)))
+        entry->type = classifyFilename(entry->filename);
+    return ok ? 1 : -1;
+}
+
+/**
+ * Read every process of a binary table into memory, with a copy of each of its rows.
+ * @param stream Stream positioned before the header of the first process
+ * @param numProcessesFound A pointer to an int that will store the number of processes read
+ * @return Returns pointer to a dynamically allocated array of processes, to free with freeProcesses.
+ * Returns NULL if the file is truncated or memory could not be allocated.
+ */
+ProcessData **readSnapshotProcesses(SnapshotStream *stream, int *numProcessesFound)
+{
+    *numProcessesFound = 0;
+    size_t capacity = MAX_PROCESS_COUNT;
+    ProcessData **processes = (ProcessData **)malloc(sizeof(ProcessData *) * capacity);
+    if (processes == NULL)
+        return NULL;
+    ProcessData header;
+    int found;
+    int ok = 1;
+    while (ok && (found = readSnapshotProcess(stream, &header)) > 0)
+    {
+        if (*numProcessesFound == capacity)
+        {
+            capacity *= 2;
+            ProcessData **grown = (ProcessData **)realloc(processes, sizeof(ProcessData *) * capacity);
+            if (grown == NULL)
+                break;
+            processes = grown;
+        }
+        ProcessData *process = (ProcessData *)malloc(sizeof(ProcessData));
+        if (process == NULL)
+            break;
+        *process = header;
+        process->size = 0;
+        process->fileDescriptors = (FileDescriptorEntry **)malloc(sizeof(FileDescriptorEntry *) * (header.size > 0 ? header.size : 1));
+        processes[(*numProcessesFound)++] = process;
+        if (process->fileDescriptors == NULL)
+            break;
+        FileDescriptorEntry entry;
+        int read;
+        while ((read = readSnapshotRow(stream, &entry)) > 0)
+        {
+            FileDescriptorEntry *copy = (FileDescriptorEntry *)malloc(sizeof(FileDescriptorEntry));
+            if (copy == NULL)
+                break;
+            *copy = entry;
+            // tables saved without the filename column have no filename to copy
+            copy->filename = entry.filename != NULL ? strdup(entry.filename) : NULL;
+            process->fileDescriptors[process->size++] = copy;
+            if (entry.filename != NULL && copy->filename == NULL)
+                break;
+        }
+        ok = read == 0;
+    }
+    if (!ok || found != 0)
+    {
+        freeProcesses(processes, *numProcessesFound);
+        *numProcessesFound = 0;
+        return NULL;
+    }
+    return processes;
+}
+
+/**
+ * Close a binary table.
+ * @param stream Stream to close
+ */
+void closeSnapshotStream(SnapshotStream *stream)
+{
+    if (stream->file != NULL)
+        fclose(stream->file);
+    stream->file = NULL;
+}
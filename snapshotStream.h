@@ -0,0 +1,45 @@
+#ifndef SNAPSHOT_STREAM_H
+#define SNAPSHOT_STREAM_H
+
+#include <stdio.h>
+#include "processes.h"
+
+#define SNAPSHOT_STREAM_BUFFER_SIZE (1 << 16)
+
+/**
+ * Reader of a binary table written by print_columns_binary, one process or row at a time, so that
+ * files of any size are read in constant memory.
+ */
+typedef struct SnapshotStream
+{
+    FILE *file;
+    /**
+     * Mask of the columns stored in the file, as defined in columns.h
+    */
+    unsigned int columns;
+    /**
+     * Number of file descriptors of each type stored in the header, all 0 in files written before
+     * types were counted. Types that this version does not know are counted as FD_TYPE_OTHER.
+    */
+    unsigned long byType[FD_TYPE_COUNT];
+    /**
+     * Rows of the current process not read yet
+    */
+    unsigned long remaining;
+    /**
+     * Filename of the last row read
+    */
+    char filename[SYMBOLIC_LINK_BUFFER_SIZE];
+} SnapshotStream;
+
+extern int openSnapshotStream(SnapshotStream *stream, const char *fileName);
+
+extern int readSnapshotProcess(SnapshotStream *stream, ProcessData *process);
+
+extern int readSnapshotRow(SnapshotStream *stream, FileDescriptorEntry *entry);
+
+extern ProcessData **readSnapshotProcesses(SnapshotStream *stream, int *numProcessesFound);
+
+extern void closeSnapshotStream(SnapshotStream *stream);
+
+#endif
@@ -0,0 +1,132 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <sched.h>
+#include <time.h>
+
+#include "spscQueue.h"
+
+// waits below SPIN_WAITS retry at once, then up to YIELD_WAITS give up the CPU, then sleep
+#define SPIN_WAITS 64
+#define YIELD_WAITS 128
+#define SLEEP_NANOSECONDS 50000
+
+/**
+ * Allocate an empty queue.
+ * @param capacity Minimum number of items the queue can hold, rounded up to a power of two
+ * @return If successful, a dynamically-allocated queue. NULL otherwise.
+ */
+SpscQueue *createSpscQueue(size_t capacity)
+{
+    size_t rounded = 1;
+    while (rounded < capacity)
+        rounded <<= 1;
+    SpscQueue *queue = (SpscQueue *)aligned_alloc(CACHE_LINE_SIZE, sizeof(SpscQueue));
+    if (queue == NULL)
+        return NULL;
+    queue->slots = (void **)calloc(rounded, sizeof(void *));
+    if (queue->slots == NULL)
+    {
+        free(queue);
+        return NULL;
+    }
+    queue->capacity = rounded;
+    atomic_init(&queue->head, 0);
+    atomic_init(&queue->tail, 0);
+    return queue;
+}
+
+/**
+ * Free memory used to store a queue. Items still in the queue are not freed.
+ * @param queue Queue to free
+ */
+void freeSpscQueue(SpscQueue *queue)
+{
+    if (queue == NULL)
+        return;
+    free(queue->slots);
+    free(queue);
+}
+
+/**
+ * Push an item if the queue is not full. Must only be called by the producer.
+ * @param queue Queue to push to
+ * @param item Item to push
+ * @return true if the item was pushed, false if the queue is full
+ */
+bool trySpscPush(SpscQueue *queue, void *item)
+{
+    size_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    if (tail - atomic_load_explicit(&queue->head, memory_order_acquire) == queue->capacity)
+        return false;
+    queue->slots[tail & (queue->capacity - 1)] = item;
+    atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+/**
+ * Pop an item if the queue is not empty. Must only be called by the consumer.
+ * @param queue Queue to pop from
+ * @param item Pointer to where the item will be assigned to
+ * @return true if an item was popped, false if the queue is empty
+ */
+bool trySpscPop(SpscQueue *queue, void **item)
+{
+    size_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    if (atomic_load_explicit(&queue->tail, memory_order_acquire) == head)
+        return false;
+    *item = queue->slots[head & (queue->capacity - 1)];
+    atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+    return true;
+}
+
+/**
+ * Back off after an unsuccessful attempt: spin at first, then yield, then sleep, so that a
+ * stage waiting on a slow neighbour stops competing with it for the CPU.
+ * @param attempt Number of unsuccessful attempts so far
+ */
+static void backOff(unsigned long attempt)
+{
+    if (attempt < SPIN_WAITS)
+        return;
+    if (attempt < YIELD_WAITS)
+    {
+        sched_yield();
+        return;
+    }
+    struct timespec pause = {0, SLEEP_NANOSECONDS};
+    nanosleep(&pause, NULL);
+}
+
+/**
+ * Push an item, waiting while the queue is full. Must only be called by the producer.
+ * @param queue Queue to push to
+ * @param item Item to push
+ * @param waits If not NULL, the number of unsuccessful attempts is added to it
+ */
+void spscPush(SpscQueue *queue, void *item, unsigned long *waits)
+{
+    unsigned long attempt = 0;
+    while (!trySpscPush(queue, item))
+        backOff(attempt++);
+    if (waits != NULL)
+        *waits += attempt;
+}
+
+/**
+ * Pop an item, waiting while the queue is empty. Must only be called by the consumer.
+ * @param queue Queue to pop from
+ * @param waits If not NULL, the number of unsuccessful attempts is added to it
+ * @return The item popped
+ */
+void *spscPop(SpscQueue *queue, unsigned long *waits)
+{
+    void *item;
+    unsigned long attempt = 0;
+    while (!trySpscPop(queue, &item))
+        backOff(attempt++);
+    if (waits != NULL)
+        *waits += attempt;
+    return item;
+}
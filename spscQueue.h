@@ -0,0 +1,44 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#define CACHE_LINE_SIZE 64
+
+/**
+ * Bounded queue of pointers between exactly one producer thread and one consumer thread. Neither
+ * side takes a lock: each index is only written by its own side, and published with release
+ * ordering so that the other side sees the slot contents before the index.
+ */
+typedef struct SpscQueue
+{
+    /**
+     * Number of items popped so far, written by the consumer only
+    */
+    _Alignas(CACHE_LINE_SIZE) _Atomic size_t head;
+    /**
+     * Number of items pushed so far, written by the producer only
+    */
+    _Alignas(CACHE_LINE_SIZE) _Atomic size_t tail;
+    /**
+     * Number of slots, a power of two
+    */
+    _Alignas(CACHE_LINE_SIZE) size_t capacity;
+    void **slots;
+} SpscQueue;
+
+extern SpscQueue *createSpscQueue(size_t capacity);
+
+extern void freeSpscQueue(SpscQueue *queue);
+
+extern bool trySpscPush(SpscQueue *queue, void *item);
+
+extern bool trySpscPop(SpscQueue *queue, void **item);
+
+extern void spscPush(SpscQueue *queue, void *item, unsigned long *waits);
+
+extern void *spscPop(SpscQueue *queue, unsigned long *waits);
+
+#endif
@@ -3,6 +3,7 @@
 #include <stdio.h>
 #include <string.h>
 #include "processes.h"
+#include "stringUtils.h"
 
 /**
  * Print a standardized error to stderr to indicate to the user that the command arguments are incorrect.
@@ -67,3 +68,137 @@ int parseNumericalArgument(long *result, char *argv)
     *result = atol(splitToken);
     return 0;
 }
+
+
+// check the start or end of a link against a string literal, whose length is known at compile time
+#define LINK_STARTS_WITH(link, length, literal) ((length) >= sizeof(literal) - 1 && memcmp((link), (literal), sizeof(literal) - 1) == 0)
+#define LINK_ENDS_WITH(link, length, literal) ((length) >= sizeof(literal) - 1 && memcmp((link) + (length) - (sizeof(literal) - 1), (literal), sizeof(literal) - 1) == 0)
+
+/**
+ * Determine the kind of an anon_inode file descriptor from the name after "anon_inode:".
+ * @param name Name of the anonymous inode, e.g. "[eventfd]"
+ * @param length Length of the name
+ * @return The type of the file descriptor
+ */
+static FileDescriptorType classifyAnonInode(const char *name, size_t length)
+{
+    if (LINK_STARTS_WITH(name, length, "[eventfd]"))
+        return FD_TYPE_EVENTFD;
+    if (LINK_STARTS_WITH(name, length, "[eventpoll]"))
+        return FD_TYPE_EVENTPOLL;
+    if (LINK_STARTS_WITH(name, length, "[timerfd]"))
+        return FD_TYPE_TIMERFD;
+    if (LINK_STARTS_WITH(name, length, "[signalfd]"))
+        return FD_TYPE_SIGNALFD;
+    if (LINK_STARTS_WITH(name, length, "inotify"))
+        return FD_TYPE_INOTIFY;
+    return FD_TYPE_ANON_INODE;
+}
+
+/**
+ * Determine the kind of a file descriptor from the target of its /proc/<pid>/fd/<fd> link, in one
+ * pass: the first character selects the only prefixes that can match.
+ * @param link Target of the link, e.g. "socket:[123]" or "/dev/null"
+ * @param length Length of the target, as returned by readlink
+ * @return The type of the file descriptor
+ */
+FileDescriptorType classifyLink(const char *link, size_t length)
+{
+    if (length == 0)
+        return FD_TYPE_OTHER;
+    switch (link[0])
+    {
+    case '/':
+        // memfd targets also end with " (deleted)", as they have no name in any directory
+        if (LINK_STARTS_WITH(link, length, MEMFD_TOKEN))
+            return FD_TYPE_MEMFD;
+        if (LINK_ENDS_WITH(link, length, DELETED_SUFFIX))
+            return FD_TYPE_DELETED;
+        if (LINK_STARTS_WITH(link, length, DEVICE_TOKEN) && !LINK_STARTS_WITH(link, length, SHARED_MEMORY_TOKEN))
+            return FD_TYPE_DEVICE;
+        return FD_TYPE_FILE;
+    case 's':
+        return LINK_STARTS_WITH(link, length, SOCKET_TOKEN) ? FD_TYPE_SOCKET : FD_TYPE_OTHER;
+    case 'p':
+        return LINK_STARTS_WITH(link, length, PIPE_TOKEN) ? FD_TYPE_PIPE : FD_TYPE_OTHER;
+    case 'a':
+        if (LINK_STARTS_WITH(link, length, ANON_INODE_TOKEN))
+            return classifyAnonInode(link + strlen(ANON_INODE_TOKEN), length - strlen(ANON_INODE_TOKEN));
+        return FD_TYPE_OTHER;
+    default:
+        return FD_TYPE_OTHER;
+    }
+}
+
+/**
+ * Determine the kind of a file descriptor from the target of its /proc/<pid>/fd/<fd> link.
+ * @param filename Target of the link, e.g. "socket:[123]" or "/dev/null"
+ * @return The type of the file descriptor
+ */
+FileDescriptorType classifyFilename(const char *filename)
+{
+    if (filename == NULL)
+        return FD_TYPE_OTHER;
+    return classifyLink(filename, strlen(filename));
+}
+
+/**
+ * Names of file descriptor types, indexed by FileDescriptorType
+ */
+static const char *fileDescriptorTypeNames[FD_TYPE_COUNT] = {"file", "socket", "pipe", "other", "device", "deleted", "memfd",
+                                                              "anon_inode", "eventfd", "eventpoll", "timerfd", "signalfd", "inotify"};
+
+/**
+ * Get the name of a kind of file descriptor, as printed in the type column.
+ * @param type The type of a file descriptor
+ * @return Name of the type, e.g. "socket"
+ */
+const char *fileDescriptorTypeName(FileDescriptorType type)
+{
+    if (type >= FD_TYPE_COUNT)
+        return "other";
+    return fileDescriptorTypeNames[type];
+}
+
+/**
+ * List the names of all file descriptor types, as accepted by parseFileDescriptorTypes.
+ * @param buffer Buffer to write the list to, e.g. "file, socket, ... signalfd or inotify"
+ * @param size Size of the buffer, FD_TYPE_NAMES_SIZE fits every name
+ * @return buffer
+ */
+char *listFileDescriptorTypeNames(char *buffer, size_t size)
+{
+    size_t length = 0;
+    buffer[0] = '\0';
+    for (int type = 0; type < FD_TYPE_COUNT && length < size; type++)
+    {
+        const char *separator = type == 0 ? "" : type == FD_TYPE_COUNT - 1 ? " or " : ", ";
+        length += snprintf(buffer + length, size - length, "%s%s", separator, fileDescriptorTypeNames[type]);
+    }
+    return buffer;
+}
+
+/**
+ * Parse a comma-separated list of type names into a set of types.
+ * @param list List of type names, e.g. "socket,pipe"
+ * @param types Set to assign the bit of each type to, see FD_TYPE_MASK
+ * @return 0 if every name is a type, nonzero otherwise
+ */
+int parseFileDescriptorTypes(const char *list, unsigned int *types)
+{
+    *types = 0;
+    while (*list != '\0')
+    {
+        size_t length = strcspn(list, ",");
+        int type = 0;
+        while (type < FD_TYPE_COUNT && (strlen(fileDescriptorTypeNames[type]) != length || strncmp(list, fileDescriptorTypeNames[type], length) != 0))
+            type++;
+        if (type == FD_TYPE_COUNT)
+            return 1;
+        *types |= FD_TYPE_MASK(type);
+        list += length;
+        if (*list == ',')
+            list++;
+    }
+    return *types == 0;
+}
@@ -2,11 +2,17 @@
 #define STRING_UTILS_H
 
 #include <stdbool.h>
-
-#define SOCKET_TOKEN "socket:["
+#include <stddef.h>
+#include "processes.h"
 
 #define SOCKET_TOKEN "socket:["
 #define PIPE_TOKEN "pipe:["
+#define ANON_INODE_TOKEN "anon_inode:"
+#define MEMFD_TOKEN "/memfd:"
+#define DEVICE_TOKEN "/dev/"
+#define SHARED_MEMORY_TOKEN "/dev/shm/"
+#define DELETED_SUFFIX " (deleted)"
+#define FD_TYPE_NAMES_SIZE 256
 
 extern bool startsWith(const char *haystack, const char *needle);
 
@@ -14,4 +20,14 @@ extern bool isNumber(char *checkString);
 
 extern int parseNumericalArgument(long *result, char *argv); 
 
+extern FileDescriptorType classifyLink(const char *link, size_t length);
+
+extern FileDescriptorType classifyFilename(const char *filename);
+
+extern const char *fileDescriptorTypeName(FileDescriptorType type);
+
+extern char *listFileDescriptorTypeNames(char *buffer, size_t size);
+
+extern int parseFileDescriptorTypes(const char *list, unsigned int *types);
+
 #endif
\ No newline at end of file
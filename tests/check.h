@@ -0,0 +1,74 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/**
+ * Number of checks of the test program that failed
+ */
+static int checkFailures = 0;
+
+// report a failed check with its location, and carry on with the next one
+#define CHECK(condition)                                                                      \
+    do                                                                                        \
+    {                                                                                         \
+        if (!(condition))                                                                     \
+        {                                                                                     \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition);    \
+            checkFailures++;                                                                  \
+        }                                                                                     \
+    } while (0)
+
+#define CHECK_STRING(actual, expected)                                                                         \
+    do                                                                                                         \
+    {                                                                                                          \
+        const char *actualString = (actual);                                                                   \
+        const char *expectedString = (expected);                                                               \
+        if (actualString == NULL || strcmp(actualString, expectedString) != 0)                                 \
+        {                                                                                                      \
+            fprintf(stderr, "%s:%d: expected \"%s\", got \"%s\"\n", __FILE__, __LINE__, expectedString,         \
+                    actualString != NULL ? actualString : "(null)");                                           \
+            checkFailures++;                                                                                   \
+        }                                                                                                      \
+    } while (0)
+
+/**
+ * Send stderr to /dev/null, so that checks of rejected input do not print their errors.
+ * @return Duplicate of the original stderr, to pass to restoreStderr
+ */
+static inline int silenceStderr()
+{
+    fflush(stderr);
+    int saved = dup(STDERR_FILENO);
+    int null = open("/dev/null", O_WRONLY);
+    dup2(null, STDERR_FILENO);
+    close(null);
+    return saved;
+}
+
+/**
+ * Restore stderr after silenceStderr.
+ * @param saved Duplicate of the original stderr returned by silenceStderr
+ */
+static inline void restoreStderr(int saved)
+{
+    fflush(stderr);
+    dup2(saved, STDERR_FILENO);
+    close(saved);
+}
+
+/**
+ * Print whether all checks of a test program passed.
+ * @param name Name of the test program
+ * @return Exit status of the test program, 0 if all checks passed
+ */
+static inline int checkResult(const char *name)
+{
+    printf("%s: %s\n", name, checkFailures == 0 ? "passed" : "FAILED");
+    return checkFailures == 0 ? 0 : 1;
+}
+
+#endif
@@ -0,0 +1,183 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
+
+#include "../processes.h"
+#include "../readProcesses.h"
+#include "../fdHistory.h"
+#include "check.h"
+#include "fixture.h"
+
+// above the largest PID Linux hands out (4194304), so never a running process
+#define ABSENT_PID 100000000ul
+
+static const unsigned long fds[] = {0, 1, 2, 3, 4, 5, 6, 7};
+static const char *filenames[] = {"/dev/null", "/tmp/a", "/tmp/b", "socket:[1]", "/tmp/c", "/tmp/d", "socket:[2]", "/tmp/e"};
+
+/**
+ * Record one sample of the given processes, each with its own number of file descriptors.
+ * @param history History to record into
+ * @param pids Process identifiers
+ * @param sizes Number of file descriptors of each process, at most 8
+ * @param numProcesses Number of processes
+ */
+static void recordSample(FdHistory *history, const unsigned long *pids, const unsigned long *sizes, int numProcesses)
+{
+    ProcessData *processes[numProcesses > 0 ? numProcesses : 1];
+    for (int i = 0; i < numProcesses; i++)
+        processes[i] = makeProcess(pids[i], sizes[i], fds, filenames);
+    recordFdSample(history, processes, numProcesses);
+    for (int i = 0; i < numProcesses; i++)
+        freeProcess(processes[i]);
+}
+
+static void testStartTime()
+{
+    unsigned long own = readProcessStartTime(getpid());
+    CHECK(own > 0);
+    CHECK(readProcessStartTime(getpid()) == own);
+    CHECK(readProcessStartTime(ABSENT_PID) == 0);
+
+    // a child starts no earlier than its parent
+    pid_t child = fork();
+    if (child == 0)
+    {
+        pause();
+        _exit(0);
+    }
+    CHECK(child > 0);
+    if (child <= 0)
+        return;
+    CHECK(readProcessStartTime(child) >= own);
+    kill(child, SIGKILL);
+    waitpid(child, NULL, 0);
+    CHECK(readProcessStartTime(child) == 0);
+}
+
+static void testGrowth()
+{
+    FdHistory *history = createFdHistory();
+    CHECK(history != NULL);
+    if (history == NULL)
+        return;
+    unsigned long pids[] = {getpid(), ABSENT_PID};
+    for (unsigned long sample = 1; sample <= FD_TREND_MIN_SAMPLES + 1; sample++)
+    {
+        // the first process opens a file or a socket every sample, the second keeps 3
+        unsigned long sizes[] = {sample, 3};
+        recordSample(history, pids, sizes, 2);
+    }
+    CHECK(history->size == 2);
+    ProcessHistory *growing = findProcessHistory(history, getpid());
+    ProcessHistory *flat = findProcessHistory(history, ABSENT_PID);
+    CHECK(growing != NULL && flat != NULL);
+    if (growing == NULL || flat == NULL)
+        return;
+    CHECK(growing->startTime == readProcessStartTime(getpid()));
+    CHECK(flat->startTime == 0);
+    CHECK(growing->count == FD_TREND_MIN_SAMPLES + 1);
+    CHECK(isFdCountGrowing(growing));
+    CHECK(!isFdCountGrowing(flat));
+    CHECK(growing->trendByType[FD_TYPE_FILE] > 0);
+
+    char *output = NULL;
+    size_t length = 0;
+    FILE *stream = open_memstream(&output, &length);
+    printGrowingProcesses(history, stream);
+    fclose(stream);
+    char expected[64];
+    snprintf(expected, sizeof(expected), "\n%d (%d, ", getpid(), FD_TREND_MIN_SAMPLES + 1);
+    CHECK(strstr(output, expected) != NULL);
+    // growing types are named as in the type column
+    CHECK(strstr(output, ", file +") != NULL);
+    CHECK(strstr(output, "None!") == NULL);
+    free(output);
+    freeFdHistory(history);
+}
+
+static void testReusedPid()
+{
+    FdHistory *history = createFdHistory();
+    CHECK(history != NULL);
+    if (history == NULL)
+        return;
+    unsigned long pid = getpid();
+    unsigned long sizes[] = {2};
+    recordSample(history, &pid, sizes, 1);
+    recordSample(history, &pid, sizes, 1);
+    ProcessHistory *process = findProcessHistory(history, pid);
+    CHECK(process != NULL && process->count == 2);
+    if (process == NULL)
+        return;
+
+    // the same PID with another start time is another process, whose history starts over
+    process->startTime--;
+    recordSample(history, &pid, sizes, 1);
+    process = findProcessHistory(history, pid);
+    CHECK(process != NULL && process->count == 1 && process->recorded == 1);
+    CHECK(process != NULL && process->startTime == readProcessStartTime(pid));
+
+    // a start time that could not be read before is filled in without losing the samples
+    process->startTime = 0;
+    recordSample(history, &pid, sizes, 1);
+    process = findProcessHistory(history, pid);
+    CHECK(process != NULL && process->count == 2);
+    CHECK(process != NULL && process->startTime == readProcessStartTime(pid));
+    CHECK(history->size == 1);
+    freeFdHistory(history);
+}
+
+static void testEviction()
+{
+    FdHistory *history = createFdHistory();
+    CHECK(history != NULL);
+    if (history == NULL)
+        return;
+    // enough processes that probe runs overlap, none running so no start time is read
+    enum { COUNT = 4000 };
+    static unsigned long pids[COUNT];
+    static unsigned long sizes[COUNT];
+    for (int i = 0; i < COUNT; i++)
+    {
+        pids[i] = ABSENT_PID + i;
+        sizes[i] = 1;
+    }
+    recordSample(history, pids, sizes, COUNT);
+    CHECK(history->size == COUNT);
+
+    // every other process exits: those left are still found after the backward shifts
+    static unsigned long left[COUNT / 2];
+    for (int i = 0; i < COUNT / 2; i++)
+        left[i] = pids[2 * i];
+    recordSample(history, left, sizes, COUNT / 2);
+    CHECK(history->size == COUNT / 2);
+    int found = 0;
+    int gone = 0;
+    for (int i = 0; i < COUNT; i++)
+    {
+        ProcessHistory *process = findProcessHistory(history, pids[i]);
+        if (i % 2 == 0)
+            found += process != NULL && process->count == 2;
+        else
+            gone += process == NULL;
+    }
+    CHECK(found == COUNT / 2);
+    CHECK(gone == COUNT / 2);
+    CHECK(history->dropped == 0);
+
+    recordSample(history, NULL, NULL, 0);
+    CHECK(history->size == 0);
+    freeFdHistory(history);
+}
+
+int main()
+{
+    testStartTime();
+    testGrowth();
+    testReusedPid();
+    testEviction();
+    return checkResult("fdHistoryTest");
+}
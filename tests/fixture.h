@@ -0,0 +1,38 @@
+#ifndef FIXTURE_H
+#define FIXTURE_H
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../processes.h"
+#include "../stringUtils.h"
+
+/**
+ * Build a process as a scan would, each file descriptor typed from its filename.
+ * @param pid Process identifier
+ * @param size Number of file descriptors
+ * @param fds File descriptor numbers, size long
+ * @param filenames Filenames of the file descriptors, size long
+ * @return A dynamically-allocated process, to free with freeProcess
+ */
+static inline ProcessData *makeProcess(unsigned long pid, unsigned long size, const unsigned long *fds, const char **filenames)
+{
+    ProcessData *process = (ProcessData *)calloc(1, sizeof(ProcessData));
+    process->pid = pid;
+    process->inode = 1000000 + pid;
+    process->size = size;
+    process->fileDescriptors = (FileDescriptorEntry **)calloc(size > 0 ? size : 1, sizeof(FileDescriptorEntry *));
+    for (unsigned long i = 0; i < size; i++)
+    {
+        FileDescriptorEntry *entry = (FileDescriptorEntry *)calloc(1, sizeof(FileDescriptorEntry));
+        entry->fd = fds[i];
+        entry->inode = pid * 1000 + fds[i];
+        entry->dev = pid % 7;
+        entry->filename = strdup(filenames[i]);
+        entry->type = classifyFilename(filenames[i]);
+        process->fileDescriptors[i] = entry;
+    }
+    return process;
+}
+
+#endif
@@ -0,0 +1,248 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../processes.h"
+#include "../columns.h"
+#include "../printTables.h"
+#include "../readProcesses.h"
+#include "../fleetMerge.h"
+#include "check.h"
+#include "fixture.h"
+
+static char directory[] = "/tmp/fleetMergeTest.XXXXXX";
+
+/**
+ * Build a path in the directory of the test.
+ * @param slot Which of the static buffers to build the path in, so that up to 8 paths are held at once
+ * @param name Name of the file
+ * @return The path, in the static buffer of the slot
+ */
+static const char *testPath(int slot, const char *name)
+{
+    static char paths[8][1024];
+    snprintf(paths[slot], sizeof(paths[slot]), "%s/%s", directory, name);
+    return paths[slot];
+}
+
+/**
+ * Write a binary table of processes.
+ * @param slot Buffer to build the path in, see testPath
+ * @param name Name of the file in the test directory
+ * @param columns Mask of the columns to save
+ * @param processes Processes to write, freed once written
+ * @param numProcesses Number of processes
+ * @return Path of the file
+ */
+static const char *writeTable(int slot, const char *name, unsigned int columns, ProcessData **processes, int numProcesses)
+{
+    const char *path = testPath(slot, name);
+    CHECK(print_columns_binary((char *)path, columns, processes, numProcesses) == 0);
+    for (int i = 0; i < numProcesses; i++)
+        freeProcess(processes[i]);
+    return path;
+}
+
+/**
+ * Look up rows of a fleet index into a string.
+ * @param index Fleet index to read
+ * @param node Node ID of the process
+ * @param pid Process identifier
+ * @param fd File descriptor, or -1 for all
+ * @param found Assigned the number of rows found
+ * @return The rows printed, dynamically allocated
+ */
+static char *lookup(FleetIndex *index, const char *node, unsigned long pid, long fd, long *found)
+{
+    char *output = NULL;
+    size_t size = 0;
+    FILE *stream = open_memstream(&output, &size);
+    *found = lookupFleetRows(index, node, pid, fd, stream);
+    fclose(stream);
+    return output;
+}
+
+static void testDuplicates()
+{
+    // node "beta" is given twice: the second input holds pid 10 fd 1 again, whose row must win
+    const unsigned long oldFds[] = {0, 1, 2};
+    const char *oldFilenames[] = {"/dev/null", "/tmp/old", "pipe:[7]"};
+    const unsigned long lonelyFds[] = {5};
+    const char *lonelyFilenames[] = {"/var/log/syslog"};
+    ProcessData *oldProcesses[] = {makeProcess(10, 3, oldFds, oldFilenames), makeProcess(20, 1, lonelyFds, lonelyFilenames)};
+
+    const unsigned long newFds[] = {1, 3};
+    const char *newFilenames[] = {"socket:[99]", "/tmp/new"};
+    const unsigned long largestFds[] = {0, 1, 2, 3, 4};
+    const char *largestFilenames[] = {"/a", "/b", "/c", "/d", "anon_inode:[eventfd]"};
+    ProcessData *newProcesses[] = {makeProcess(10, 2, newFds, newFilenames), makeProcess(30, 5, largestFds, largestFilenames)};
+
+    const unsigned long alphaFds[] = {0};
+    const char *alphaFilenames[] = {"/dev/tty"};
+    ProcessData *alphaProcesses[] = {makeProcess(1, 1, alphaFds, alphaFilenames)};
+
+    // inputs keep pointers into their arguments, as they do into argv
+    MergeInput inputs[3];
+    char arguments[3][1200];
+    snprintf(arguments[0], sizeof(arguments[0]), "beta:%s", writeTable(0, "old.bin", COMPOSITE_COLUMNS, oldProcesses, 2));
+    snprintf(arguments[1], sizeof(arguments[1]), "beta:%s", writeTable(1, "new.bin", ALL_COLUMNS, newProcesses, 2));
+    snprintf(arguments[2], sizeof(arguments[2]), "alpha:%s", writeTable(2, "alpha.bin", COMPOSITE_COLUMNS, alphaProcesses, 1));
+    for (int i = 0; i < 3; i++)
+        CHECK(parseMergeInput(arguments[i], i, &inputs[i]) == 0);
+
+    const char *indexPath = testPath(3, "fleet.bin");
+    for (int threads = 1; threads <= 2; threads++)
+    {
+        char *summary = NULL;
+        size_t size = 0;
+        FILE *stream = open_memstream(&summary, &size);
+        CHECK(mergeSnapshots(inputs, 3, indexPath, threads, stream) == 0);
+        fclose(stream);
+        CHECK(summary != NULL && strstr(summary, "\nfleet") != NULL && strstr(summary, "beta:30 (5)") != NULL);
+        free(summary);
+
+        FleetIndex index;
+        CHECK(openFleetIndex(&index, indexPath) == 0);
+        if (index.file == NULL)
+            continue;
+        CHECK(index.header.numNodes == 2);
+        CHECK(index.header.numRows == 11);
+        CHECK(findFleetNode(&index, "alpha") == 0);
+        CHECK(findFleetNode(&index, "beta") == 1);
+        CHECK(findFleetNode(&index, "gamma") == -1);
+
+        const NodeAggregate *alpha = &index.aggregates[0];
+        const NodeAggregate *beta = &index.aggregates[1];
+        const NodeAggregate *fleet = &index.aggregates[2];
+        CHECK(alpha->inputs == 1 && alpha->processes == 1 && alpha->rows == 1 && alpha->duplicates == 0);
+        CHECK(alpha->byType[FD_TYPE_DEVICE] == 1);
+        CHECK(beta->inputs == 2 && beta->processes == 3 && beta->rows == 10 && beta->duplicates == 1);
+        CHECK(beta->byType[FD_TYPE_SOCKET] == 1 && beta->byType[FD_TYPE_PIPE] == 1 && beta->byType[FD_TYPE_EVENTFD] == 1);
+        CHECK(beta->byType[FD_TYPE_FILE] == 6 && beta->byType[FD_TYPE_DEVICE] == 1);
+        CHECK(beta->largestPid == 30 && beta->largestRows == 5 && beta->largestNode == 1);
+        CHECK(fleet->inputs == 3 && fleet->processes == 4 && fleet->rows == 11 && fleet->duplicates == 1);
+        CHECK(fleet->largestPid == 30 && fleet->largestRows == 5 && fleet->largestNode == 1);
+
+        long found;
+        char *rows = lookup(&index, "beta", 10, 1, &found);
+        CHECK(found == 1);
+        CHECK_STRING(rows, "beta\t10\t1\tsocket\t10001\t3\tsocket:[99]\n");
+        free(rows);
+        rows = lookup(&index, "beta", 10, -1, &found);
+        CHECK(found == 4);
+        // the first table has no dev column
+        CHECK_STRING(rows, "beta\t10\t0\tdevice\t10000\t0\t/dev/null\n"
+                           "beta\t10\t1\tsocket\t10001\t3\tsocket:[99]\n"
+                           "beta\t10\t2\tpipe\t10002\t0\tpipe:[7]\n"
+                           "beta\t10\t3\tfile\t10003\t3\t/tmp/new\n");
+        free(rows);
+        rows = lookup(&index, "alpha", 1, -1, &found);
+        CHECK(found == 1);
+        free(rows);
+        rows = lookup(&index, "beta", 20, 4, &found);
+        CHECK(found == 0);
+        free(rows);
+        rows = lookup(&index, "beta", 25, -1, &found);
+        CHECK(found == 0);
+        free(rows);
+        rows = lookup(&index, "gamma", 10, -1, &found);
+        CHECK(found == 0);
+        free(rows);
+        closeFleetIndex(&index);
+    }
+
+    // with the inputs of beta given in the other order, the old table's row wins. mergeSnapshots
+    // has sorted the inputs by node, so they are found by path.
+    for (int i = 0; i < 3; i++)
+        inputs[i].order = strstr(inputs[i].path, "new.bin") != NULL ? 0 : strstr(inputs[i].path, "old.bin") != NULL ? 1 : 2;
+    FleetIndex index;
+    char *summary = NULL;
+    size_t size = 0;
+    FILE *stream = open_memstream(&summary, &size);
+    CHECK(mergeSnapshots(inputs, 3, indexPath, 1, stream) == 0);
+    fclose(stream);
+    free(summary);
+    CHECK(openFleetIndex(&index, indexPath) == 0);
+    if (index.file != NULL)
+    {
+        long found;
+        char *rows = lookup(&index, "beta", 10, 1, &found);
+        CHECK(found == 1);
+        CHECK_STRING(rows, "beta\t10\t1\tfile\t10001\t0\t/tmp/old\n");
+        free(rows);
+        closeFleetIndex(&index);
+    }
+
+    for (int slot = 0; slot < 4; slot++)
+        unlink(testPath(slot, slot == 0 ? "old.bin" : slot == 1 ? "new.bin" : slot == 2 ? "alpha.bin" : "fleet.bin"));
+}
+
+/**
+ * Merge a single input expected to be rejected, without printing its error.
+ * @param path Path of the input
+ * @return Nonzero if the merge failed
+ */
+static int mergeFails(const char *path)
+{
+    char argument[1200];
+    MergeInput input;
+    snprintf(argument, sizeof(argument), "node:%s", path);
+    CHECK(parseMergeInput(argument, 0, &input) == 0);
+    int saved = silenceStderr();
+    int result = mergeSnapshots(&input, 1, testPath(3, "fleet.bin"), 1, stdout);
+    restoreStderr(saved);
+    unlink(path);
+    return result != 0;
+}
+
+static void testRejected()
+{
+    const unsigned long fds[] = {0, 1};
+    const char *filenames[] = {"/a", "/b"};
+    ProcessData *unsortedPids[] = {makeProcess(20, 2, fds, filenames), makeProcess(10, 2, fds, filenames)};
+    CHECK(mergeFails(writeTable(0, "pids.bin", COMPOSITE_COLUMNS, unsortedPids, 2)));
+
+    const unsigned long unsortedFds[] = {1, 0};
+    ProcessData *unsortedRows[] = {makeProcess(10, 2, unsortedFds, filenames)};
+    CHECK(mergeFails(writeTable(0, "fds.bin", COMPOSITE_COLUMNS, unsortedRows, 1)));
+
+    const unsigned long repeatedFds[] = {1, 1};
+    ProcessData *repeatedRows[] = {makeProcess(10, 2, repeatedFds, filenames)};
+    CHECK(mergeFails(writeTable(0, "repeated.bin", COMPOSITE_COLUMNS, repeatedRows, 1)));
+
+    ProcessData *withoutFd[] = {makeProcess(10, 2, fds, filenames)};
+    CHECK(mergeFails(writeTable(0, "vnodes.bin", VNODES_COLUMNS, withoutFd, 1)));
+
+    CHECK(mergeFails(testPath(0, "missing.bin")));
+
+    MergeInput input;
+    int saved = silenceStderr();
+    CHECK(parseMergeInput("/no/node.bin", 0, &input) != 0);
+    CHECK(parseMergeInput(":/no/node.bin", 0, &input) != 0);
+    CHECK(parseMergeInput("node:", 0, &input) != 0);
+    CHECK(parseMergeInput("a-node-id-that-is-far-too-long-to-fit-in-the-sixty-four-bytes-given:/x", 0, &input) != 0);
+    restoreStderr(saved);
+    CHECK(parseMergeInput("node:/path:with:colons", 4, &input) == 0);
+    CHECK_STRING(input.node, "node");
+    CHECK_STRING(input.path, "/path:with:colons");
+    CHECK(input.order == 4);
+
+    FleetIndex index;
+    CHECK(openFleetIndex(&index, testPath(3, "fleet.bin")) == -1);
+}
+
+int main()
+{
+    if (mkdtemp(directory) == NULL)
+    {
+        perror("mkdtemp");
+        return 1;
+    }
+    testDuplicates();
+    testRejected();
+    unlink(testPath(3, "fleet.bin"));
+    rmdir(directory);
+    return checkResult("fleetMergeTest");
+}
@@ -0,0 +1,150 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "../processes.h"
+#include "../columns.h"
+#include "../readProcesses.h"
+#include "../pipeline.h"
+#include "check.h"
+
+// above the largest PID Linux hands out (4194304), so never a running process
+#define ABSENT_PID 100000000ul
+#define NUM_PROCESSES 200
+
+/**
+ * Number of calls to pthread_create that succeed before the next one fails, negative to never
+ * fail. The test is linked with -Wl,--wrap=pthread_create, so that this covers the pipeline.
+ */
+static int threadsBeforeFailure = -1;
+
+int __real_pthread_create(pthread_t *thread, const pthread_attr_t *attributes, void *(*start)(void *), void *argument);
+
+int __wrap_pthread_create(pthread_t *thread, const pthread_attr_t *attributes, void *(*start)(void *), void *argument)
+{
+    if (threadsBeforeFailure == 0)
+    {
+        threadsBeforeFailure = -1;
+        return 1;
+    }
+    if (threadsBeforeFailure > 0)
+        threadsBeforeFailure--;
+    return __real_pthread_create(thread, attributes, start, argument);
+}
+
+/**
+ * Print the PID and number of file descriptors of a process, one line per process.
+ */
+static void printProcessLine(ProcessData *process, unsigned int columns, FILE *stream)
+{
+    fprintf(stream, "%lu %lu\n", process->pid, process->size);
+}
+
+/**
+ * Build processes that were listed but exited before their scan, except the first, which is the
+ * test process itself.
+ * @return A dynamically-allocated array of NUM_PROCESSES processes, to free with freeProcesses
+ */
+static ProcessData **makeProcesses()
+{
+    ProcessData **processes = (ProcessData **)malloc(sizeof(ProcessData *) * NUM_PROCESSES);
+    for (int i = 0; i < NUM_PROCESSES; i++)
+    {
+        processes[i] = (ProcessData *)calloc(1, sizeof(ProcessData));
+        processes[i]->pid = i == 0 ? getpid() : ABSENT_PID + i;
+    }
+    return processes;
+}
+
+static void testOrder()
+{
+    for (int numScanners = 1; numScanners <= 4; numScanners++)
+    {
+        ProcessData **processes = makeProcesses();
+        char *output = NULL;
+        size_t length = 0;
+        FILE *stream = open_memstream(&output, &length);
+        ScanStats stats;
+        memset(&stats, 0, sizeof(stats));
+        ScanOptions options = {COLUMN_MASK(pid) | COLUMN_MASK(fd), NULL, &stats, NULL, NULL, 0};
+        PipelineStats pipelineStats;
+        CHECK(runPipeline(processes, NUM_PROCESSES, numScanners, &options, NULL, printProcessLine, 0, stream, &pipelineStats) == 0);
+        fclose(stream);
+
+        // rows come out in the order of the array, whatever scanner read them
+        char *line = output;
+        int inOrder = 1;
+        for (int i = 0; i < NUM_PROCESSES && inOrder; i++)
+        {
+            unsigned long pid = strtoul(line, &line, 10);
+            unsigned long size = strtoul(line, &line, 10);
+            inOrder = pid == (i == 0 ? (unsigned long)getpid() : ABSENT_PID + i) && (i == 0 ? size > 0 : size == 0) && *line++ == '\n';
+        }
+        CHECK(inOrder);
+        CHECK(*line == '\0');
+        free(output);
+
+        // every process was freed once written, and the scanners' counters were added up
+        int freed = 0;
+        for (int i = 0; i < NUM_PROCESSES; i++)
+            freed += processes[i] == NULL;
+        CHECK(freed == NUM_PROCESSES);
+        CHECK(stats.processesScanned == 1);
+        CHECK(stats.openCalls == NUM_PROCESSES);
+        freeProcesses(processes, NUM_PROCESSES);
+    }
+}
+
+static void testWriteFailure()
+{
+    ProcessData **processes = makeProcesses();
+    // every write to /dev/full fails, and without a buffer the first one is noticed at once
+    FILE *stream = fopen("/dev/full", "w");
+    CHECK(stream != NULL);
+    if (stream == NULL)
+        return;
+    setvbuf(stream, NULL, _IONBF, 0);
+    CHECK(runPipeline(processes, NUM_PROCESSES, 2, NULL, NULL, printProcessLine, 0, stream, NULL) == -1);
+    fclose(stream);
+    // the stages run to the end, so processes are still all freed
+    int freed = 0;
+    for (int i = 0; i < NUM_PROCESSES; i++)
+        freed += processes[i] == NULL;
+    CHECK(freed == NUM_PROCESSES);
+    freeProcesses(processes, NUM_PROCESSES);
+}
+
+static void testStartFailure()
+{
+    // the writer, the formatter, then the first scanner fail to start in turn
+    for (int failing = 0; failing < 3; failing++)
+    {
+        ProcessData **processes = makeProcesses();
+        char *output = NULL;
+        size_t length = 0;
+        FILE *stream = open_memstream(&output, &length);
+        threadsBeforeFailure = failing;
+        CHECK(runPipeline(processes, NUM_PROCESSES, 1, NULL, NULL, printProcessLine, 0, stream, NULL) == -1);
+        threadsBeforeFailure = -1;
+        fclose(stream);
+        CHECK(length == 0);
+        free(output);
+
+        // nothing was scanned or freed: the processes are still the caller's
+        int untouched = 0;
+        for (int i = 0; i < NUM_PROCESSES; i++)
+            untouched += processes[i] != NULL && processes[i]->fileDescriptors == NULL;
+        CHECK(untouched == NUM_PROCESSES);
+        freeProcesses(processes, NUM_PROCESSES);
+    }
+}
+
+int main()
+{
+    testOrder();
+    testWriteFailure();
+    testStartFailure();
+    return checkResult("pipelineTest");
+}
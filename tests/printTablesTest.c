@@ -0,0 +1,188 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../processes.h"
+#include "../columns.h"
+#include "../printTables.h"
+#include "check.h"
+
+/**
+ * A filename and how each format must write it
+ */
+typedef struct EscapeCase
+{
+    const char *filename;
+    const char *csv;
+    const char *json;
+} EscapeCase;
+
+static const EscapeCase escapeCases[] = {
+    {"/tmp/plain", "/tmp/plain", "\"/tmp/plain\""},
+    {"", "", "\"\""},
+    {"/tmp/a,b", "\"/tmp/a,b\"", "\"/tmp/a,b\""},
+    {"/tmp/say \"hi\"", "\"/tmp/say \"\"hi\"\"\"", "\"/tmp/say \\\"hi\\\"\""},
+    {"/tmp/line\nbreak", "\"/tmp/line\nbreak\"", "\"/tmp/line\\nbreak\""},
+    {"/tmp/carriage\rreturn", "\"/tmp/carriage\rreturn\"", "\"/tmp/carriage\\rreturn\""},
+    {"/tmp/tab\there", "/tmp/tab\there", "\"/tmp/tab\\there\""},
+    {"/tmp/\x01" "control", "/tmp/\x01" "control", "\"/tmp/\\u0001control\""},
+    {"C:\\dir\\file", "C:\\dir\\file", "\"C:\\\\dir\\\\file\""},
+    // past the first word, so the escape is found by the word-at-a-time scan
+    {"/var/log/some/long/path,with,commas", "\"/var/log/some/long/path,with,commas\"", "\"/var/log/some/long/path,with,commas\""},
+    {"/var/log/some/long/path/\"quoted\"", "\"/var/log/some/long/path/\"\"quoted\"\"\"", "\"/var/log/some/long/path/\\\"quoted\\\"\""},
+    // well-formed UTF-8 is copied, other bytes of 0x80 and above are escaped in JSON
+    {"/tmp/caf\xc3\xa9", "/tmp/caf\xc3\xa9", "\"/tmp/caf\xc3\xa9\""},
+    {"/tmp/\xe2\x82\xac\xf0\x9f\x98\x80", "/tmp/\xe2\x82\xac\xf0\x9f\x98\x80", "\"/tmp/\xe2\x82\xac\xf0\x9f\x98\x80\""},
+    {"/tmp/\xff", "/tmp/\xff", "\"/tmp/\\u00ff\""},
+    {"/tmp/cut\xc3", "/tmp/cut\xc3", "\"/tmp/cut\\u00c3\""},
+    {"/tmp/\xc3(", "/tmp/\xc3(", "\"/tmp/\\u00c3(\""},
+    {"/tmp/overlong\xc0\xaf", "/tmp/overlong\xc0\xaf", "\"/tmp/overlong\\u00c0\\u00af\""},
+    {"/tmp/surrogate\xed\xa0\x80", "/tmp/surrogate\xed\xa0\x80", "\"/tmp/surrogate\\u00ed\\u00a0\\u0080\""},
+    {"/tmp/big\xf4\x90\x80\x80", "/tmp/big\xf4\x90\x80\x80", "\"/tmp/big\\u00f4\\u0090\\u0080\\u0080\""},
+};
+
+#define NUM_ESCAPE_CASES (sizeof(escapeCases) / sizeof(escapeCases[0]))
+
+/**
+ * Build a process with one file descriptor per escape case.
+ * @param process Process to fill in
+ * @param entries Storage for the file descriptors, NUM_ESCAPE_CASES long
+ * @param pointers Storage for the array of file descriptors, NUM_ESCAPE_CASES long
+ */
+static void buildProcess(ProcessData *process, FileDescriptorEntry *entries, FileDescriptorEntry **pointers)
+{
+    memset(process, 0, sizeof(ProcessData));
+    process->pid = 42;
+    process->inode = 4242;
+    process->size = NUM_ESCAPE_CASES;
+    process->fileDescriptors = pointers;
+    for (size_t i = 0; i < NUM_ESCAPE_CASES; i++)
+    {
+        memset(&entries[i], 0, sizeof(FileDescriptorEntry));
+        entries[i].fd = i;
+        entries[i].inode = 1000 + i;
+        entries[i].filename = (char *)escapeCases[i].filename;
+        entries[i].type = FD_TYPE_FILE;
+        pointers[i] = &entries[i];
+    }
+}
+
+/**
+ * Print a table into memory.
+ * @param format Format to print in
+ * @param columns Mask of the columns to print
+ * @param process The only process of the table
+ * @return The table, dynamically allocated
+ */
+static char *printToString(OutputFormat format, unsigned int columns, ProcessData *process)
+{
+    char *output = NULL;
+    size_t size = 0;
+    FILE *stream = open_memstream(&output, &size);
+    print_columns(format, columns, &process, 1, stream);
+    fclose(stream);
+    return output;
+}
+
+static void testEscaping()
+{
+    ProcessData process;
+    FileDescriptorEntry entries[NUM_ESCAPE_CASES];
+    FileDescriptorEntry *pointers[NUM_ESCAPE_CASES];
+    buildProcess(&process, entries, pointers);
+
+    char expected[8192];
+    size_t length = snprintf(expected, sizeof(expected), "filename\n");
+    for (size_t i = 0; i < NUM_ESCAPE_CASES; i++)
+        length += snprintf(expected + length, sizeof(expected) - length, "%s\n", escapeCases[i].csv);
+    char *output = printToString(FORMAT_CSV, COLUMN_MASK(filename), &process);
+    CHECK_STRING(output, expected);
+    free(output);
+
+    length = 0;
+    for (size_t i = 0; i < NUM_ESCAPE_CASES; i++)
+        length += snprintf(expected + length, sizeof(expected) - length, "{\"filename\":%s}\n", escapeCases[i].json);
+    output = printToString(FORMAT_NDJSON, COLUMN_MASK(filename), &process);
+    CHECK_STRING(output, expected);
+    free(output);
+}
+
+static void testRows()
+{
+    ProcessData process;
+    FileDescriptorEntry entries[NUM_ESCAPE_CASES];
+    FileDescriptorEntry *pointers[NUM_ESCAPE_CASES];
+    buildProcess(&process, entries, pointers);
+    process.size = 2;
+    entries[1].type = FD_TYPE_SOCKET;
+    entries[1].dev = 7;
+
+    char *output = printToString(FORMAT_CSV, ALL_COLUMNS & ~COLUMN_MASK(socket), &process);
+    CHECK_STRING(output, "index,pid,fd,filename,inode,dev,type\n"
+                         "1,42,0,/tmp/plain,1000,0,file\n"
+                         "2,42,1,,1001,7,socket\n");
+    free(output);
+    output = printToString(FORMAT_NDJSON, COLUMN_MASK(pid) | COLUMN_MASK(fd) | COLUMN_MASK(type) | COLUMN_MASK(socket), &process);
+    CHECK_STRING(output, "{\"pid\":42,\"fd\":0,\"type\":\"file\"}\n"
+                         "{\"pid\":42,\"fd\":1,\"type\":\"socket\"}\n");
+    free(output);
+    // the generic writer is used for masks other than those of the fixed tables
+    output = printToString(FORMAT_CSV, COLUMN_MASK(fd) | COLUMN_MASK(dev), &process);
+    CHECK_STRING(output, "fd,dev\n0,0\n1,7\n");
+    free(output);
+}
+
+static void testFixedTables()
+{
+    ProcessData process;
+    FileDescriptorEntry entries[NUM_ESCAPE_CASES];
+    FileDescriptorEntry *pointers[NUM_ESCAPE_CASES];
+    buildProcess(&process, entries, pointers);
+    ProcessData *processes[] = {&process};
+
+    // each fixed table is written by its own specialized writer, which must match the generic one
+    for (int table = 0; table < TABLE_TYPE_COUNT; table++)
+    {
+        for (int format = FORMAT_NDJSON; format < OUTPUT_FORMAT_COUNT; format++)
+        {
+            char *fixed = NULL;
+            size_t size = 0;
+            FILE *stream = open_memstream(&fixed, &size);
+            print_table_formatted((TableType)table, (OutputFormat)format, processes, 1, stream);
+            fclose(stream);
+            char *generic = printToString((OutputFormat)format, table_definition((TableType)table)->columns, &process);
+            CHECK_STRING(fixed, generic);
+            free(fixed);
+            free(generic);
+        }
+    }
+}
+
+static void testParse()
+{
+    unsigned int columns;
+    CHECK(parse_columns("pid,fd,inode", &columns) == 0);
+    CHECK(columns == (COLUMN_MASK(pid) | COLUMN_MASK(fd) | COLUMN_MASK(inode)));
+    CHECK(parse_columns("index,pid,fd,filename,inode,dev,type,socket", &columns) == 0);
+    CHECK(columns == ALL_COLUMNS);
+    CHECK(parse_columns("pid,uid", &columns) != 0);
+    CHECK(parse_columns("", &columns) != 0);
+    CHECK(parse_columns("fd,", &columns) == 0);
+    CHECK(columns == COLUMN_MASK(fd));
+
+    OutputFormat format;
+    CHECK(parse_output_format("text", &format) == 0 && format == FORMAT_TEXT);
+    CHECK(parse_output_format("ndjson", &format) == 0 && format == FORMAT_NDJSON);
+    CHECK(parse_output_format("csv", &format) == 0 && format == FORMAT_CSV);
+    CHECK(parse_output_format("json", &format) != 0);
+}
+
+int main()
+{
+    testEscaping();
+    testRows();
+    testFixedTables();
+    testParse();
+    return checkResult("printTablesTest");
+}
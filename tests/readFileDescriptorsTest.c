@@ -0,0 +1,280 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/eventfd.h>
+
+#include "../processes.h"
+#include "../columns.h"
+#include "../rowFilter.h"
+#include "../readProcesses.h"
+#include "../readFileDescriptors.h"
+#include "check.h"
+
+static char directory[] = "/tmp/readFileDescriptorsTest.XXXXXX";
+static char path[1024];
+
+/**
+ * Number of calls to malloc that succeed before the next one fails, negative to never fail.
+ * The test is linked with -Wl,--wrap=malloc, so that this covers the calls of the scan.
+ */
+static int mallocsBeforeFailure = -1;
+
+void *__real_malloc(size_t size);
+
+void *__wrap_malloc(size_t size)
+{
+    if (mallocsBeforeFailure == 0)
+    {
+        mallocsBeforeFailure = -1;
+        return NULL;
+    }
+    if (mallocsBeforeFailure > 0)
+        mallocsBeforeFailure--;
+    return __real_malloc(size);
+}
+
+/**
+ * Directory entry of a file descriptor, as getdents returns it
+ */
+typedef union DirectoryEntry
+{
+    linux_dirent entry;
+    char bytes[sizeof(linux_dirent) + 32];
+} DirectoryEntry;
+
+/**
+ * Read one file descriptor of the test process through /proc/self/fd.
+ * @param fd File descriptor to read
+ * @param options Options of the scan
+ * @param entry Pointer to store the row in, if it is kept
+ * @return The status returned by readFileDescriptor
+ */
+static int readOwnFileDescriptor(int fd, const ScanOptions *options, FileDescriptorEntry **entry)
+{
+    ProcessData process;
+    memset(&process, 0, sizeof(process));
+    process.pid = getpid();
+    process.inode = 1;
+    DirectoryEntry directoryEntry;
+    memset(&directoryEntry, 0, sizeof(directoryEntry));
+    snprintf(directoryEntry.entry.d_name, 32, "%d", fd);
+    int directoryFd = open("/proc/self/fd", O_RDONLY | O_DIRECTORY);
+    int status = readFileDescriptor(&process, &directoryEntry.entry, directoryFd, options, entry);
+    close(directoryFd);
+    return status;
+}
+
+/**
+ * Free a row returned by readFileDescriptor.
+ * @param entry Row to free, may be NULL
+ */
+static void freeEntry(FileDescriptorEntry *entry)
+{
+    if (entry == NULL)
+        return;
+    free(entry->filename);
+    free(entry);
+}
+
+static void testKept(int fileFd, int pipeFds[2])
+{
+    struct stat fileStats;
+    struct stat pipeStats;
+    CHECK(fstat(fileFd, &fileStats) == 0);
+    CHECK(fstat(pipeFds[0], &pipeStats) == 0);
+    ScanStats stats;
+    memset(&stats, 0, sizeof(stats));
+    ScanOptions options = {ALL_COLUMNS, NULL, &stats, NULL, NULL, 0};
+
+    FileDescriptorEntry *entry = NULL;
+    CHECK(readOwnFileDescriptor(fileFd, &options, &entry) == 0);
+    CHECK(entry != NULL);
+    if (entry != NULL)
+    {
+        CHECK(entry->fd == fileFd);
+        CHECK_STRING(entry->filename, path);
+        CHECK(entry->type == FD_TYPE_FILE);
+        CHECK(entry->inode == fileStats.st_ino);
+        CHECK(entry->dev == fileStats.st_dev);
+    }
+    freeEntry(entry);
+
+    // the inode of a pipe comes from its link
+    CHECK(readOwnFileDescriptor(pipeFds[0], &options, &entry) == 0);
+    CHECK(entry != NULL && entry->type == FD_TYPE_PIPE && entry->inode == pipeStats.st_ino);
+    freeEntry(entry);
+    CHECK(stats.rowsSeen == 2);
+    CHECK(stats.readlinkCalls == 2);
+    CHECK(stats.statCalls == 1);
+}
+
+static void testColumns(int fileFd, int pipeFds[2])
+{
+    struct stat fileStats;
+    CHECK(fstat(fileFd, &fileStats) == 0);
+    int directoryFd = open("/proc/self/fd", O_RDONLY | O_DIRECTORY);
+    int eventFd = eventfd(0, 0);
+    ScanStats stats;
+    memset(&stats, 0, sizeof(stats));
+    FileDescriptorEntry *entry = NULL;
+
+    // the fd column alone needs neither the link nor a stat
+    ScanOptions options = {COLUMN_MASK(pid) | COLUMN_MASK(fd), NULL, &stats, NULL, NULL, 0};
+    CHECK(readOwnFileDescriptor(fileFd, &options, &entry) == 0);
+    CHECK(entry != NULL && entry->fd == fileFd && entry->filename == NULL && entry->inode == 1 && entry->dev == 0);
+    freeEntry(entry);
+    CHECK(stats.readlinkCalls == 0 && stats.statCalls == 0);
+
+    // the inode column stats the file without reading its link
+    memset(&stats, 0, sizeof(stats));
+    options.columns = COLUMN_MASK(fd) | COLUMN_MASK(inode);
+    CHECK(readOwnFileDescriptor(fileFd, &options, &entry) == 0);
+    CHECK(entry != NULL && entry->filename == NULL && entry->inode == fileStats.st_ino);
+    freeEntry(entry);
+    CHECK(stats.readlinkCalls == 0 && stats.statCalls == 1);
+
+    // the filename column reads the link without a stat
+    memset(&stats, 0, sizeof(stats));
+    options.columns = COLUMN_MASK(fd) | COLUMN_MASK(filename);
+    CHECK(readOwnFileDescriptor(fileFd, &options, &entry) == 0);
+    CHECK(entry != NULL && entry->inode == 1 && entry->type == FD_TYPE_FILE);
+    if (entry != NULL)
+        CHECK_STRING(entry->filename, path);
+    freeEntry(entry);
+    CHECK(stats.readlinkCalls == 1 && stats.statCalls == 0);
+
+    // with both, the link of a pipe already gives its inode, so it is not stat'ed
+    memset(&stats, 0, sizeof(stats));
+    options.columns = COMPOSITE_COLUMNS;
+    CHECK(readOwnFileDescriptor(pipeFds[0], &options, &entry) == 0);
+    CHECK(entry != NULL && entry->type == FD_TYPE_PIPE && entry->inode != 1);
+    freeEntry(entry);
+    CHECK(stats.readlinkCalls == 1 && stats.statCalls == 0);
+
+    // a directory is stat'ed for its inode as a file is
+    memset(&stats, 0, sizeof(stats));
+    CHECK(readOwnFileDescriptor(directoryFd, &options, &entry) == 0);
+    CHECK(entry != NULL && entry->type == FD_TYPE_FILE && entry->inode != 1);
+    freeEntry(entry);
+    CHECK(stats.readlinkCalls == 1 && stats.statCalls == 1);
+
+    // an eventfd shares the inode of anon_inodefs, so it keeps the inode of the process unstat'ed
+    memset(&stats, 0, sizeof(stats));
+    CHECK(readOwnFileDescriptor(eventFd, &options, &entry) == 0);
+    CHECK(entry != NULL && entry->type == FD_TYPE_EVENTFD && entry->inode == 1);
+    freeEntry(entry);
+    CHECK(stats.readlinkCalls == 1 && stats.statCalls == 0);
+    close(directoryFd);
+    close(eventFd);
+}
+
+static void testFiltered(int fileFd, int pipeFds[2])
+{
+    ScanStats stats;
+    memset(&stats, 0, sizeof(stats));
+    ScanOptions options = {ALL_COLUMNS, NULL, &stats, NULL, NULL, 0};
+    FileDescriptorEntry *entry = NULL;
+    char expression[64];
+
+    // rejected on its fd number, before the link is read
+    snprintf(expression, sizeof(expression), "fd == %d", pipeFds[0]);
+    RowFilter *filter = compileRowFilter(expression);
+    CHECK(filter != NULL);
+    options.filter = filter;
+    CHECK(readOwnFileDescriptor(fileFd, &options, &entry) == 1);
+    CHECK(entry == NULL);
+    CHECK(stats.rejected[FILTER_STAGE_FD] == 1);
+    CHECK(stats.readlinkCalls == 0);
+    CHECK(readOwnFileDescriptor(pipeFds[0], &options, &entry) == 0);
+    CHECK(entry != NULL);
+    freeEntry(entry);
+    freeRowFilter(filter);
+
+    // rejected on its path, before it is stat'ed
+    memset(&stats, 0, sizeof(stats));
+    filter = compileRowFilter("path ^= /nonexistent/");
+    options.filter = filter;
+    CHECK(readOwnFileDescriptor(fileFd, &options, &entry) == 1);
+    CHECK(entry == NULL);
+    CHECK(stats.rejected[FILTER_STAGE_PATH] == 1);
+    CHECK(stats.readlinkCalls == 1);
+    CHECK(stats.statCalls == 0);
+    freeRowFilter(filter);
+
+    // rejected on its inode, once everything is resolved
+    memset(&stats, 0, sizeof(stats));
+    filter = compileRowFilter("inode == 1");
+    options.filter = filter;
+    CHECK(readOwnFileDescriptor(fileFd, &options, &entry) == 1);
+    CHECK(entry == NULL);
+    CHECK(stats.rejected[FILTER_STAGE_INODE] == 1);
+    freeRowFilter(filter);
+
+    // rejected by the set of types, as soon as the link is read
+    memset(&stats, 0, sizeof(stats));
+    options.filter = NULL;
+    options.types = FD_TYPE_MASK(FD_TYPE_PIPE);
+    CHECK(readOwnFileDescriptor(fileFd, &options, &entry) == 1);
+    CHECK(entry == NULL);
+    CHECK(stats.rejected[FILTER_STAGE_PATH] == 1);
+    CHECK(stats.statCalls == 0);
+    CHECK(readOwnFileDescriptor(pipeFds[1], &options, &entry) == 0);
+    CHECK(entry != NULL && entry->type == FD_TYPE_PIPE);
+    freeEntry(entry);
+}
+
+static void testAllocationFailure(int fileFd)
+{
+    ScanOptions options = {ALL_COLUMNS, NULL, NULL, NULL, NULL, 0};
+    FileDescriptorEntry *entry = NULL;
+    int saved = silenceStderr();
+    mallocsBeforeFailure = 0;
+    CHECK(readOwnFileDescriptor(fileFd, &options, &entry) == -1);
+    CHECK(entry == NULL);
+
+    // a row that cannot be allocated fails the scan of its process, unlike filtered rows
+    ProcessData *process = (ProcessData *)calloc(1, sizeof(ProcessData));
+    process->pid = getpid();
+    mallocsBeforeFailure = 1;
+    CHECK(readFileDescriptors(process, &options) != 0);
+    mallocsBeforeFailure = -1;
+    restoreStderr(saved);
+    CHECK(process->size > 0);
+    freeProcess(process);
+
+    RowFilter *filter = compileRowFilter("fd > 100000");
+    options.filter = filter;
+    process = (ProcessData *)calloc(1, sizeof(ProcessData));
+    process->pid = getpid();
+    CHECK(readFileDescriptors(process, &options) == 0);
+    CHECK(process->size == 0);
+    freeProcess(process);
+    freeRowFilter(filter);
+}
+
+int main()
+{
+    if (mkdtemp(directory) == NULL)
+    {
+        perror("mkdtemp");
+        return 1;
+    }
+    snprintf(path, sizeof(path), "%s/open.log", directory);
+    int fileFd = open(path, O_WRONLY | O_CREAT, 0600);
+    int pipeFds[2];
+    CHECK(fileFd != -1);
+    CHECK(pipe(pipeFds) == 0);
+    testKept(fileFd, pipeFds);
+    testColumns(fileFd, pipeFds);
+    testFiltered(fileFd, pipeFds);
+    testAllocationFailure(fileFd);
+    close(fileFd);
+    close(pipeFds[0]);
+    close(pipeFds[1]);
+    unlink(path);
+    rmdir(directory);
+    return checkResult("readFileDescriptorsTest");
+}
@@ -0,0 +1,252 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../rowFilter.h"
+#include "../stringUtils.h"
+#include "check.h"
+
+/**
+ * Rows the filters are evaluated over, fully resolved
+ */
+static const FilterRow rows[] = {
+    {1, 0, "/dev/null", FD_TYPE_DEVICE, 5},
+    {100, 3, "socket:[2680412]", FD_TYPE_SOCKET, 2680412},
+    {150, 1000, "socket:[2680413]", FD_TYPE_SOCKET, 2680413},
+    {200, 7, "/var/log/syslog", FD_TYPE_FILE, 1311},
+    {201, 2000, "/tmp/run.log", FD_TYPE_FILE, 4242},
+    {4000, 10, "/tmp/a b.log (deleted)", FD_TYPE_DELETED, 77},
+    {4001, 11, "anon_inode:[eventfd]", FD_TYPE_EVENTFD, 0},
+    {4002, 12, "pipe:[2677450]", FD_TYPE_PIPE, 2677450},
+};
+
+#define NUM_ROWS (sizeof(rows) / sizeof(rows[0]))
+
+/**
+ * Compile an expression expected to be rejected, without printing its error.
+ * @param expression Expression to compile
+ * @return Nonzero if the expression was rejected
+ */
+static int rejects(const char *expression)
+{
+    int saved = silenceStderr();
+    RowFilter *filter = compileRowFilter(expression);
+    restoreStderr(saved);
+    freeRowFilter(filter);
+    return filter == NULL;
+}
+
+/**
+ * Evaluate an expression over a fully resolved row.
+ * @param expression Expression to compile
+ * @param row Row to evaluate
+ * @return The result of the filter, or -1 if the expression was rejected
+ */
+static int matches(const char *expression, const FilterRow *row)
+{
+    RowFilter *filter = compileRowFilter(expression);
+    if (filter == NULL)
+        return -1;
+    FilterResult result = evaluateRowFilter(filter, FILTER_STAGE_INODE, row);
+    freeRowFilter(filter);
+    return result;
+}
+
+/**
+ * Check that two expressions keep the same rows.
+ * @param first First expression
+ * @param second Expression equivalent to the first
+ * @return Nonzero if both keep the same rows at every stage
+ */
+static int equivalent(const char *first, const char *second)
+{
+    RowFilter *firstFilter = compileRowFilter(first);
+    RowFilter *secondFilter = compileRowFilter(second);
+    int same = firstFilter != NULL && secondFilter != NULL;
+    for (int i = 0; same && i < NUM_ROWS; i++)
+    {
+        for (int stage = 0; stage < FILTER_STAGE_COUNT; stage++)
+            same = same && evaluateRowFilter(firstFilter, stage, &rows[i]) == evaluateRowFilter(secondFilter, stage, &rows[i]);
+    }
+    freeRowFilter(firstFilter);
+    freeRowFilter(secondFilter);
+    return same;
+}
+
+/**
+ * Build a bitmask of the rows an expression keeps.
+ * @param expression Expression to compile
+ * @return Bit i set if rows[i] matches
+ */
+static unsigned int kept(const char *expression)
+{
+    unsigned int mask = 0;
+    for (int i = 0; i < NUM_ROWS; i++)
+    {
+        if (matches(expression, &rows[i]) == FILTER_TRUE)
+            mask |= 1u << i;
+    }
+    return mask;
+}
+
+static void testParse()
+{
+    const char *valid[] = {
+        "pid == 1",
+        "pid=1",
+        "fd != 3",
+        "inode<10",
+        "inode <= 10",
+        "fd > 2",
+        "fd>=2",
+        "pid in 100..200",
+        "pid in 100 .. 200",
+        "path == /dev/null",
+        "path != \"/tmp/a b.log (deleted)\"",
+        "path ~ /tmp/*.log",
+        "path ^= /var/log/",
+        "!(fd < 3)",
+        "!!(fd < 3)",
+        "((pid == 1))",
+        "  type == socket  ",
+        "type == socket && (fd >= 1000 || path ^= /var/log/)",
+        "pid == 1 || pid == 2 || pid == 3 && fd == 4",
+    };
+    for (int i = 0; i < sizeof(valid) / sizeof(valid[0]); i++)
+    {
+        RowFilter *filter = compileRowFilter(valid[i]);
+        CHECK(filter != NULL);
+        freeRowFilter(filter);
+    }
+
+    const char *invalid[] = {
+        "",
+        "pid",
+        "pid ==",
+        "pid == abc",
+        "pid == -1",
+        "uid == 1",
+        "pid ~ 1*",
+        "fd ^= 1",
+        "path < /tmp",
+        "path in 1..2",
+        "type == sock",
+        "type > socket",
+        "pid in 1",
+        "pid in 1..",
+        "(pid == 1",
+        "pid == 1)",
+        "pid == 1 &&",
+        "|| pid == 1",
+        "pid == 1 & fd == 2",
+        "path == \"/tmp",
+        "pid == 1 pid == 2",
+    };
+    for (int i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++)
+        CHECK(rejects(invalid[i]));
+
+    // every type printed in the type column can be compared with
+    char expression[64];
+    for (int type = 0; type < FD_TYPE_COUNT; type++)
+    {
+        snprintf(expression, sizeof(expression), "type == %s", fileDescriptorTypeName(type));
+        FilterRow row = {1, 1, "", (FileDescriptorType)type, 1};
+        CHECK(matches(expression, &row) == FILTER_TRUE);
+        row.type = (FileDescriptorType)((type + 1) % FD_TYPE_COUNT);
+        CHECK(matches(expression, &row) == FILTER_FALSE);
+    }
+
+    // a program longer than FILTER_MAX_INSTRUCTIONS is rejected rather than truncated
+    char longExpression[FILTER_MAX_INSTRUCTIONS * 16] = "fd == 0";
+    for (int i = 1; i < FILTER_MAX_INSTRUCTIONS; i++)
+        strcat(longExpression, " || fd == 0");
+    CHECK(rejects(longExpression));
+}
+
+static void testEvaluate()
+{
+    CHECK(kept("pid in 100..200") == 0x0E);
+    CHECK(kept("pid == 1") == 0x01);
+    CHECK(kept("pid = 1") == 0x01);
+    CHECK(kept("fd >= 1000") == 0x14);
+    CHECK(kept("fd < 3") == 0x01);
+    CHECK(kept("fd <= 3") == 0x03);
+    CHECK(kept("inode > 2680412") == 0x04);
+    CHECK(kept("type == socket") == 0x06);
+    CHECK(kept("type != socket") == 0xF9);
+    CHECK(kept("path ~ /tmp/*.log") == 0x10);
+    CHECK(kept("path ~ \"/tmp/*.log (deleted)\"") == 0x20);
+    CHECK(kept("path ^= /var/log/") == 0x08);
+    CHECK(kept("path == /dev/null") == 0x01);
+    CHECK(kept("path != /dev/null") == 0xFE);
+    CHECK(kept("type == socket && (fd >= 1000 || path ^= /var/log/)") == 0x04);
+    CHECK(kept("!(type == socket) && fd >= 1000") == 0x10);
+    CHECK(kept("type == eventfd || type == pipe") == 0xC0);
+    // && binds tighter than ||
+    CHECK(kept("pid == 1 || pid == 100 && fd == 1000") == 0x01);
+    CHECK(kept("(pid == 1 || pid == 100) && fd == 3") == 0x02);
+    CHECK(evaluateRowFilter(NULL, FILTER_STAGE_PID, &rows[0]) == FILTER_TRUE);
+}
+
+static void testStages()
+{
+    RowFilter *filter = compileRowFilter("type == socket && (fd >= 1000 || path ^= /var/log/)");
+    CHECK(filter != NULL);
+    if (filter == NULL)
+        return;
+    CHECK(!filter->usesStage[FILTER_STAGE_PID]);
+    CHECK(filter->usesStage[FILTER_STAGE_FD]);
+    CHECK(filter->usesStage[FILTER_STAGE_PATH]);
+    CHECK(!filter->usesStage[FILTER_STAGE_INODE]);
+    // nothing is known before the path, however large the fd
+    CHECK(evaluateRowFilter(filter, FILTER_STAGE_PID, &rows[2]) == FILTER_UNKNOWN);
+    CHECK(evaluateRowFilter(filter, FILTER_STAGE_FD, &rows[2]) == FILTER_UNKNOWN);
+    CHECK(evaluateRowFilter(filter, FILTER_STAGE_PATH, &rows[2]) == FILTER_TRUE);
+    CHECK(evaluateRowFilter(filter, FILTER_STAGE_PATH, &rows[1]) == FILTER_FALSE);
+    freeRowFilter(filter);
+
+    // a row is dropped as soon as a resolved field rules it out
+    filter = compileRowFilter("fd in 3..10 && path ^= /etc/ && inode > 100");
+    CHECK(filter != NULL);
+    if (filter == NULL)
+        return;
+    CHECK(evaluateRowFilter(filter, FILTER_STAGE_PID, &rows[4]) == FILTER_UNKNOWN);
+    CHECK(evaluateRowFilter(filter, FILTER_STAGE_FD, &rows[4]) == FILTER_FALSE);
+    CHECK(evaluateRowFilter(filter, FILTER_STAGE_FD, &rows[3]) == FILTER_UNKNOWN);
+    CHECK(evaluateRowFilter(filter, FILTER_STAGE_PATH, &rows[3]) == FILTER_FALSE);
+    FilterRow etc = {1, 4, "/etc/passwd", FD_TYPE_FILE, 50};
+    CHECK(evaluateRowFilter(filter, FILTER_STAGE_PATH, &etc) == FILTER_UNKNOWN);
+    CHECK(evaluateRowFilter(filter, FILTER_STAGE_INODE, &etc) == FILTER_FALSE);
+    etc.inode = 500;
+    CHECK(evaluateRowFilter(filter, FILTER_STAGE_INODE, &etc) == FILTER_TRUE);
+    freeRowFilter(filter);
+
+    // the complement of unknown stays unknown, while a decided branch of || decides it
+    filter = compileRowFilter("!(inode == 5) || pid == 1");
+    CHECK(filter != NULL);
+    if (filter == NULL)
+        return;
+    CHECK(evaluateRowFilter(filter, FILTER_STAGE_PID, &rows[0]) == FILTER_TRUE);
+    CHECK(evaluateRowFilter(filter, FILTER_STAGE_PATH, &rows[1]) == FILTER_UNKNOWN);
+    CHECK(evaluateRowFilter(filter, FILTER_STAGE_INODE, &rows[1]) == FILTER_TRUE);
+    freeRowFilter(filter);
+}
+
+static void testEquivalences()
+{
+    CHECK(equivalent("!(type == socket || fd < 10)", "!(type == socket) && !(fd < 10)"));
+    CHECK(equivalent("!(pid == 100 && inode > 10)", "pid != 100 || inode <= 10"));
+    CHECK(equivalent("!!(path ^= /tmp/)", "path ^= /tmp/"));
+    CHECK(equivalent("pid in 100..200", "pid >= 100 && pid <= 200"));
+    CHECK(equivalent("fd >= 3 && (type == socket || type == pipe)", "fd >= 3 && type == socket || fd >= 3 && type == pipe"));
+    CHECK(equivalent("pid == 1", "  (  pid==1 )  "));
+    CHECK(!equivalent("fd < 10", "fd <= 10"));
+}
+
+int main()
+{
+    testParse();
+    testEvaluate();
+    testStages();
+    testEquivalences();
+    return checkResult("rowFilterTest");
+}
@@ -0,0 +1,201 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "../processes.h"
+#include "../readProcesses.h"
+#include "../sharedSnapshot.h"
+#include "check.h"
+#include "fixture.h"
+
+static char name[64];
+
+static const unsigned long firstFds[] = {0, 1, 2};
+static const char *firstFilenames[] = {"/dev/null", "socket:[2680412]", "/tmp/run.log (deleted)"};
+static const unsigned long secondFds[] = {9};
+static const char *secondFilenames[] = {"pipe:[2677450]"};
+
+/**
+ * Publish a snapshot of three processes, the second of which has no file descriptors.
+ * @param publisher Publisher to write with
+ * @return 0 if operation was successful
+ */
+static int publishProcesses(SharedSnapshotPublisher *publisher)
+{
+    ProcessData *processes[3];
+    processes[0] = makeProcess(17, 3, firstFds, firstFilenames);
+    processes[1] = makeProcess(18, 0, NULL, NULL);
+    processes[2] = makeProcess(4000, 1, secondFds, secondFilenames);
+    int result = publishSharedSnapshot(publisher, processes, 3);
+    for (int i = 0; i < 3; i++)
+        freeProcess(processes[i]);
+    return result;
+}
+
+/**
+ * Publish a single process with more rows than a region is first sized for.
+ * @param publisher Publisher to write with
+ * @param size Number of rows
+ * @return 0 if operation was successful
+ */
+static int publishLargeProcess(SharedSnapshotPublisher *publisher, unsigned long size)
+{
+    unsigned long *fds = (unsigned long *)malloc(size * sizeof(unsigned long));
+    const char **filenames = (const char **)malloc(size * sizeof(char *));
+    for (unsigned long i = 0; i < size; i++)
+    {
+        fds[i] = i;
+        filenames[i] = "/var/lib/postgresql/16/main/base/16384/2619";
+    }
+    ProcessData *process = makeProcess(42, size, fds, filenames);
+    int result = publishSharedSnapshot(publisher, &process, 1);
+    freeProcess(process);
+    free(fds);
+    free(filenames);
+    return result;
+}
+
+static void testRoundTrip()
+{
+    SharedSnapshotPublisher *publisher = createSharedSnapshotPublisher(name);
+    CHECK(publisher != NULL);
+    if (publisher == NULL)
+        return;
+    // nothing to open before the first snapshot creates the region
+    CHECK(openSharedSnapshot(name) == NULL);
+    CHECK(publishProcesses(publisher) == 0);
+    SharedSnapshotReader *reader = openSharedSnapshot(name);
+    CHECK(reader != NULL);
+    if (reader == NULL)
+        return;
+
+    SharedSnapshot snapshot;
+    memset(&snapshot, 0, sizeof(snapshot));
+    CHECK(readSharedSnapshot(reader, &snapshot) == 0);
+    CHECK(snapshot.generation == 1);
+    CHECK(snapshot.numProcesses == 3);
+    CHECK(snapshot.numRows == 4);
+    int numProcesses = -1;
+    ProcessData **processes = sharedSnapshotToProcesses(&snapshot, &numProcesses);
+    // the process without file descriptors has no rows
+    CHECK(processes != NULL && numProcesses == 2);
+    if (processes != NULL && numProcesses == 2)
+    {
+        CHECK(processes[0]->pid == 17 && processes[0]->size == 3);
+        CHECK(processes[1]->pid == 4000 && processes[1]->size == 1);
+        for (unsigned long i = 0; i < processes[0]->size; i++)
+        {
+            CHECK(processes[0]->fileDescriptors[i]->fd == firstFds[i]);
+            CHECK(processes[0]->fileDescriptors[i]->inode == 17 * 1000 + firstFds[i]);
+            CHECK_STRING(processes[0]->fileDescriptors[i]->filename, firstFilenames[i]);
+            CHECK(processes[0]->fileDescriptors[i]->type == classifyFilename(firstFilenames[i]));
+        }
+        CHECK_STRING(processes[1]->fileDescriptors[0]->filename, secondFilenames[0]);
+    }
+    freeProcesses(processes, numProcesses);
+
+    // the next snapshot goes to the other buffer
+    CHECK(publishProcesses(publisher) == 0);
+    CHECK(readSharedSnapshot(reader, &snapshot) == 0);
+    CHECK(snapshot.generation == 2);
+
+    // a snapshot too large for the region replaces it, and the reader follows
+    CHECK(publishLargeProcess(publisher, 5000) == 0);
+    CHECK(readSharedSnapshot(reader, &snapshot) == 0);
+    CHECK(snapshot.generation == 3);
+    CHECK(snapshot.numRows == 5000);
+    CHECK(snapshot.rows != NULL && snapshot.rows[4999].fd == 4999);
+
+    freeSharedSnapshot(&snapshot);
+    closeSharedSnapshot(reader);
+    closeSharedSnapshotPublisher(publisher, 1);
+}
+
+/**
+ * Start publishing again under the test name after a short pause, as a restarted publisher would.
+ * @param argument Unused
+ * @return The publisher, to close once the test is done
+ */
+static void *republish(void *argument)
+{
+    struct timespec pause = {0, 5000000};
+    nanosleep(&pause, NULL);
+    SharedSnapshotPublisher *publisher = createSharedSnapshotPublisher(name);
+    if (publisher != NULL && publishProcesses(publisher) != 0)
+    {
+        closeSharedSnapshotPublisher(publisher, 1);
+        return NULL;
+    }
+    return publisher;
+}
+
+static void testRetired()
+{
+    SharedSnapshotPublisher *publisher = createSharedSnapshotPublisher(name);
+    CHECK(publisher != NULL && publishProcesses(publisher) == 0);
+    SharedSnapshotReader *reader = openSharedSnapshot(name);
+    CHECK(reader != NULL);
+    if (publisher == NULL || reader == NULL)
+        return;
+    SharedSnapshot snapshot;
+    memset(&snapshot, 0, sizeof(snapshot));
+    CHECK(readSharedSnapshot(reader, &snapshot) == 0);
+
+    // the region is retired and unlinked before its replacement exists: the reader waits for it
+    closeSharedSnapshotPublisher(publisher, 1);
+    pthread_t thread;
+    CHECK(pthread_create(&thread, NULL, republish, NULL) == 0);
+    CHECK(readSharedSnapshot(reader, &snapshot) == 0);
+    CHECK(snapshot.generation == 1 && snapshot.numRows == 4);
+    void *republished = NULL;
+    pthread_join(thread, &republished);
+    CHECK(republished != NULL);
+
+    // once the publisher has stopped for good, reads fail, and keep failing without crashing
+    closeSharedSnapshotPublisher((SharedSnapshotPublisher *)republished, 1);
+    CHECK(readSharedSnapshot(reader, &snapshot) == -1);
+    CHECK(readSharedSnapshot(reader, &snapshot) == -1);
+
+    freeSharedSnapshot(&snapshot);
+    closeSharedSnapshot(reader);
+}
+
+static void testMalformed()
+{
+    // rows of three PIDs in a snapshot that claims a single process
+    SharedRow rows[3];
+    memset(rows, 0, sizeof(rows));
+    char strings[] = "a";
+    for (int i = 0; i < 3; i++)
+        rows[i].pid = 100 + i;
+    SharedSnapshot snapshot;
+    memset(&snapshot, 0, sizeof(snapshot));
+    snapshot.numProcesses = 1;
+    snapshot.numRows = 3;
+    snapshot.rows = rows;
+    snapshot.strings = strings;
+    int numProcesses = -1;
+    CHECK(sharedSnapshotToProcesses(&snapshot, &numProcesses) == NULL);
+    CHECK(numProcesses == 0);
+
+    // runs of the same PID are grouped into one process
+    rows[1].pid = rows[2].pid = 100;
+    numProcesses = -1;
+    ProcessData **processes = sharedSnapshotToProcesses(&snapshot, &numProcesses);
+    CHECK(processes != NULL && numProcesses == 1);
+    if (processes != NULL && numProcesses == 1)
+        CHECK(processes[0]->size == 3);
+    freeProcesses(processes, numProcesses);
+}
+
+int main()
+{
+    snprintf(name, sizeof(name), "/sharedSnapshotTest.%d", getpid());
+    testRoundTrip();
+    testRetired();
+    testMalformed();
+    return checkResult("sharedSnapshotTest");
+}
@@ -0,0 +1,281 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../processes.h"
+#include "../columns.h"
+#include "../printTables.h"
+#include "../readProcesses.h"
+#include "../snapshotStream.h"
+#include "check.h"
+#include "fixture.h"
+
+static char directory[] = "/tmp/snapshotStreamTest.XXXXXX";
+static char path[1024];
+
+/**
+ * Processes written to the binary tables
+ */
+static const unsigned long firstFds[] = {0, 1, 2, 3, 4, 5};
+static const char *firstFilenames[] = {"/dev/null", "socket:[2680412]", "pipe:[2677450]", "/tmp/run.log (deleted)", "anon_inode:[eventfd]", "/etc/a,\"b\"\nc"};
+static const unsigned long secondFds[] = {7, 1000};
+static const char *secondFilenames[] = {"/var/log/syslog", "anon_inode:inotify"};
+
+/**
+ * Write a binary table of the test processes.
+ * @param columns Mask of the columns to save
+ * @return 0 if operation was successful
+ */
+static int writeTable(unsigned int columns)
+{
+    ProcessData *processes[3];
+    processes[0] = makeProcess(17, 6, firstFds, firstFilenames);
+    processes[1] = makeProcess(18, 0, NULL, NULL);
+    processes[2] = makeProcess(4000, 2, secondFds, secondFilenames);
+    int result = print_columns_binary(path, columns, processes, 3);
+    for (int i = 0; i < 3; i++)
+        freeProcess(processes[i]);
+    return result;
+}
+
+/**
+ * Read back the rows of one process and compare them with those written.
+ * @param stream Stream positioned before the header of the process
+ * @param pid Expected PID
+ * @param size Expected number of rows
+ * @param fds Expected file descriptors
+ * @param filenames Expected filenames, or NULL if they were not saved
+ */
+static void checkProcess(SnapshotStream *stream, unsigned long pid, unsigned long size, const unsigned long *fds, const char **filenames)
+{
+    ProcessData process;
+    CHECK(readSnapshotProcess(stream, &process) == 1);
+    CHECK(process.pid == pid);
+    CHECK(process.inode == 1000000 + pid);
+    CHECK(process.size == size);
+    for (unsigned long i = 0; i < size; i++)
+    {
+        FileDescriptorEntry entry;
+        CHECK(readSnapshotRow(stream, &entry) == 1);
+        CHECK(entry.fd == fds[i]);
+        CHECK(entry.inode == pid * 1000 + fds[i]);
+        if (filenames != NULL)
+        {
+            CHECK_STRING(entry.filename, filenames[i]);
+            CHECK(entry.type == classifyFilename(filenames[i]));
+        }
+        CHECK(entry.socket == NULL);
+    }
+    FileDescriptorEntry entry;
+    CHECK(readSnapshotRow(stream, &entry) == 0);
+}
+
+static void testRoundTrip()
+{
+    // every column, the fixed composite table, and columns without the type or filename
+    const unsigned int masks[] = {ALL_COLUMNS, COMPOSITE_COLUMNS, COLUMN_MASK(fd) | COLUMN_MASK(filename) | COLUMN_MASK(inode),
+                                  COLUMN_MASK(fd) | COLUMN_MASK(inode) | COLUMN_MASK(dev)};
+    for (int m = 0; m < sizeof(masks) / sizeof(masks[0]); m++)
+    {
+        CHECK(writeTable(masks[m]) == 0);
+        SnapshotStream stream;
+        CHECK(openSnapshotStream(&stream, path) == 0);
+        if (stream.file == NULL)
+            continue;
+        CHECK(stream.columns == masks[m]);
+        // types are counted whatever the columns
+        CHECK(stream.byType[FD_TYPE_DEVICE] == 1);
+        CHECK(stream.byType[FD_TYPE_SOCKET] == 1);
+        CHECK(stream.byType[FD_TYPE_PIPE] == 1);
+        CHECK(stream.byType[FD_TYPE_DELETED] == 1);
+        CHECK(stream.byType[FD_TYPE_EVENTFD] == 1);
+        CHECK(stream.byType[FD_TYPE_FILE] == 2);
+        CHECK(stream.byType[FD_TYPE_INOTIFY] == 1);
+        const char **first = masks[m] & COLUMN_MASK(filename) ? firstFilenames : NULL;
+        const char **second = masks[m] & COLUMN_MASK(filename) ? secondFilenames : NULL;
+        checkProcess(&stream, 17, 6, firstFds, first);
+        checkProcess(&stream, 18, 0, NULL, NULL);
+        checkProcess(&stream, 4000, 2, secondFds, second);
+        ProcessData process;
+        CHECK(readSnapshotProcess(&stream, &process) == 0);
+        closeSnapshotStream(&stream);
+    }
+}
+
+static void testReadProcesses()
+{
+    // a table without the filename column, as written by --columns=pid,fd, read whole like binRead does
+    CHECK(writeTable(COLUMN_MASK(pid) | COLUMN_MASK(fd)) == 0);
+    SnapshotStream stream;
+    CHECK(openSnapshotStream(&stream, path) == 0);
+    if (stream.file == NULL)
+        return;
+    int numProcesses = -1;
+    ProcessData **processes = readSnapshotProcesses(&stream, &numProcesses);
+    closeSnapshotStream(&stream);
+    CHECK(processes != NULL);
+    CHECK(numProcesses == 3);
+    if (processes == NULL || numProcesses != 3)
+        return;
+    CHECK(processes[0]->pid == 17 && processes[0]->size == 6);
+    CHECK(processes[1]->pid == 18 && processes[1]->size == 0);
+    CHECK(processes[2]->pid == 4000 && processes[2]->size == 2);
+    for (unsigned long i = 0; i < processes[0]->size; i++)
+    {
+        CHECK(processes[0]->fileDescriptors[i]->fd == firstFds[i]);
+        CHECK(processes[0]->fileDescriptors[i]->filename == NULL);
+    }
+    CHECK(processes[2]->fileDescriptors[1]->fd == 1000);
+    freeProcesses(processes, numProcesses);
+
+    // with filenames, each row keeps its own copy
+    CHECK(writeTable(COMPOSITE_COLUMNS) == 0);
+    CHECK(openSnapshotStream(&stream, path) == 0);
+    if (stream.file == NULL)
+        return;
+    processes = readSnapshotProcesses(&stream, &numProcesses);
+    closeSnapshotStream(&stream);
+    CHECK(processes != NULL && numProcesses == 3);
+    if (processes == NULL || numProcesses != 3)
+        return;
+    for (unsigned long i = 0; i < processes[0]->size; i++)
+        CHECK_STRING(processes[0]->fileDescriptors[i]->filename, firstFilenames[i]);
+    CHECK_STRING(processes[2]->fileDescriptors[0]->filename, secondFilenames[0]);
+    freeProcesses(processes, numProcesses);
+
+    // a truncated table is not read at all
+    CHECK(writeTable(COLUMN_MASK(pid) | COLUMN_MASK(fd)) == 0);
+    CHECK(truncate(path, 3 * sizeof(unsigned int) + FD_TYPE_COUNT * sizeof(unsigned long) + 5 * sizeof(unsigned long)) == 0);
+    CHECK(openSnapshotStream(&stream, path) == 0);
+    if (stream.file == NULL)
+        return;
+    numProcesses = -1;
+    CHECK(readSnapshotProcesses(&stream, &numProcesses) == NULL);
+    CHECK(numProcesses == 0);
+    closeSnapshotStream(&stream);
+}
+
+static void testWriteErrors()
+{
+    ProcessData *process = makeProcess(17, 6, firstFds, firstFilenames);
+    int saved = silenceStderr();
+    CHECK(print_columns_binary("/nonexistent/table.bin", COMPOSITE_COLUMNS, &process, 1) == -1);
+    // every write to /dev/full fails with ENOSPC, here when the buffer is flushed on closing
+    CHECK(print_columns_binary("/dev/full", COMPOSITE_COLUMNS, &process, 1) == -1);
+    CHECK(print_columns_binary("/dev/full", ALL_COLUMNS, &process, 1) == -1);
+    restoreStderr(saved);
+    freeProcess(process);
+}
+
+/**
+ * Write a string as stored by binary tables: its length, then its bytes.
+ */
+static void writeString(FILE *file, const char *string)
+{
+    size_t length = strlen(string);
+    fwrite(&length, sizeof(size_t), 1, file);
+    fwrite(string, sizeof(char), length, file);
+}
+
+static void testVersion1()
+{
+    // TVB1 tables have no type counts and no type column, types come from the filenames
+    FILE *file = fopen(path, "wb");
+    unsigned int header[2] = {BINARY_MAGIC_V1, COLUMN_MASK(index) | COLUMN_MASK(pid) | COLUMN_MASK(fd) | COLUMN_MASK(filename) | COLUMN_MASK(inode)};
+    fwrite(header, sizeof(unsigned int), 2, file);
+    unsigned long process[3] = {17, 1000017, 2};
+    fwrite(process, sizeof(unsigned long), 3, file);
+    for (int i = 0; i < 2; i++)
+    {
+        fwrite(&firstFds[i], sizeof(unsigned long), 1, file);
+        writeString(file, firstFilenames[i]);
+        unsigned long inode = 17 * 1000 + firstFds[i];
+        fwrite(&inode, sizeof(unsigned long), 1, file);
+    }
+    fclose(file);
+
+    SnapshotStream stream;
+    CHECK(openSnapshotStream(&stream, path) == 0);
+    if (stream.file == NULL)
+        return;
+    CHECK(stream.columns == header[1]);
+    for (int type = 0; type < FD_TYPE_COUNT; type++)
+        CHECK(stream.byType[type] == 0);
+    checkProcess(&stream, 17, 2, firstFds, firstFilenames);
+    ProcessData end;
+    CHECK(readSnapshotProcess(&stream, &end) == 0);
+    closeSnapshotStream(&stream);
+}
+
+static void testRejected()
+{
+    SnapshotStream stream;
+    CHECK(openSnapshotStream(&stream, "/nonexistent/table.bin") == -1);
+
+    FILE *file = fopen(path, "wb");
+    unsigned int header[3] = {0x33425654u, COMPOSITE_COLUMNS, FD_TYPE_COUNT};
+    fwrite(header, sizeof(unsigned int), 3, file);
+    fclose(file);
+    CHECK(openSnapshotStream(&stream, path) == -1);
+
+    // a TVB2 header cut before its type counts
+    file = fopen(path, "wb");
+    header[0] = BINARY_MAGIC;
+    fwrite(header, sizeof(unsigned int), 3, file);
+    fclose(file);
+    CHECK(openSnapshotStream(&stream, path) == -1);
+
+    // rows cut short: the last row of the first process is incomplete
+    CHECK(writeTable(COMPOSITE_COLUMNS) == 0);
+    file = fopen(path, "rb");
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fclose(file);
+    long firstProcessEnd = 3 * sizeof(unsigned int) + FD_TYPE_COUNT * sizeof(unsigned long) + 3 * sizeof(unsigned long);
+    for (int i = 0; i < 6; i++)
+        firstProcessEnd += 2 * sizeof(unsigned long) + sizeof(size_t) + strlen(firstFilenames[i]);
+    CHECK(firstProcessEnd < length);
+    CHECK(truncate(path, firstProcessEnd - 1) == 0);
+    CHECK(openSnapshotStream(&stream, path) == 0);
+    if (stream.file == NULL)
+        return;
+    ProcessData process;
+    FileDescriptorEntry entry;
+    CHECK(readSnapshotProcess(&stream, &process) == 1);
+    for (int i = 0; i < 5; i++)
+        CHECK(readSnapshotRow(&stream, &entry) == 1);
+    CHECK(readSnapshotRow(&stream, &entry) == -1);
+    closeSnapshotStream(&stream);
+
+    // a process header cut short
+    CHECK(writeTable(COMPOSITE_COLUMNS) == 0);
+    CHECK(truncate(path, firstProcessEnd + sizeof(unsigned long)) == 0);
+    CHECK(openSnapshotStream(&stream, path) == 0);
+    if (stream.file == NULL)
+        return;
+    CHECK(readSnapshotProcess(&stream, &process) == 1);
+    for (int i = 0; i < 6; i++)
+        CHECK(readSnapshotRow(&stream, &entry) == 1);
+    CHECK(readSnapshotRow(&stream, &entry) == 0);
+    CHECK(readSnapshotProcess(&stream, &process) == -1);
+    closeSnapshotStream(&stream);
+}
+
+int main()
+{
+    if (mkdtemp(directory) == NULL)
+    {
+        perror("mkdtemp");
+        return 1;
+    }
+    snprintf(path, sizeof(path), "%s/table.bin", directory);
+    testRoundTrip();
+    testReadProcesses();
+    testWriteErrors();
+    testVersion1();
+    testRejected();
+    unlink(path);
+    rmdir(directory);
+    return checkResult("snapshotStreamTest");
+}
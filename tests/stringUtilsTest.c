@@ -0,0 +1,76 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "../processes.h"
+#include "../stringUtils.h"
+#include "check.h"
+
+/**
+ * Classify a null-terminated link target.
+ * @param link Target of a /proc/<pid>/fd/<fd> link
+ * @return The type of the file descriptor
+ */
+static FileDescriptorType classify(const char *link)
+{
+    return classifyLink(link, strlen(link));
+}
+
+static void testClassifyLink()
+{
+    CHECK(classify("/etc/passwd") == FD_TYPE_FILE);
+    CHECK(classify("/dev/null") == FD_TYPE_DEVICE);
+    CHECK(classify("/dev/pts/0") == FD_TYPE_DEVICE);
+    // shared memory objects live under /dev but are files
+    CHECK(classify("/dev/shm/tableViewer") == FD_TYPE_FILE);
+    CHECK(classify("/tmp/log.txt (deleted)") == FD_TYPE_DELETED);
+    CHECK(classify("/memfd:buffer (deleted)") == FD_TYPE_MEMFD);
+    CHECK(classify("/memfd:") == FD_TYPE_MEMFD);
+    CHECK(classify("socket:[2680412]") == FD_TYPE_SOCKET);
+    CHECK(classify("pipe:[2677450]") == FD_TYPE_PIPE);
+    CHECK(classify("anon_inode:[eventfd]") == FD_TYPE_EVENTFD);
+    CHECK(classify("anon_inode:[eventpoll]") == FD_TYPE_EVENTPOLL);
+    CHECK(classify("anon_inode:[timerfd]") == FD_TYPE_TIMERFD);
+    CHECK(classify("anon_inode:[signalfd]") == FD_TYPE_SIGNALFD);
+    CHECK(classify("anon_inode:inotify") == FD_TYPE_INOTIFY);
+    CHECK(classify("anon_inode:bpf-map") == FD_TYPE_ANON_INODE);
+    CHECK(classify("anon_inode:[pidfd]") == FD_TYPE_ANON_INODE);
+    CHECK(classify("net:[4026531992]") == FD_TYPE_OTHER);
+    CHECK(classify("") == FD_TYPE_OTHER);
+    // prefixes must match in full
+    CHECK(classify("socket") == FD_TYPE_OTHER);
+    CHECK(classify("pipe:") == FD_TYPE_OTHER);
+    CHECK(classify("anon_inode") == FD_TYPE_OTHER);
+    CHECK(classify("/dev") == FD_TYPE_FILE);
+    // only the length given is classified, as readlink does not terminate its result
+    CHECK(classifyLink("socket:[1]garbage", 3) == FD_TYPE_OTHER);
+    CHECK(classifyLink("/dev/null (deleted)", 9) == FD_TYPE_DEVICE);
+    CHECK(classifyFilename(NULL) == FD_TYPE_OTHER);
+}
+
+static void testTypeNames()
+{
+    char names[FD_TYPE_NAMES_SIZE];
+    CHECK_STRING(listFileDescriptorTypeNames(names, sizeof(names)),
+                 "file, socket, pipe, other, device, deleted, memfd, anon_inode, eventfd, eventpoll, timerfd, signalfd or inotify");
+    CHECK_STRING(fileDescriptorTypeName(FD_TYPE_COUNT), "other");
+
+    unsigned int types;
+    CHECK(parseFileDescriptorTypes("socket,pipe", &types) == 0);
+    CHECK(types == (FD_TYPE_MASK(FD_TYPE_SOCKET) | FD_TYPE_MASK(FD_TYPE_PIPE)));
+    CHECK(parseFileDescriptorTypes("sock", &types) != 0);
+    CHECK(parseFileDescriptorTypes("", &types) != 0);
+    CHECK(parseFileDescriptorTypes("socket,", &types) == 0);
+    // every name printed in the type column is accepted back
+    for (int type = 0; type < FD_TYPE_COUNT; type++)
+    {
+        CHECK(parseFileDescriptorTypes(fileDescriptorTypeName(type), &types) == 0);
+        CHECK(types == FD_TYPE_MASK(type));
+    }
+}
+
+int main()
+{
+    testClassifyLink();
+    testTypeNames();
+    return checkResult("stringUtilsTest");
+}